@@ -0,0 +1,219 @@
+/* 按行与按块遍历 fixed 表的对比：每帧耗时与缓存缺失（Linux perf_event），不依赖 GStreamer / OpenCV。
+ *
+ *   bench-undistort-tiles [--k1 V] [--frames N] [--isa scalar|sse41|avx2|avx512]
+ *
+ * 映射表与 initUndistortRectifyMap + convertMaps(CV_16SC2) 的结果相同（原内参、无缩放），
+ * 标定参数取文档例子按分辨率缩放后的值，k1 默认 -0.29（IDC 标定）。
+ * 每个分辨率/格式输出两行（linear、tiled），以及 tiled 相对 linear 的比例：
+ *   L2 miss 以 LLC 读访问计（L2 未命中才会访问 LLC），LLC miss 为 LLC 读未命中。
+ * perf_event 不可用（容器、perf_event_paranoid 过高）时计数列为 -1，只比较耗时。 */
+
+#include "gstundistort_kernels.h"
+#include "gstundistort_tiles.h"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+typedef struct {
+    const char *name;
+    int width, height;
+} BenchSize;
+
+typedef struct {
+    const char *name;
+    int channels;
+} BenchFormat;
+
+typedef struct {
+    double ms;
+    long long l2_miss, llc_miss;
+} BenchResult;
+
+static int
+perf_open(uint64_t cache, uint64_t result) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (result << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static long long
+perf_read(int fd) {
+    long long v = -1;
+    if (fd < 0 || read(fd, &v, sizeof(v)) != sizeof(v))
+        return -1;
+    return v;
+}
+
+/* 与 initUndistortRectifyMap（R 为单位阵、新内参 = 原内参）相同的正向畸变，
+ * 再按 convertMaps 的规则量化到 1/32 像素 */
+static void
+build_fixed_map(int w, int h, double k1, std::vector<int16_t> &xy, std::vector<uint16_t> &fxy) {
+    const double f = 0.625 * w, cx = 0.5 * w, cy = 0.5 * h;
+    const double k2 = 0.1;
+    xy.resize((size_t) w * h * 2);
+    fxy.resize((size_t) w * h);
+    for (int v = 0; v < h; ++v) {
+        for (int u = 0; u < w; ++u) {
+            const double x = (u - cx) / f, y = (v - cy) / f;
+            const double r2 = x * x + y * y;
+            const double k = 1 + k1 * r2 + k2 * r2 * r2;
+            const double sx = x * k * f + cx, sy = y * k * f + cy;
+            const long ix = lround(sx * UNDISTORT_INTER_TAB_SIZE);
+            const long iy = lround(sy * UNDISTORT_INTER_TAB_SIZE);
+            const size_t i = (size_t) v * w + u;
+            xy[2 * i] = (int16_t) std::max(-32768L, std::min(32767L, ix >> UNDISTORT_INTER_BITS));
+            xy[2 * i + 1] = (int16_t) std::max(-32768L, std::min(32767L, iy >> UNDISTORT_INTER_BITS));
+            fxy[i] = (uint16_t) ((iy & (UNDISTORT_INTER_TAB_SIZE - 1)) * UNDISTORT_INTER_TAB_SIZE +
+                                 (ix & (UNDISTORT_INTER_TAB_SIZE - 1)));
+        }
+    }
+}
+
+/* 用一块比 LLC 大的缓冲把缓存冲掉，避免上一帧的源数据留在缓存里 */
+static void
+flush_caches(std::vector<uint8_t> &junk) {
+    for (size_t i = 0; i < junk.size(); i += 64)
+        junk[i]++;
+}
+
+static BenchResult
+run(bool tiled, const UndistortTileGrid *grid, UndistortRemapRowFunc func, const UndistortSrcPlane *src,
+    int channels, std::vector<uint8_t> &dst, int w, int h, const std::vector<int16_t> &xy,
+    const std::vector<uint16_t> &fxy, int frames, std::vector<uint8_t> &junk) {
+    const int l2_fd = perf_open(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_ACCESS);
+    const int llc_fd = perf_open(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_RESULT_MISS);
+    BenchResult r = {0, 0, 0};
+    double total = 0;
+
+    for (int i = -1; i < frames; ++i) { // 第 -1 帧预热
+        flush_caches(junk);
+        const bool measure = i >= 0;
+        if (measure) {
+            for (int fd: {l2_fd, llc_fd}) {
+                if (fd >= 0) {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+        }
+        const auto start = std::chrono::steady_clock::now();
+        if (tiled)
+            undistort_tiles_remap(grid, func, src, channels, dst.data(), (size_t) w * channels,
+                                  xy.data(), (size_t) w * 2, fxy.data(), (size_t) w, 0, grid->rows);
+        else
+            undistort_remap_rows(func, src, dst.data(), (size_t) w * channels, w,
+                                 xy.data(), (size_t) w * 2, fxy.data(), (size_t) w, 0, h);
+        const auto end = std::chrono::steady_clock::now();
+        if (!measure)
+            continue;
+        for (int fd: {l2_fd, llc_fd}) {
+            if (fd >= 0)
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        }
+        total += std::chrono::duration<double, std::milli>(end - start).count();
+        const long long l2 = perf_read(l2_fd), llc = perf_read(llc_fd);
+        r.l2_miss = l2 < 0 || r.l2_miss < 0 ? -1 : r.l2_miss + l2;
+        r.llc_miss = llc < 0 || r.llc_miss < 0 ? -1 : r.llc_miss + llc;
+    }
+    for (int fd: {l2_fd, llc_fd}) {
+        if (fd >= 0)
+            close(fd);
+    }
+    r.ms = total / frames;
+    if (r.l2_miss > 0)
+        r.l2_miss /= frames;
+    if (r.llc_miss > 0)
+        r.llc_miss /= frames;
+    return r;
+}
+
+int
+main(int argc, char **argv) {
+    double k1 = -0.29;
+    int frames = 20;
+    UndistortIsa isa = undistort_kernels_detect_isa();
+
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "--k1") && i + 1 < argc) {
+            k1 = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--isa") && i + 1 < argc) {
+            const char *name = argv[++i];
+            for (int v = UNDISTORT_ISA_SCALAR; v <= UNDISTORT_ISA_AVX512; ++v) {
+                if (!strcmp(name, undistort_isa_name((UndistortIsa) v)))
+                    isa = std::min(isa, (UndistortIsa) v);
+            }
+        } else {
+            fprintf(stderr, "usage: %s [--k1 V] [--frames N] [--isa scalar|sse41|avx2|avx512]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    static const BenchSize sizes[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+    static const BenchFormat formats[] = {{"GRAY8", 1}, {"BGR", 3}, {"BGRx", 4}};
+    const size_t budget = undistort_tiles_l2_size() / 2;
+    std::vector<uint8_t> junk(64 << 20);
+
+    printf("# isa=%s k1=%.3f frames=%d l2=%zu budget=%zu\n", undistort_isa_name(isa), k1, frames,
+           undistort_tiles_l2_size(), budget);
+    printf("%-6s %-6s %-7s %-9s %10s %14s %14s\n", "size", "format", "order", "tile", "ms/frame",
+           "l2_miss", "llc_miss");
+
+    for (const BenchSize &size: sizes) {
+        std::vector<int16_t> xy;
+        std::vector<uint16_t> fxy;
+        build_fixed_map(size.width, size.height, k1, xy, fxy);
+
+        for (const BenchFormat &format: formats) {
+            const int w = size.width, h = size.height, cn = format.channels;
+            std::vector<uint8_t> in((size_t) w * h * cn), out((size_t) w * h * cn);
+            for (size_t i = 0; i < in.size(); ++i)
+                in[i] = (uint8_t) (i * 2654435761u >> 24);
+            const UndistortSrcPlane src = {in.data(), (size_t) w * cn, w, h};
+            const UndistortRemapRowFunc func = undistort_kernels_get(cn, isa);
+
+            UndistortTileGrid grid;
+            undistort_tiles_build(&grid, xy.data(), (size_t) w * 2, w, h, w, h, cn, budget, 0, 0);
+
+            const BenchResult linear = run(false, &grid, func, &src, cn, out, w, h, xy, fxy, frames, junk);
+            std::vector<uint8_t> ref = out;
+            const BenchResult tiled = run(true, &grid, func, &src, cn, out, w, h, xy, fxy, frames, junk);
+            if (ref != out) {
+                fprintf(stderr, "%s %s: tiled output differs from linear\n", size.name, format.name);
+                return 1;
+            }
+
+            char tile[16];
+            snprintf(tile, sizeof(tile), "%dx%d", grid.tile_w, grid.tile_h);
+            printf("%-6s %-6s %-7s %-9s %10.3f %14lld %14lld\n", size.name, format.name, "linear", "-",
+                   linear.ms, linear.l2_miss, linear.llc_miss);
+            printf("%-6s %-6s %-7s %-9s %10.3f %14lld %14lld\n", size.name, format.name, "tiled", tile,
+                   tiled.ms, tiled.l2_miss, tiled.llc_miss);
+            if (linear.l2_miss > 0 && linear.llc_miss > 0 && tiled.l2_miss >= 0 && tiled.llc_miss >= 0)
+                printf("%-6s %-6s %-7s %-9s %10.3f %14.3f %14.3f\n", size.name, format.name, "ratio", "",
+                       tiled.ms / linear.ms, (double) tiled.l2_miss / linear.l2_miss,
+                       (double) tiled.llc_miss / linear.llc_miss);
+            else
+                printf("%-6s %-6s %-7s %-9s %10.3f %14s %14s\n", size.name, format.name, "ratio", "",
+                       tiled.ms / linear.ms, "-", "-");
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,792 @@
+/* remap 微基准：不经过 GStreamer，直接用元素的表生成与 remap 代码处理合成帧。
+ *
+ *   bench-undistort [--sizes 720p,1080p,4K,8MP] [--formats GRAY8,NV12,I420,BGR,BGRx]
+ *                   [--backends opencv,simd,mesh,idc] [--threads 1,N] [--warmup N] [--reps N]
+ *                   [--isa scalar|sse41|avx2|avx512] [--mesh-step XxY] [--json]
+ *                   [--input FILE] [--check] [--reference FILE] [--baseline FILE] ...
+ *
+ * 标定参数取元素文档的例子（1280x720：fx=fy=800 cx=640 cy=360 k1=-0.2 k2=0.1），
+ * 按宽度缩放焦距、主点取图像中心。与元素相同的组合：
+ *  - opencv : cv::remap，map-format float32 / fixed / nearest 各测一次；与元素一样整帧调用，
+ *             threads 作为 OpenCV 自己的线程数（cv::setNumThreads）
+ *  - simd   : fixed 表 + 专用内核，按块遍历（gstundistort_tiles）
+ *  - mesh   : 稀疏网格 + 专用内核
+ *  - idc    : 只在编译了 IDC 后端时有（没有厂商库时是它的 CPU 实现），只测 NV12；网格用元素的默认步长
+ *             16x8（--mesh-step 不适用），整帧交给 IDC、不分条带（threads 无效），输出按元素 pool 的
+ *             对齐布局分配，IDC 直接写入
+ * 只测同格式 remap（亮度用全分辨率表，4:2:0 色度用半分辨率表），不含融合格式转换。
+ * mesh 与 idc 的网格同元素一样直接在采样点上求值，不生成稠密表。
+ * 每个组合先建表（build_ms，含分块），再预热 warmup 帧、计时 reps 帧，
+ * 按中位数给出 Mpix/s 与 ns/pixel（以输出像素计）。
+ * 默认输出 CSV（# 开头的行为说明），--json 时每个组合一行 JSON；
+ * 末尾的 psnr_db,max_err,status 在没有做检查时为 "-"。
+ *
+ * 只测 remap 内核与表；元素本身（协商、pool、请求 pad、格式转换）的像素与吞吐回归在
+ * tests/ 里，由 meson test 运行。
+ *
+ * 回归检查（任何一项不通过时退出码为 1）：
+ *  --input FILE        用真实图像（例如仓库里的 distort.jpg）代替合成帧，尺寸取图像尺寸（裁成偶数）
+ *  --fx/--fy/--cx/--cy/--k1/--k2/--p1/--p2/--k3 V  标定参数（默认同上，按宽度缩放）
+ *  --check             像素检查：每个组合的输出与参考比较，给出 PSNR 与最大误差
+ *                        opencv/float32 为参考；opencv/fixed 与参考最大误差 <= 1；
+ *                        simd/fixed 与 opencv/fixed 逐位一致；mesh >= 40 dB；nearest >= 30 dB；
+ *                        另外每个尺寸比较直接按相机模型求值的网格与先生成稠密表再采样的网格，差 <= 0.001 像素
+ *  --reference FILE    BGR 的 opencv/float32 输出再与这张图比较（必须是同一输入用这组标定矫正后的图，
+ *                      仓库里的 undistort.jpg 是另外拍的照片，不能用），PSNR 不低于 --min-psnr（默认 30 dB，JPEG 有损）
+ *  --baseline FILE     之前保存的 CSV 输出；同一组合的 Mpix/s 比基线低 --tolerance（默认 10）% 以上时失败 */
+
+#include "gstundistort_kernels.h"
+#include "gstundistort_maps.h"
+#include "gstundistort_mesh.h"
+#include "gstundistort_pool.h"
+#include "gstundistort_tiles.h"
+#ifdef HAVE_IDC
+#include "gstundistort_backend.h"
+#include "gstundistort_idc.h"
+#endif
+
+#include <opencv2/opencv.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <strings.h>
+#include <vector>
+
+typedef struct {
+    const char *name;
+    int width, height;
+} BenchSize;
+
+/* 一个平面：分量数、使用的表（0 亮度 / 1 色度）与相对亮度的下采样 */
+typedef struct {
+    int channels;
+    int table;
+    int sub;
+} BenchPlane;
+
+typedef struct {
+    const char *name;
+    int n_planes;
+    BenchPlane planes[3];
+} BenchFormat;
+
+typedef enum {
+    BENCH_BACKEND_OPENCV,
+    BENCH_BACKEND_SIMD,
+    BENCH_BACKEND_MESH,
+    BENCH_BACKEND_IDC,
+} BenchBackend;
+
+typedef struct {
+    BenchBackend backend;
+    const char *backend_name;
+    UndistortMapType map_type;
+    const char *map_name;
+} BenchCombo;
+
+static const BenchSize all_sizes[] = {
+    {"720p", 1280, 720}, {"1080p", 1920, 1080}, {"4K", 3840, 2160}, {"8MP", 3264, 2448},
+};
+
+static const BenchFormat all_formats[] = {
+    {"GRAY8", 1, {{1, 0, 1}}},
+    {"NV12", 2, {{1, 0, 1}, {2, 1, 2}}},
+    {"I420", 3, {{1, 0, 1}, {1, 1, 2}, {1, 1, 2}}},
+    {"BGR", 1, {{3, 0, 1}}},
+    {"BGRx", 1, {{4, 0, 1}}},
+};
+
+static const BenchCombo all_combos[] = {
+    {BENCH_BACKEND_OPENCV, "opencv", UNDISTORT_MAP_FLOAT32, "float32"},
+    {BENCH_BACKEND_OPENCV, "opencv", UNDISTORT_MAP_FIXED, "fixed"},
+    {BENCH_BACKEND_OPENCV, "opencv", UNDISTORT_MAP_NEAREST, "nearest"},
+    {BENCH_BACKEND_SIMD, "simd", UNDISTORT_MAP_FIXED, "fixed"},
+    {BENCH_BACKEND_MESH, "mesh", UNDISTORT_MAP_MESH, "mesh"},
+#ifdef HAVE_IDC
+    {BENCH_BACKEND_IDC, "idc", UNDISTORT_MAP_MESH, "mesh"},
+#endif
+};
+
+/* 一个组合的表：亮度/色度两张，simd 另有块网格 */
+typedef struct {
+    UndistortPlaneMap maps[2];
+    UndistortTileGrid tiles[2];
+    size_t mesh_row_size;
+} BenchTables;
+
+/* 一帧的条带任务，同元素的 gst_undistort_remap_band（只读） */
+typedef struct {
+    const BenchFormat *format;
+    const BenchCombo *combo;
+    const BenchTables *tables;
+    cv::Mat src[3], dst[3];
+    UndistortRemapRowFunc kernels[3];
+    uint8_t *mesh_rows;
+    unsigned n_bands;
+#ifdef HAVE_IDC
+    UndistortIdc *idc; // idc 组合的上下文，其他组合为 NULL
+#endif
+} BenchJob;
+
+typedef struct {
+    double build_ms;
+    size_t table_bytes;
+    double median_ms, min_ms, max_ms;
+    cv::Mat out[3]; // 最后一帧的输出，--check 时使用
+} BenchResult;
+
+typedef struct {
+    double fx, fy, cx, cy; // fx <= 0 表示按文档例子缩放，cx/cy < 0 表示图像中心
+    double k1, k2, p1, p2, k3;
+} BenchCalib;
+
+/* 像素检查：与 reference 组合的输出比较，PSNR 不低于 min_psnr 且最大误差不超过 max_err */
+typedef struct {
+    int reference; // all_combos 的下标，-1 表示这就是参考
+    double min_psnr;
+    int max_err;
+} BenchCheck;
+
+/* 与 all_combos 一一对应 */
+static const BenchCheck all_checks[] = {
+    {-1, 0, 255},
+    {0, 0, 1},
+    {0, 30, 255},
+    {1, 0, 0},
+    {0, 40, 255},
+#ifdef HAVE_IDC
+    {0, 35, 255}, // 色度网格由亮度网格近似推导
+#endif
+};
+
+/* 逗号分隔的名字列表里是否有 name；list 为空表示全选 */
+static bool
+selected(const std::string &list, const char *name) {
+    if (list.empty())
+        return true;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        const size_t end = std::min(list.find(',', pos), list.size());
+        if (!strcasecmp(list.substr(pos, end - pos).c_str(), name))
+            return true;
+        pos = end + 1;
+    }
+    return false;
+}
+
+static double
+elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+/* 文档例子的标定按分辨率缩放 */
+static void
+bench_camera(const BenchSize *size, const BenchCalib *calib, cv::Mat *K, cv::Mat *D) {
+    const double s = size->width / 1280.0;
+    *K = (cv::Mat_<double>(3, 3) << 800 * s, 0, size->width / 2.0,
+                                    0, 800 * s, size->height / 2.0,
+                                    0, 0, 1);
+    if (calib->fx > 0) {
+        K->at<double>(0, 0) = calib->fx;
+        K->at<double>(1, 1) = calib->fy > 0 ? calib->fy : calib->fx;
+    }
+    if (calib->cx >= 0)
+        K->at<double>(0, 2) = calib->cx;
+    if (calib->cy >= 0)
+        K->at<double>(1, 2) = calib->cy;
+    *D = (cv::Mat_<double>(1, 5) << calib->k1, calib->k2, calib->p1, calib->p2, calib->k3);
+}
+
+/* 网格直接在采样点上按相机模型求值（与元素固定步长时相同），chroma 为空时只生成亮度 */
+static void
+build_mesh_sampled(const cv::Mat &K, const cv::Mat &D, cv::Size luma, bool chroma, int step_x, int step_y,
+                   UndistortMesh *luma_mesh, UndistortMesh *chroma_mesh) {
+    cv::Mat gx, gy;
+    undistort_maps_init_grid(UNDISTORT_MODEL_PINHOLE, K, D, cv::Mat(), K,
+                             undistort_mesh_sample_coords(luma.width, step_x),
+                             undistort_mesh_sample_coords(luma.height, step_y), gx, gy);
+    undistort_mesh_build_sampled(luma_mesh, luma.width, luma.height, step_x, step_y, gx, gy);
+    if (!chroma)
+        return;
+    const cv::Size csize((luma.width + 1) / 2, (luma.height + 1) / 2);
+    undistort_maps_init_chroma_grid(UNDISTORT_MODEL_PINHOLE, K, D, cv::Mat(), K, luma, 2,
+                                    undistort_mesh_sample_coords(csize.width, step_x),
+                                    undistort_mesh_sample_coords(csize.height, step_y), gx, gy);
+    undistort_mesh_build_sampled(chroma_mesh, csize.width, csize.height, step_x, step_y, gx, gy);
+}
+
+/* --check：按采样点直接求值的网格与先生成稠密表再采样的网格之差（像素，亮度与色度取大） */
+static double
+check_mesh_sampling(const BenchSize *size, const BenchCalib *calib, int step_x, int step_y) {
+    cv::Mat K, D;
+    bench_camera(size, calib, &K, &D);
+    const cv::Size luma(size->width, size->height);
+
+    UndistortMesh sampled[2], dense[2];
+    build_mesh_sampled(K, D, luma, true, step_x, step_y, &sampled[0], &sampled[1]);
+    cv::Mat mapx, mapy, cmapx, cmapy;
+    undistort_maps_init(UNDISTORT_MODEL_PINHOLE, K, D, cv::Mat(), K, luma, mapx, mapy);
+    undistort_mesh_build(&dense[0], mapx, mapy, step_x, step_y);
+    undistort_maps_derive_chroma(mapx, mapy, cv::Size((luma.width + 1) / 2, (luma.height + 1) / 2), 2, cmapx, cmapy);
+    undistort_mesh_build(&dense[1], cmapx, cmapy, step_x, step_y);
+
+    double max_diff = 0.0;
+    for (int t = 0; t < 2; ++t) {
+        if (sampled[t].xy.size() != dense[t].xy.size())
+            return HUGE_VAL;
+        for (size_t i = 0; i < dense[t].xy.size(); ++i)
+            max_diff = std::max(max_diff, (double) std::fabs(sampled[t].xy[i] - dense[t].xy[i]));
+    }
+    return max_diff;
+}
+
+/* 表的生成与元素相同（原视场，输出尺寸 = 输入尺寸） */
+static void
+build_tables(const BenchSize *size, const BenchFormat *format, const BenchCombo *combo, const BenchCalib *calib,
+             int mesh_step_x, int mesh_step_y, BenchTables *tables) {
+    cv::Mat K, D;
+    bench_camera(size, calib, &K, &D);
+    const cv::Size luma(size->width, size->height);
+#ifdef HAVE_IDC
+    if (combo->backend == BENCH_BACKEND_IDC) {
+        mesh_step_x = UNDISTORT_IDC_STEP_X;
+        mesh_step_y = UNDISTORT_IDC_STEP_Y;
+    }
+#endif
+
+    int bytes_per_pixel[2] = {0, 0};
+    for (int p = 0; p < format->n_planes; ++p)
+        bytes_per_pixel[format->planes[p].table] += format->planes[p].channels;
+    /* IDC 只用亮度网格，色度网格由它自己推导 */
+    const bool chroma = bytes_per_pixel[1] > 0 && combo->backend != BENCH_BACKEND_IDC;
+
+    if (combo->map_type == UNDISTORT_MAP_MESH) {
+        build_mesh_sampled(K, D, luma, chroma, mesh_step_x, mesh_step_y, &tables->maps[0].mesh,
+                           &tables->maps[1].mesh);
+        tables->mesh_row_size = undistort_mesh_row_buffer_size(&tables->maps[0].mesh);
+        return;
+    }
+
+    cv::Mat mapx, mapy;
+    undistort_maps_init(UNDISTORT_MODEL_PINHOLE, K, D, cv::Mat(), K, luma, mapx, mapy);
+    undistort_plane_map_from_float(&tables->maps[0], mapx, mapy, combo->map_type, mesh_step_x, mesh_step_y);
+    if (chroma) {
+        cv::Mat cmapx, cmapy;
+        undistort_maps_derive_chroma(mapx, mapy, cv::Size((luma.width + 1) / 2, (luma.height + 1) / 2), 2,
+                                     cmapx, cmapy);
+        undistort_plane_map_from_float(&tables->maps[1], cmapx, cmapy, combo->map_type, mesh_step_x, mesh_step_y);
+    }
+
+    tables->mesh_row_size = 0;
+    if (combo->backend != BENCH_BACKEND_SIMD)
+        return;
+    const size_t budget = undistort_tiles_l2_size() / 2;
+    for (int t = 0; t < 2; ++t) {
+        const UndistortPlaneMap *map = &tables->maps[t];
+        if (map->map1.empty() || map->map2.empty())
+            continue;
+        const int sub = t == 1 ? 2 : 1;
+        undistort_tiles_build(&tables->tiles[t], map->map1.ptr<int16_t>(), map->map1.step[0] / sizeof(int16_t),
+                              map->map1.cols, map->map1.rows, (size->width + sub - 1) / sub,
+                              (size->height + sub - 1) / sub, bytes_per_pixel[t], budget, 0, 0);
+    }
+}
+
+static void
+remap_band(void *user_data, unsigned band, unsigned worker) {
+    auto *job = (BenchJob *) user_data;
+    uint8_t *mesh_rows = job->mesh_rows + (size_t) worker * job->tables->mesh_row_size;
+
+    for (int p = 0; p < job->format->n_planes; ++p) {
+        const int table = job->format->planes[p].table;
+        const UndistortPlaneMap *map = &job->tables->maps[table];
+        const UndistortTileGrid *grid = &job->tables->tiles[table];
+        const cv::Mat &src = job->src[p];
+        const cv::Mat &dst = job->dst[p];
+        const UndistortSrcPlane splane = {src.data, src.step[0], src.cols, src.rows};
+        const int y0 = (int) ((long long) dst.rows * band / job->n_bands);
+        const int y1 = (int) ((long long) dst.rows * (band + 1) / job->n_bands);
+
+        if (y0 == y1)
+            continue;
+        switch (job->combo->backend) {
+            case BENCH_BACKEND_MESH:
+                undistort_mesh_remap_rows(&map->mesh, job->kernels[p], &splane, dst.data, dst.step[0], y0, y1,
+                                          mesh_rows);
+                break;
+            case BENCH_BACKEND_SIMD:
+                if (!grid->tiles.empty()) {
+                    undistort_tiles_remap(grid, job->kernels[p], &splane, job->format->planes[p].channels,
+                                          dst.data, dst.step[0], map->map1.ptr<int16_t>(),
+                                          map->map1.step[0] / sizeof(int16_t), map->map2.ptr<uint16_t>(),
+                                          map->map2.step[0] / sizeof(uint16_t),
+                                          (int) ((long long) grid->rows * band / job->n_bands),
+                                          (int) ((long long) grid->rows * (band + 1) / job->n_bands));
+                } else {
+                    undistort_remap_rows(job->kernels[p], &splane, dst.data, dst.step[0], dst.cols,
+                                         map->map1.ptr<int16_t>(), map->map1.step[0] / sizeof(int16_t),
+                                         map->map2.ptr<uint16_t>(), map->map2.step[0] / sizeof(uint16_t), y0, y1);
+                }
+                break;
+            default:
+                /* opencv 与 idc 整帧处理，不进条带（remap_frame） */
+                break;
+        }
+    }
+}
+
+/* 一帧：idc 整帧交给 IDC；opencv 与元素一样每个平面整帧调用 cv::remap（用 OpenCV 自己的线程，
+ * 线程数在 run 里按 --threads 设置）；其他组合按条带并行 */
+static void
+remap_frame(UndistortWorkerPool *pool, BenchJob *job) {
+    if (job->combo->backend == BENCH_BACKEND_OPENCV) {
+        for (int p = 0; p < job->format->n_planes; ++p) {
+            const UndistortPlaneMap *map = &job->tables->maps[job->format->planes[p].table];
+            cv::remap(job->src[p], job->dst[p], map->map1, map->map2, map->interp);
+        }
+        return;
+    }
+#ifdef HAVE_IDC
+    if (job->idc) {
+        std::string why;
+        if (!undistort_idc_process(job->idc, job->src[0].data, job->src[0].step[0], job->src[1].data,
+                                   job->src[1].step[0], job->dst[0].data, job->dst[0].step[0], job->dst[1].data,
+                                   job->dst[1].step[0], &why)) {
+            fprintf(stderr, "idc: %s\n", why.c_str());
+            exit(1);
+        }
+        return;
+    }
+#endif
+    pool->run(job->n_bands, remap_band, job);
+}
+
+/* 把 BGR 图像转成 format 的各平面（4:2:0 经 OpenCV 的 I420 转换） */
+static void
+image_planes(const cv::Mat &bgr, const BenchFormat *format, cv::Mat *planes) {
+    const int w = bgr.cols, h = bgr.rows;
+
+    if (!strcmp(format->name, "GRAY8")) {
+        cv::cvtColor(bgr, planes[0], cv::COLOR_BGR2GRAY);
+    } else if (!strcmp(format->name, "BGR")) {
+        planes[0] = bgr.clone();
+    } else if (!strcmp(format->name, "BGRx")) {
+        cv::cvtColor(bgr, planes[0], cv::COLOR_BGR2BGRA);
+    } else {
+        cv::Mat yuv;
+        cv::cvtColor(bgr, yuv, cv::COLOR_BGR2YUV_I420);
+        planes[0] = yuv.rowRange(0, h).clone();
+        const cv::Mat u(h / 2, w / 2, CV_8UC1, yuv.ptr(h));
+        const cv::Mat v(h / 2, w / 2, CV_8UC1, yuv.ptr(h) + (size_t) (w / 2) * (h / 2));
+        if (format->n_planes == 3) {
+            planes[1] = u.clone();
+            planes[2] = v.clone();
+        } else {
+            cv::merge(std::vector<cv::Mat>{u, v}, planes[1]);
+        }
+    }
+}
+
+static BenchResult
+run(const BenchSize *size, const BenchFormat *format, const BenchCombo *combo, const BenchCalib *calib,
+    const cv::Mat &image, unsigned threads, UndistortIsa isa, int warmup, int reps, int mesh_step_x,
+    int mesh_step_y) {
+    BenchResult r;
+    BenchTables tables;
+    const auto build_start = std::chrono::steady_clock::now();
+    build_tables(size, format, combo, calib, mesh_step_x, mesh_step_y, &tables);
+    r.build_ms = elapsed_ms(build_start);
+    r.table_bytes = undistort_plane_map_bytes(&tables.maps[0]) + undistort_plane_map_bytes(&tables.maps[1]);
+
+    UndistortWorkerPool pool(threads);
+    BenchJob job;
+    job.format = format;
+    job.combo = combo;
+    job.tables = &tables;
+    job.n_bands = std::min(pool.size(), (unsigned) size->height);
+    std::vector<uint8_t> mesh_rows(pool.size() * tables.mesh_row_size);
+    job.mesh_rows = mesh_rows.data();
+    if (!image.empty())
+        image_planes(image, format, job.src);
+    for (int p = 0; p < format->n_planes; ++p) {
+        const BenchPlane *plane = &format->planes[p];
+        const int w = (size->width + plane->sub - 1) / plane->sub;
+        const int h = (size->height + plane->sub - 1) / plane->sub;
+        job.dst[p].create(h, w, CV_8UC(plane->channels));
+        job.kernels[p] = undistort_kernels_get(plane->channels, isa);
+        if (!image.empty())
+            continue;
+        job.src[p].create(h, w, CV_8UC(plane->channels));
+        uint8_t *data = job.src[p].data;
+        const size_t n = job.src[p].total() * job.src[p].elemSize();
+        for (size_t i = 0; i < n; ++i)
+            data[i] = (uint8_t) ((i + p) * 2654435761u >> 24);
+    }
+#ifdef HAVE_IDC
+    /* idc：输出按元素 pool 的布局分配（64 字节 stride，UV 从 8 行对齐的高度开始），IDC 直接写入 */
+    std::unique_ptr<UndistortIdc, void (*)(UndistortIdc *)> idc(nullptr, undistort_idc_free);
+    std::vector<uint8_t> idc_frame;
+    job.idc = NULL;
+    if (combo->backend == BENCH_BACKEND_IDC) {
+        std::string why;
+        idc.reset(undistort_idc_new(size->width, size->height, &tables.maps[0].mesh, &why));
+        if (!idc) {
+            fprintf(stderr, "idc: %s\n", why.c_str());
+            exit(1);
+        }
+        const size_t stride = (size_t) (size->width + 63) & ~(size_t) 63;
+        const size_t hstride = (size_t) (size->height + UNDISTORT_IDC_DST_HEIGHT_ALIGN - 1) &
+                               ~(size_t) (UNDISTORT_IDC_DST_HEIGHT_ALIGN - 1);
+        idc_frame.resize(stride * hstride * 3 / 2);
+        job.dst[0] = cv::Mat(size->height, size->width, CV_8UC1, idc_frame.data(), stride);
+        job.dst[1] = cv::Mat((size->height + 1) / 2, (size->width + 1) / 2, CV_8UC2,
+                             idc_frame.data() + stride * hstride, stride);
+        job.idc = idc.get();
+    }
+#endif
+
+    /* opencv 组合的线程数对应 OpenCV 的线程池（bench 自己的进程，改全局设置没有副作用），测完恢复默认 */
+    if (combo->backend == BENCH_BACKEND_OPENCV)
+        cv::setNumThreads((int) pool.size());
+    std::vector<double> times;
+    for (int i = -warmup; i < reps; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        remap_frame(&pool, &job);
+        if (i >= 0)
+            times.push_back(elapsed_ms(start));
+    }
+    if (combo->backend == BENCH_BACKEND_OPENCV)
+        cv::setNumThreads(-1);
+    std::sort(times.begin(), times.end());
+    r.median_ms = times[times.size() / 2];
+    r.min_ms = times.front();
+    r.max_ms = times.back();
+    for (int p = 0; p < format->n_planes; ++p)
+        r.out[p] = job.dst[p];
+    return r;
+}
+
+/* 所有平面合起来的 PSNR（完全一致时为无穷大）与最大绝对误差 */
+static void
+compare_planes(const cv::Mat *a, const cv::Mat *b, int n_planes, double *psnr, int *max_err) {
+    double sse = 0, count = 0, max = 0;
+    for (int p = 0; p < n_planes; ++p) {
+        cv::Mat diff;
+        cv::absdiff(a[p], b[p], diff);
+        diff = diff.reshape(1);
+        double m;
+        cv::minMaxLoc(diff, NULL, &m);
+        max = std::max(max, m);
+        diff.convertTo(diff, CV_64F);
+        sse += diff.dot(diff);
+        count += (double) diff.total();
+    }
+    *max_err = (int) max;
+    *psnr = sse > 0 ? 10.0 * log10(255.0 * 255.0 * count / sse) : INFINITY;
+}
+
+/* 基线 CSV：size,format,backend,map_format,threads -> Mpix/s */
+typedef struct {
+    std::string key;
+    double mpix_s;
+} BenchBaseline;
+
+static std::string
+baseline_key(const char *size, const char *format, const char *backend, const char *map, unsigned threads) {
+    return std::string(size) + "," + format + "," + backend + "," + map + "," + std::to_string(threads);
+}
+
+static bool
+load_baseline(const char *path, std::vector<BenchBaseline> *baseline) {
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return false;
+    char line[1024];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || !strncmp(line, "size,", 5))
+            continue;
+        std::vector<std::string> cols;
+        for (char *tok = strtok(line, ",\n"); tok; tok = strtok(NULL, ",\n"))
+            cols.emplace_back(tok);
+        if (cols.size() < 14)
+            continue;
+        baseline->push_back({baseline_key(cols[0].c_str(), cols[3].c_str(), cols[4].c_str(), cols[5].c_str(),
+                                          (unsigned) atoi(cols[6].c_str())), atof(cols[13].c_str())});
+    }
+    fclose(f);
+    return true;
+}
+
+/* 逗号分隔的线程数，0 表示按 CPU 核数；重复的只保留一个 */
+static std::vector<unsigned>
+parse_threads(const char *list) {
+    std::vector<unsigned> out;
+    for (const char *p = list; *p;) {
+        const unsigned n = UndistortWorkerPool::resolve_threads((unsigned) strtoul(p, NULL, 10));
+        if (std::find(out.begin(), out.end(), n) == out.end())
+            out.push_back(n);
+        p = strchr(p, ',');
+        if (!p)
+            break;
+        ++p;
+    }
+    return out;
+}
+
+/* 一行结果；psnr/max_err 为 NaN/-1 表示没有比较 */
+static void
+print_row(bool json, const BenchSize *size, const BenchFormat *format, const BenchCombo *combo, unsigned threads,
+          UndistortIsa isa, const BenchResult *r, double psnr, int max_err, const char *status) {
+    const double pixels = (double) size->width * size->height;
+    const double mpix_s = pixels / (r->median_ms * 1e3);
+    const double ns_px = r->median_ms * 1e6 / pixels;
+    char psnr_str[32] = "-", err_str[16] = "-";
+    if (!std::isnan(psnr))
+        snprintf(psnr_str, sizeof(psnr_str), std::isinf(psnr) ? "inf" : "%.2f", psnr);
+    if (max_err >= 0)
+        snprintf(err_str, sizeof(err_str), "%d", max_err);
+
+    if (json) {
+        printf("{\"size\":\"%s\",\"width\":%d,\"height\":%d,\"format\":\"%s\",\"backend\":\"%s\","
+               "\"map_format\":\"%s\",\"threads\":%u,\"isa\":\"%s\",\"build_ms\":%.3f,"
+               "\"table_bytes\":%zu,\"median_ms\":%.4f,\"min_ms\":%.4f,\"max_ms\":%.4f,"
+               "\"mpix_s\":%.2f,\"ns_px\":%.4f,\"psnr_db\":\"%s\",\"max_err\":\"%s\",\"status\":\"%s\"}\n",
+               size->name, size->width, size->height, format->name, combo->backend_name, combo->map_name, threads,
+               undistort_isa_name(isa), r->build_ms, r->table_bytes, r->median_ms, r->min_ms, r->max_ms, mpix_s,
+               ns_px, psnr_str, err_str, status);
+    } else {
+        printf("%s,%d,%d,%s,%s,%s,%u,%s,%.3f,%zu,%.4f,%.4f,%.4f,%.2f,%.4f,%s,%s,%s\n", size->name, size->width,
+               size->height, format->name, combo->backend_name, combo->map_name, threads, undistort_isa_name(isa),
+               r->build_ms, r->table_bytes, r->median_ms, r->min_ms, r->max_ms, mpix_s, ns_px, psnr_str, err_str,
+               status);
+    }
+    fflush(stdout);
+}
+
+/* 读图并裁成偶数宽高（4:2:0） */
+static cv::Mat
+load_image(const char *path) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_COLOR);
+    if (image.empty())
+        return image;
+    return image(cv::Rect(0, 0, image.cols & ~1, image.rows & ~1)).clone();
+}
+
+int
+main(int argc, char **argv) {
+    std::string sizes, formats, backends;
+    std::vector<unsigned> threads = parse_threads("1,0");
+    int warmup = 3, reps = 20;
+    int mesh_step_x = 16, mesh_step_y = 8;
+    bool json = false, check = false;
+    const char *input = NULL, *reference = NULL, *baseline_path = NULL;
+    double min_psnr = 30.0, tolerance = 10.0;
+    BenchCalib calib = {0, 0, -1, -1, -0.2, 0.1, 0, 0, 0};
+    UndistortIsa isa = undistort_kernels_detect_isa();
+
+    for (int i = 1; i < argc; ++i) {
+        static const struct {
+            const char *name;
+            size_t offset;
+        } calib_args[] = {
+            {"--fx", offsetof(BenchCalib, fx)}, {"--fy", offsetof(BenchCalib, fy)},
+            {"--cx", offsetof(BenchCalib, cx)}, {"--cy", offsetof(BenchCalib, cy)},
+            {"--k1", offsetof(BenchCalib, k1)}, {"--k2", offsetof(BenchCalib, k2)},
+            {"--p1", offsetof(BenchCalib, p1)}, {"--p2", offsetof(BenchCalib, p2)},
+            {"--k3", offsetof(BenchCalib, k3)},
+        };
+        bool calib_arg = false;
+        for (const auto &a: calib_args) {
+            if (!strcmp(argv[i], a.name) && i + 1 < argc) {
+                *(double *) ((char *) &calib + a.offset) = atof(argv[++i]);
+                calib_arg = true;
+            }
+        }
+        if (calib_arg) {
+            continue;
+        } else if (!strcmp(argv[i], "--sizes") && i + 1 < argc) {
+            sizes = argv[++i];
+        } else if (!strcmp(argv[i], "--formats") && i + 1 < argc) {
+            formats = argv[++i];
+        } else if (!strcmp(argv[i], "--backends") && i + 1 < argc) {
+            backends = argv[++i];
+        } else if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+            threads = parse_threads(argv[++i]);
+        } else if (!strcmp(argv[i], "--warmup") && i + 1 < argc) {
+            warmup = std::max(0, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--reps") && i + 1 < argc) {
+            reps = std::max(1, atoi(argv[++i]));
+        } else if (!strcmp(argv[i], "--mesh-step") && i + 1 < argc &&
+                   sscanf(argv[i + 1], "%dx%d", &mesh_step_x, &mesh_step_y) == 2) {
+            ++i;
+        } else if (!strcmp(argv[i], "--isa") && i + 1 < argc) {
+            const char *name = argv[++i];
+            for (int v = UNDISTORT_ISA_SCALAR; v <= UNDISTORT_ISA_AVX512; ++v) {
+                if (!strcmp(name, undistort_isa_name((UndistortIsa) v)))
+                    isa = std::min(isa, (UndistortIsa) v);
+            }
+        } else if (!strcmp(argv[i], "--json")) {
+            json = true;
+        } else if (!strcmp(argv[i], "--check")) {
+            check = true;
+        } else if (!strcmp(argv[i], "--input") && i + 1 < argc) {
+            input = argv[++i];
+        } else if (!strcmp(argv[i], "--reference") && i + 1 < argc) {
+            reference = argv[++i];
+        } else if (!strcmp(argv[i], "--min-psnr") && i + 1 < argc) {
+            min_psnr = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--baseline") && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (!strcmp(argv[i], "--tolerance") && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [--sizes 720p,1080p,4K,8MP] [--formats GRAY8,NV12,I420,BGR,BGRx]\n"
+                            "       [--backends opencv,simd,mesh,idc] [--threads 1,N (0 = all cores)] [--warmup N]\n"
+                            "       [--reps N] [--isa scalar|sse41|avx2|avx512] [--mesh-step XxY] [--json]\n"
+                            "       [--input IMAGE] [--fx V --fy V --cx V --cy V --k1 V --k2 V --p1 V --p2 V --k3 V]\n"
+                            "       [--check] [--reference IMAGE [--min-psnr DB]] [--baseline CSV [--tolerance PCT]]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (mesh_step_x < 2 || mesh_step_y < 2) {
+        fprintf(stderr, "mesh step must be at least 2x2\n");
+        return 1;
+    }
+
+    /* 真实图像代替合成帧时只测这一个尺寸 */
+    std::vector<BenchSize> size_list;
+    cv::Mat image, golden;
+    if (input) {
+        image = load_image(input);
+        if (image.empty()) {
+            fprintf(stderr, "cannot read %s\n", input);
+            return 1;
+        }
+        size_list.push_back({"image", image.cols, image.rows});
+    } else {
+        for (const BenchSize &size: all_sizes) {
+            if (selected(sizes, size.name))
+                size_list.push_back(size);
+        }
+    }
+    if (reference) {
+        golden = load_image(reference);
+        if (golden.empty()) {
+            fprintf(stderr, "cannot read %s\n", reference);
+            return 1;
+        }
+    }
+    std::vector<BenchBaseline> baseline;
+    if (baseline_path && !load_baseline(baseline_path, &baseline)) {
+        fprintf(stderr, "cannot read %s\n", baseline_path);
+        return 1;
+    }
+
+    if (!json) {
+        printf("# isa=%s l2=%zu warmup=%d reps=%d mesh_step=%dx%d input=%s calib=fx=%g fy=%g cx=%g cy=%g "
+               "k1=%g k2=%g p1=%g p2=%g k3=%g (fx 0: 800*w/1280, c -1: centre)\n",
+               undistort_isa_name(isa), undistort_tiles_l2_size(), warmup, reps, mesh_step_x, mesh_step_y,
+               input ? input : "synthetic", calib.fx, calib.fy, calib.cx, calib.cy, calib.k1, calib.k2, calib.p1,
+               calib.p2, calib.k3);
+        printf("size,width,height,format,backend,map_format,threads,isa,build_ms,table_bytes,"
+               "median_ms,min_ms,max_ms,mpix_s,ns_px,psnr_db,max_err,status\n");
+    }
+
+    const size_t n_combos = sizeof(all_combos) / sizeof(all_combos[0]);
+    int failures = 0;
+    for (const BenchSize &size: size_list) {
+        if (check) {
+            /* 阈值远小于网格本身的插值误差，只允许 float 舍入 */
+            const double diff = check_mesh_sampling(&size, &calib, mesh_step_x, mesh_step_y);
+            if (!json)
+                printf("# %s mesh sampled from the model vs dense map: max difference %.6f px\n", size.name, diff);
+            if (!(diff <= 1e-3)) {
+                fprintf(stderr, "%s: sampled mesh differs from the dense-map mesh by %.6f px (max 0.001)\n",
+                        size.name, diff);
+                ++failures;
+            }
+        }
+        for (const BenchFormat &format: all_formats) {
+            if (!selected(formats, format.name))
+                continue;
+            /* 每个组合第一次运行的输出，供依赖它的组合比较；参考没被选中时单独跑一帧 */
+            std::vector<std::vector<cv::Mat>> outputs(n_combos);
+            for (size_t c = 0; c < n_combos; ++c) {
+                const BenchCombo *combo = &all_combos[c];
+                if (!selected(backends, combo->backend_name))
+                    continue;
+                /* IDC 只支持 NV12 */
+                if (combo->backend == BENCH_BACKEND_IDC && strcmp(format.name, "NV12"))
+                    continue;
+                const BenchCheck *rule = &all_checks[c];
+                if (check && rule->reference >= 0 && outputs[rule->reference].empty()) {
+                    const BenchResult ref = run(&size, &format, &all_combos[rule->reference], &calib, image, 1,
+                                                isa, 0, 1, mesh_step_x, mesh_step_y);
+                    outputs[rule->reference].assign(ref.out, ref.out + format.n_planes);
+                }
+                for (unsigned n: threads) {
+                    const BenchResult r = run(&size, &format, combo, &calib, image, n, isa, warmup, reps,
+                                              mesh_step_x, mesh_step_y);
+                    if (outputs[c].empty())
+                        outputs[c].assign(r.out, r.out + format.n_planes);
+
+                    double psnr = NAN;
+                    int max_err = -1;
+                    const char *status = "-";
+                    if (check && rule->reference >= 0) {
+                        compare_planes(r.out, outputs[rule->reference].data(), format.n_planes, &psnr, &max_err);
+                        const bool ok = psnr >= rule->min_psnr && max_err <= rule->max_err;
+                        status = ok ? "ok" : "FAIL";
+                        if (!ok) {
+                            fprintf(stderr, "%s %s %s/%s threads %u: PSNR %.2f dB (min %.0f), max error %d "
+                                            "(max %d) against %s/%s\n", size.name, format.name,
+                                    combo->backend_name, combo->map_name, n, psnr, rule->min_psnr, max_err,
+                                    rule->max_err, all_combos[rule->reference].backend_name,
+                                    all_combos[rule->reference].map_name);
+                            ++failures;
+                        }
+                    }
+                    if (!golden.empty() && rule->reference < 0 && !strcmp(format.name, "BGR")) {
+                        if (golden.size() != r.out[0].size()) {
+                            fprintf(stderr, "reference %dx%d does not match output %dx%d\n", golden.cols,
+                                    golden.rows, r.out[0].cols, r.out[0].rows);
+                            return 1;
+                        }
+                        compare_planes(r.out, &golden, 1, &psnr, &max_err);
+                        status = psnr >= min_psnr ? "ok" : "FAIL";
+                        if (psnr < min_psnr) {
+                            fprintf(stderr, "%s: PSNR %.2f dB against %s (min %.0f)\n", size.name, psnr,
+                                    reference, min_psnr);
+                            ++failures;
+                        }
+                    }
+                    if (!baseline.empty()) {
+                        const double mpix_s = (double) size.width * size.height / (r.median_ms * 1e3);
+                        const std::string key = baseline_key(size.name, format.name, combo->backend_name,
+                                                             combo->map_name, n);
+                        for (const BenchBaseline &b: baseline) {
+                            if (b.key != key || mpix_s >= b.mpix_s * (1.0 - tolerance / 100.0))
+                                continue;
+                            fprintf(stderr, "%s threads %u: %.2f Mpix/s, baseline %.2f (-%.1f%%, tolerance %.0f%%)\n",
+                                    key.c_str(), n, mpix_s, b.mpix_s, 100.0 * (1.0 - mpix_s / b.mpix_s), tolerance);
+                            status = "SLOW";
+                            ++failures;
+                        }
+                    }
+                    print_row(json, &size, &format, combo, n, isa, &r, psnr, max_err, status);
+                }
+            }
+        }
+    }
+    if (failures > 0)
+        fprintf(stderr, "%d check(s) failed\n", failures);
+    return failures > 0 ? 1 : 0;
+}
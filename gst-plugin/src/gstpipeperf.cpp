@@ -0,0 +1,428 @@
+/**
+ * SECTION:tracer-pipeperf
+ *
+ * 整条管线的性能 tracer（jpegdec、videoconvert、undistort、x265enc……都能看到），
+ * 挂在 pad push/pull 上，按元素统计：
+ *  - proc：元素处理一个 buffer 的自身耗时。从上游把 buffer 推进来到 chain 返回的时间，
+ *          减去期间它向下游 push 的时间（同一线程内嵌套的 push 按线程局部栈扣除）；
+ *          queue 的 proc 是入队时阻塞的时间（队列满）
+ *  - latency：同一 PTS 的 buffer 从进入元素到离开元素的时间，queue 即排队时间
+ *  - e2e：从源元素推出到进入 sink 的端到端延迟（按顶层管线内的 PTS 匹配）
+ * 每隔 interval 毫秒输出一次这段时间内的汇总：次数、平均/最大/p99（微秒）、
+ * proc 占一个核的百分比。每次 push 只做几次原子加法与一次短临界区，可以在现场临时打开。
+ *
+ * 参数（GST_TRACERS 的括号内）：
+ *  - interval=1000 : 汇总间隔（毫秒）
+ *  - file=路径     : 写到文件；不设时写到 pipeperf 调试类别（GST_DEBUG=pipeperf:4）
+ *  - format=csv    : csv（每个元素一行）或 json（每次汇总一行）
+ *
+ * 限制：latency/e2e 按 PTS 匹配，改时间戳的元素（videorate 等）之后匹配不上；
+ * 同一顶层管线里多个源的 PTS 相同时 e2e 会混在一起。源元素自身的耗时不统计。
+ *
+ * Example:
+  GST_PLUGIN_PATH=builddir/gst-plugin GST_TRACERS="pipeperf(interval=1000,file=/tmp/perf.csv)" gst-launch-1.0 v4l2src ! jpegdec ! videoconvert ! undistort fx=800 fy=800 cx=640 cy=360 k1=-0.2 ! queue ! x265enc ! fakesink
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstpipeperf.h"
+#include "gstundistort_stats.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+GST_DEBUG_CATEGORY_STATIC(gst_pipe_perf_debug);
+#define GST_CAT_DEFAULT gst_pipe_perf_debug
+
+#define DEFAULT_INTERVAL 1000
+
+/* 最近进入元素（或从源推出）的 PTS 与时间，按 PTS 线性查找；旧的被覆盖 */
+#define PIPE_PERF_RING 64
+
+typedef struct {
+    std::mutex lock;
+    GstClockTime pts[PIPE_PERF_RING];
+    GstClockTime ts[PIPE_PERF_RING];
+    unsigned next;
+} GstPipePerfRing;
+
+/* 一个顶层管线：源推出的时间，供 sink 计算端到端延迟 */
+typedef struct {
+    GstObject *top; // 不持有引用，只作查找的键
+    GstPipePerfRing origin;
+} GstPipePerfPipeline;
+
+/* 一个元素的统计，通过 qdata 挂在元素上，元素销毁后仍由 tracer 持有（按名字输出） */
+typedef struct {
+    std::string name; // 顶层管线名/元素名
+    gboolean source, sink;
+    GstPipePerfPipeline *pipeline;
+    GstPipePerfRing enter;
+    UndistortTimerStats proc, latency, e2e; // 微秒，每次汇总后清零
+} GstPipePerfElement;
+
+struct _GstPipePerfState {
+    std::mutex lock; // 保护两个列表
+    std::vector<std::unique_ptr<GstPipePerfElement>> elements;
+    std::vector<std::unique_ptr<GstPipePerfPipeline>> pipelines;
+    std::atomic<GstClockTime> last_report;
+};
+
+/* 线程局部的 push/pull 栈：嵌套的下游 push 从上游元素的耗时里扣除 */
+typedef struct {
+    GstPipePerfElement *element; // 接收 buffer 的元素，bin/ghost pad 为 NULL
+    GstClockTime start;
+    GstClockTime child; // 嵌套 push 的总耗时
+} GstPipePerfFrame;
+
+static thread_local std::vector<GstPipePerfFrame> pipe_perf_stack;
+
+static GQuark pipe_perf_quark;
+
+#define gst_pipe_perf_parent_class parent_class
+G_DEFINE_TYPE(GstPipePerf, gst_pipe_perf, GST_TYPE_TRACER);
+
+static void
+gst_pipe_perf_ring_init(GstPipePerfRing *ring) {
+    for (unsigned i = 0; i < PIPE_PERF_RING; ++i)
+        ring->pts[i] = GST_CLOCK_TIME_NONE;
+    ring->next = 0;
+}
+
+static void
+gst_pipe_perf_ring_put(GstPipePerfRing *ring, GstClockTime pts, GstClockTime ts) {
+    std::lock_guard<std::mutex> guard(ring->lock);
+    ring->pts[ring->next] = pts;
+    ring->ts[ring->next] = ts;
+    ring->next = (ring->next + 1) % PIPE_PERF_RING;
+}
+
+static gboolean
+gst_pipe_perf_ring_find(GstPipePerfRing *ring, GstClockTime pts, GstClockTime *ts) {
+    std::lock_guard<std::mutex> guard(ring->lock);
+    for (unsigned i = 0; i < PIPE_PERF_RING; ++i) {
+        if (ring->pts[i] == pts) {
+            *ts = ring->ts[i];
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+static GstPipePerfPipeline *
+gst_pipe_perf_pipeline_get(GstPipePerfState *state, GstObject *top) {
+    for (auto &p: state->pipelines) {
+        if (p->top == top)
+            return p.get();
+    }
+    auto *p = new GstPipePerfPipeline();
+    p->top = top;
+    gst_pipe_perf_ring_init(&p->origin);
+    state->pipelines.emplace_back(p);
+    return p;
+}
+
+/* pad 所属的元素的统计，第一次见到时创建；bin 与 ghost pad 内部的 proxy pad 返回 NULL */
+static GstPipePerfElement *
+gst_pipe_perf_element_of(GstPipePerf *self, GstPad *pad) {
+    if (!pad)
+        return NULL;
+    GstObject *parent = GST_OBJECT_PARENT(pad);
+    if (!parent || !GST_IS_ELEMENT(parent) || GST_IS_BIN(parent))
+        return NULL;
+
+    auto *element = (GstPipePerfElement *) g_object_get_qdata(G_OBJECT(parent), pipe_perf_quark);
+    if (element)
+        return element;
+
+    GstPipePerfState *state = self->state;
+    std::lock_guard<std::mutex> guard(state->lock);
+    element = (GstPipePerfElement *) g_object_get_qdata(G_OBJECT(parent), pipe_perf_quark);
+    if (element)
+        return element;
+
+    GstObject *top = parent;
+    while (GST_OBJECT_PARENT(top))
+        top = GST_OBJECT_PARENT(top);
+
+    element = new GstPipePerfElement();
+    element->name = top != parent ? std::string(GST_OBJECT_NAME(top)) + "/" + GST_OBJECT_NAME(parent)
+                                  : std::string(GST_OBJECT_NAME(parent));
+    element->source = GST_OBJECT_FLAG_IS_SET(parent, GST_ELEMENT_FLAG_SOURCE);
+    element->sink = GST_OBJECT_FLAG_IS_SET(parent, GST_ELEMENT_FLAG_SINK);
+    element->pipeline = gst_pipe_perf_pipeline_get(state, top);
+    gst_pipe_perf_ring_init(&element->enter);
+    undistort_timer_reset(&element->proc);
+    undistort_timer_reset(&element->latency);
+    undistort_timer_reset(&element->e2e);
+    state->elements.emplace_back(element);
+    g_object_set_qdata(G_OBJECT(parent), pipe_perf_quark, element);
+    return element;
+}
+
+static inline uint64_t
+gst_pipe_perf_us(GstClockTime ns) {
+    return (uint64_t) (ns / GST_USECOND);
+}
+
+/* 一段时间内一个计时器的 CSV 字段：次数,平均,最大,p99（微秒） */
+static void
+gst_pipe_perf_append_csv(GString *line, const UndistortTimerSnapshot *s) {
+    g_string_append_printf(line, ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT ",%" G_GUINT64_FORMAT
+                           ",%" G_GUINT64_FORMAT, (guint64) s->count,
+                           (guint64) (s->count ? s->total_us / s->count : 0), (guint64) s->max_us,
+                           (guint64) undistort_timer_percentile(s, 0.99));
+}
+
+static void
+gst_pipe_perf_append_json(GString *line, const char *name, const UndistortTimerSnapshot *s) {
+    g_string_append_printf(line, ",\"%s\":{\"count\":%" G_GUINT64_FORMAT ",\"avg_us\":%" G_GUINT64_FORMAT
+                           ",\"max_us\":%" G_GUINT64_FORMAT ",\"p99_us\":%" G_GUINT64_FORMAT "}", name,
+                           (guint64) s->count, (guint64) (s->count ? s->total_us / s->count : 0),
+                           (guint64) s->max_us, (guint64) undistort_timer_percentile(s, 0.99));
+}
+
+static void
+gst_pipe_perf_output(GstPipePerf *self, const gchar *line) {
+    if (self->file) {
+        fputs(line, self->file);
+        fputc('\n', self->file);
+    } else {
+        GST_INFO_OBJECT(self, "%s", line);
+    }
+}
+
+/* 输出这段时间（window 纳秒）内各元素的汇总并清零；这段时间没有数据的元素不输出 */
+static void
+gst_pipe_perf_report(GstPipePerf *self, GstClockTime ts, GstClockTime window) {
+    GstPipePerfState *state = self->state;
+    std::lock_guard<std::mutex> guard(state->lock);
+    GString *json = self->json ? g_string_new(NULL) : NULL;
+
+    if (json)
+        g_string_append_printf(json, "{\"time_ms\":%" G_GUINT64_FORMAT ",\"elements\":[",
+                               (guint64) (ts / GST_MSECOND));
+    gboolean first = TRUE;
+    for (auto &e: state->elements) {
+        UndistortTimerSnapshot proc, latency, e2e;
+        undistort_timer_snapshot(&e->proc, &proc);
+        undistort_timer_snapshot(&e->latency, &latency);
+        undistort_timer_snapshot(&e->e2e, &e2e);
+        undistort_timer_reset(&e->proc);
+        undistort_timer_reset(&e->latency);
+        undistort_timer_reset(&e->e2e);
+        if (proc.count == 0 && latency.count == 0 && e2e.count == 0)
+            continue;
+        const gdouble load = window ? 100.0 * proc.total_us / gst_pipe_perf_us(window) : 0.0;
+
+        if (json) {
+            g_string_append_printf(json, "%s{\"element\":\"%s\",\"load_pct\":%.1f", first ? "" : ",",
+                                   e->name.c_str(), load);
+            gst_pipe_perf_append_json(json, "proc", &proc);
+            gst_pipe_perf_append_json(json, "latency", &latency);
+            gst_pipe_perf_append_json(json, "e2e", &e2e);
+            g_string_append_c(json, '}');
+        } else {
+            GString *line = g_string_new(NULL);
+            g_string_append_printf(line, "%" G_GUINT64_FORMAT ",%s,%.1f", (guint64) (ts / GST_MSECOND),
+                                   e->name.c_str(), load);
+            gst_pipe_perf_append_csv(line, &proc);
+            gst_pipe_perf_append_csv(line, &latency);
+            gst_pipe_perf_append_csv(line, &e2e);
+            gst_pipe_perf_output(self, line->str);
+            g_string_free(line, TRUE);
+        }
+        first = FALSE;
+    }
+    if (json) {
+        g_string_append(json, "]}");
+        gst_pipe_perf_output(self, json->str);
+        g_string_free(json, TRUE);
+    }
+    if (self->file)
+        fflush(self->file);
+}
+
+/* 到了汇总时间就由抢到的那个线程输出 */
+static void
+gst_pipe_perf_maybe_report(GstPipePerf *self, GstClockTime ts) {
+    GstClockTime last = self->state->last_report.load(std::memory_order_relaxed);
+    if (ts < last + (GstClockTime) self->interval * GST_MSECOND)
+        return;
+    if (!self->state->last_report.compare_exchange_strong(last, ts, std::memory_order_relaxed))
+        return;
+    gst_pipe_perf_report(self, ts, ts - last);
+}
+
+/* buffer 从 pad 推给 peer：记录来源/离开/进入的时间，并为接收元素压栈 */
+static void
+gst_pipe_perf_enter(GstPipePerf *self, GstClockTime ts, GstPad *pad, GstClockTime pts) {
+    GstPipePerfElement *from = gst_pipe_perf_element_of(self, pad);
+    GstPipePerfElement *to = gst_pipe_perf_element_of(self, GST_PAD_PEER(pad));
+
+    if (GST_CLOCK_TIME_IS_VALID(pts)) {
+        GstClockTime start;
+        if (from && from->source)
+            gst_pipe_perf_ring_put(&from->pipeline->origin, pts, ts);
+        else if (from && gst_pipe_perf_ring_find(&from->enter, pts, &start))
+            undistort_timer_record(&from->latency, gst_pipe_perf_us(ts - start));
+        if (to) {
+            gst_pipe_perf_ring_put(&to->enter, pts, ts);
+            if (to->sink && gst_pipe_perf_ring_find(&to->pipeline->origin, pts, &start))
+                undistort_timer_record(&to->e2e, gst_pipe_perf_us(ts - start));
+        }
+    }
+    pipe_perf_stack.push_back({to, ts, 0});
+}
+
+/* push/pull 返回：出栈，接收元素记自身耗时，总耗时计入外层 */
+static void
+gst_pipe_perf_leave(GstPipePerf *self, GstClockTime ts) {
+    if (pipe_perf_stack.empty())
+        return; /* tracer 在 push 进行中被创建 */
+    const GstPipePerfFrame frame = pipe_perf_stack.back();
+    pipe_perf_stack.pop_back();
+
+    const GstClockTime total = ts > frame.start ? ts - frame.start : 0;
+    if (frame.element) {
+        const GstClockTime self_time = total > frame.child ? total - frame.child : 0;
+        undistort_timer_record(&frame.element->proc, gst_pipe_perf_us(self_time));
+    }
+    if (!pipe_perf_stack.empty())
+        pipe_perf_stack.back().child += total;
+    gst_pipe_perf_maybe_report(self, ts);
+}
+
+static void
+do_push_buffer_pre(GstPipePerf *self, GstClockTime ts, GstPad *pad, GstBuffer *buffer) {
+    gst_pipe_perf_enter(self, ts, pad, GST_BUFFER_PTS(buffer));
+}
+
+static void
+do_push_buffer_post(GstPipePerf *self, GstClockTime ts, GstPad *pad, GstFlowReturn res) {
+    gst_pipe_perf_leave(self, ts);
+}
+
+static void
+do_push_buffer_list_pre(GstPipePerf *self, GstClockTime ts, GstPad *pad, GstBufferList *list) {
+    GstBuffer *first = gst_buffer_list_length(list) > 0 ? gst_buffer_list_get(list, 0) : NULL;
+    gst_pipe_perf_enter(self, ts, pad, first ? GST_BUFFER_PTS(first) : GST_CLOCK_TIME_NONE);
+}
+
+static void
+do_push_buffer_list_post(GstPipePerf *self, GstClockTime ts, GstPad *pad, GstFlowReturn res) {
+    gst_pipe_perf_leave(self, ts);
+}
+
+/* pull 模式：拉取方的 pad 向上游要数据，上游元素（peer 的父元素）做处理 */
+static void
+do_pull_range_pre(GstPipePerf *self, GstClockTime ts, GstPad *pad, guint64 offset, guint size) {
+    pipe_perf_stack.push_back({gst_pipe_perf_element_of(self, GST_PAD_PEER(pad)), ts, 0});
+}
+
+static void
+do_pull_range_post(GstPipePerf *self, GstClockTime ts, GstPad *pad, GstBuffer *buffer, GstFlowReturn res) {
+    gst_pipe_perf_leave(self, ts);
+}
+
+/* 参数按 GstStructure 解析（与核心 latency tracer 相同的写法） */
+static void
+gst_pipe_perf_constructed(GObject *object) {
+    GstPipePerf *self = GST_PIPE_PERF(object);
+    gchar *params = NULL;
+
+    G_OBJECT_CLASS(parent_class)->constructed(object);
+
+    g_object_get(self, "params", &params, NULL);
+    if (params) {
+        gchar *tmp = g_strdup_printf("pipeperf,%s", params);
+        GstStructure *st = gst_structure_from_string(tmp, NULL);
+        g_free(tmp);
+        if (st) {
+            gint interval;
+            if (gst_structure_get_int(st, "interval", &interval) && interval > 0)
+                self->interval = (guint) interval;
+            const gchar *format = gst_structure_get_string(st, "format");
+            if (format)
+                self->json = g_ascii_strcasecmp(format, "json") == 0;
+            const gchar *file = gst_structure_get_string(st, "file");
+            if (file) {
+                self->file = fopen(file, "w");
+                if (!self->file)
+                    GST_WARNING_OBJECT(self, "cannot open %s: %s, logging instead", file, g_strerror(errno));
+            }
+            gst_structure_free(st);
+        } else {
+            GST_WARNING_OBJECT(self, "cannot parse params \"%s\"", params);
+        }
+        g_free(params);
+    }
+
+    if (!self->json) {
+        gst_pipe_perf_output(self, "time_ms,element,load_pct,proc_count,proc_avg_us,proc_max_us,proc_p99_us,"
+                                   "latency_count,latency_avg_us,latency_max_us,latency_p99_us,"
+                                   "e2e_count,e2e_avg_us,e2e_max_us,e2e_p99_us");
+    }
+    GST_INFO_OBJECT(self, "interval %u ms, %s to %s", self->interval, self->json ? "json" : "csv",
+                    self->file ? "file" : "log");
+}
+
+static void
+gst_pipe_perf_finalize(GObject *object) {
+    GstPipePerf *self = GST_PIPE_PERF(object);
+
+    if (self->file)
+        fclose(self->file);
+    delete self->state;
+    G_OBJECT_CLASS(parent_class)->finalize(object);
+}
+
+static void
+gst_pipe_perf_class_init(GstPipePerfClass *klass) {
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+    gobject_class->constructed = gst_pipe_perf_constructed;
+    gobject_class->finalize = gst_pipe_perf_finalize;
+    pipe_perf_quark = g_quark_from_static_string("pipeperf-element");
+}
+
+static void
+gst_pipe_perf_init(GstPipePerf *self) {
+    GstTracer *tracer = GST_TRACER(self);
+
+    self->interval = DEFAULT_INTERVAL;
+    self->json = FALSE;
+    self->file = NULL;
+    self->state = new GstPipePerfState();
+    self->state->last_report = 0;
+
+    gst_tracing_register_hook(tracer, "pad-push-pre", G_CALLBACK(do_push_buffer_pre));
+    gst_tracing_register_hook(tracer, "pad-push-post", G_CALLBACK(do_push_buffer_post));
+    gst_tracing_register_hook(tracer, "pad-push-list-pre", G_CALLBACK(do_push_buffer_list_pre));
+    gst_tracing_register_hook(tracer, "pad-push-list-post", G_CALLBACK(do_push_buffer_list_post));
+    gst_tracing_register_hook(tracer, "pad-pull-range-pre", G_CALLBACK(do_pull_range_pre));
+    gst_tracing_register_hook(tracer, "pad-pull-range-post", G_CALLBACK(do_pull_range_post));
+}
+
+/* 插件初始化：注册 tracer */
+static gboolean
+pipeperf_init(GstPlugin *plugin) {
+    GST_DEBUG_CATEGORY_INIT(gst_pipe_perf_debug, "pipeperf", 0, "pipeline performance tracer");
+    return gst_tracer_register(plugin, "pipeperf", GST_TYPE_PIPE_PERF);
+}
+
+#ifndef PACKAGE
+#define PACKAGE "gst-pipeperf"
+#endif
+GST_PLUGIN_DEFINE(GST_VERSION_MAJOR, GST_VERSION_MINOR,
+                  pipeperf, "Per-element processing time and buffer latency tracer",
+                  pipeperf_init,
+                  "1.0", "LGPL", "gst-undistort", "https://example.org/"
+)
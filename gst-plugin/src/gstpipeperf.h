@@ -0,0 +1,32 @@
+#ifndef __GST_PIPE_PERF_H__
+#define __GST_PIPE_PERF_H__
+
+#include <gst/gst.h>
+G_BEGIN_DECLS
+
+#define GST_TYPE_PIPE_PERF            (gst_pipe_perf_get_type())
+#define GST_PIPE_PERF(obj)            (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_PIPE_PERF,GstPipePerf))
+#define GST_PIPE_PERF_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST((klass),GST_TYPE_PIPE_PERF,GstPipePerfClass))
+#define GST_IS_PIPE_PERF(obj)         (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_PIPE_PERF))
+#define GST_IS_PIPE_PERF_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_PIPE_PERF))
+
+typedef struct _GstPipePerfState GstPipePerfState;
+
+/* pipeperf tracer：按元素统计处理耗时、经过元素（包括 queue 内排队）的延迟与端到端延迟，
+ * 周期性输出汇总 */
+typedef struct _GstPipePerf {
+    GstTracer parent;
+    guint interval; /* 汇总间隔（毫秒） */
+    gboolean json; /* 输出 JSON 行，否则 CSV */
+    FILE *file; /* 输出文件，NULL 时写到 pipeperf 调试类别（INFO） */
+    GstPipePerfState *state; /* C++ 状态，见 gstpipeperf.cpp */
+} GstPipePerf;
+
+typedef struct _GstPipePerfClass {
+    GstTracerClass parent_class;
+} GstPipePerfClass;
+
+GType gst_pipe_perf_get_type (void);
+
+G_END_DECLS
+#endif /* __GST_PIPE_PERF_H__ */
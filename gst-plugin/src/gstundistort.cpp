@@ -3,8 +3,118 @@
  *
  * Undistort video frames using OpenCV remap.
  *
+ * map-format 决定映射表的存储形式（协商时一次性生成，不在每帧转换）：
+ *  - float32 : 两张 CV_32FC1 表（8 字节/像素）
+ *  - fixed   : CV_16SC2 + CV_16UC1（6 字节/像素），默认值。坐标被量化到 1/32 像素，
+ *              量化误差 <= 1/64 像素。对 8 位图像 OpenCV 的 CPU remap 在使用 float32 表时
+ *              内部同样先量化到 1/32 像素，因此两者输出逐像素一致；与真正的浮点插值
+ *              （例如 OpenCL 路径）相比，每个通道误差不超过 1 LSB + 梯度 * 1/64
+ *  - nearest : 仅 CV_16SC2 四舍五入坐标（4 字节/像素），最近邻插值，不做双线性
+ *  - mesh    : 只保存 mesh-step-x x mesh-step-y（默认 16x8，与 IDC 相同）的稀疏网格，
+ *              每个条带逐行把网格双线性展开成定点坐标（行缓冲留在 L1）再交给专用内核，
+ *              表的内存读取量约为 fixed 的 1/100。网格点直接按相机模型求值，不生成全分辨率
+ *              浮点表（4K 下省掉 66 MB 的临时内存与大部分协商耗时）；网格的最大坐标误差在协商时
+ *              于每个网格单元中心抽样估计，INFO 级别输出并可从只读属性 mesh-error 读取。
+ *              max-mesh-error > 0 时步长改为协商时按误差选择：以 mesh-step-x/y 为基准按 2 的幂
+ *              放大、缩小得到候选（保持长宽比，2..256），此时仍生成稠密表，从最粗的开始测量与它的
+ *              最大/均方根误差，取第一个最大误差不超过 max-mesh-error 的（都超过时取最细的），INFO 级别
+ *              输出选中的步长与误差。畸变弱的镜头网格更稀、读表更少，强鱼眼仍保持精度。
+ *              idc 后端以 16x8 为基准（不用 mesh-step-x/y），同样按 max-mesh-error 选择
+ *
+ * 设置 map-cache-dir 后，生成的表按标定参数/分辨率/表格式/后端的 hash 存成文件，
+ * 下次协商时只读 mmap 直接使用（多进程共享页），4K 下省去数百毫秒的首帧延迟；
+ * 版本、key 或校验和不符的文件会被重新生成覆盖。
+ *
+ * fx/fy/cx/cy/k1/k2/p1/p2/k3 可在 PLAYING 中修改（也可由 GstController 驱动）：
+ * 修改后由后台线程重建整组表，流线程继续使用旧表，新表通过原子指针发布，
+ * 在下一个 buffer 开始前整体换上，热路径上不加锁，也不需要重新协商。
+ * 其余参数（map-format、mesh-step-x/y、max-mesh-error、map-cache-dir）在下次协商时生效。
+ *
+ * alpha >= 0 时按 getOptimalNewCameraMatrix 计算新内参，只输出有效区域：alpha=0 裁掉所有
+ * 黑边，alpha=1 保留全部源像素。输出尺寸默认协商为有效区域大小（宽高取偶数），可以比输入小，
+ * 省下 remap 与下游编码的像素；下游要求其他尺寸时有效区域会被缩放到该尺寸。
+ * alpha 改变会触发重新协商；PLAYING 中修改标定参数时输出尺寸保持不变。
+ * camera-model=fisheye 时按等距鱼眼模型（k1..k4，p1/p2 不使用）生成表，alpha 作为
+ * estimateNewCameraMatrixForUndistortRectify 的 balance（0 = 裁掉黑边，1 = 保留全部视场），
+ * 不改变输出尺寸。
+ *
+ * 输出尺寸像 videoscale 一样由下游决定，缩放直接烘焙进映射表（新内参按输出尺寸缩放），
+ * 矫正与缩放一次完成，不需要后接 videoscale。另外可以申请任意个 src_%u 请求 pad
+ * （最多 7 个），每个 pad 独立协商尺寸并持有自己的映射表；所有输出在同一次条带调度中
+ * 从同一帧输入生成，替代 undistort ! tee ! videoscale 的多路全帧读取。请求 pad 的
+ * 输出格式同样独立协商，时间戳取自输入 buffer，未链接的 pad 不做处理。
+ *
+ * 每个 src_%u 还是一个虚拟相机：pad 属性 yaw/pitch/roll（度）与 zoom 把矫正后的视角
+ * 旋转、放大，roi-x/roi-y/roi-width/roi-height 则直接取矫正图（输入尺寸）中的一块区域
+ * 缩放到输出尺寸；视角同样烘焙进该 pad 的映射表，一帧鱼眼输入可以同时输出多个互不相同的
+ * 画面，仍然只遍历一次。元素实现 GstChildProxy，gst-launch 中可以写 src_0::yaw=30。
+ * 视角属性可在 PLAYING 中修改，只在后台重建这一路的表，其他输出不受影响。
+ *
+ * backend 选择 remap 的实现（协商时为每路输出单独选择，结果与原因按 INFO 级别输出）：
+ *  - auto   : 默认值。NV12 -> NV12 且编译了 IDC 硬件支持时用 idc；否则按 map-format：float32/nearest
+ *             用 opencv，mesh 用 mesh，fixed 用 simd（CPU 没有 SSE4.1 及以上时用 opencv）
+ *  - opencv : cv::remap（mesh 表改为 float32）；不能融合格式转换
+ *  - simd   : fixed 表 + 专用内核
+ *  - mesh   : 稀疏网格 + 专用内核
+ *  - idc    : Rockchip IDC 硬件，只支持 NV12 -> NV12，网格步长默认 16x8；meson -Didc=enabled 要求
+ *             librkalg_idc，默认 auto 找不到库时编译 CPU 实现的同名接口（rkalg_idc_lut_emu，
+ *             只在显式 backend=idc 时使用，便于在 x86 上测试与测量这条路径），disabled 不编译。
+ *             初始化或某一帧处理失败时退回 mesh 路径。
+ *             下游支持 GstVideoMeta 时输出 pool 按 IDC 的 stride/高度对齐分配，硬件直接写进输出 buffer
+ * 显式选择的后端处理不了协商出的格式时退回 auto，并输出 WARNING。
+ *
+ * QoS 默认开启（基类的 qos 属性）。没有请求 pad 时与基类相同：src pad 下游来不及时，
+ * 已过期的输入帧在 remap 前整帧丢掉，QoS 事件转发到上游。有请求 pad 时每一路（包括 src pad）
+ * 的 QoS 事件都不转发到上游，只作用于该路：过期帧这一路不 remap、不推送，其他输出照常。
+ * 都会发 QoS 消息，带已处理/已丢弃的帧数（请求 pad 的消息以 pad 为来源）。
+ *
+ * buffer 分配：向上游提议一个 video pool，每个平面的 stride 与起始地址按 64 字节对齐，
+ * 行尾至少留一个向量宽度的填充，并声明接受 GstVideoMeta（上游 buffer 的 stride/offset
+ * 按 meta 映射，不要求默认布局）。src pad 与每个 src_%u 按各自下游的 ALLOCATION 回复
+ * 选择输出 pool：下游支持 GstVideoMeta 时同样按 64 字节对齐，否则保持默认 stride；
+ * 下游给的 pool 做不了对齐时换成元素自己的 video pool。输出 buffer 在帧之间复用。
+ *
+ * 输入可以是 memory:DMABuf 的 raw video（v4l2src io-mode=dmabuf、硬件 JPEG 解码器等）：
+ * 不经过中间拷贝，按 GstVideoMeta 的平面 offset/stride 直接映射 dmabuf 读取，处理前后
+ * 各发一次 DMA_BUF_IOCTL_SYNC（START/END）。输出总在系统内存。用 memfd/udmabuf 导出的
+ * dmabuf 包装成 GstDmaBufAllocator 的内存即可在任何 Linux 上验证这条路径。
+ *
+ * 处理统计一直在收集（每帧几次原子加法）：stats 属性返回一个 undistort-stats 结构，
+ * frames-processed/frames-bypassed、当前表占用的内存 table-bytes，以及 remap、拷贝
+ * （恒等输出与 in-place 回退）、生成表三类耗时的次数/总和/平均/最大/p50/p90/p99 与直方图；
+ * stats-interval 不为 0 时每隔这么多毫秒在总线上发一条同样内容的元素消息。
+ *
+ * remap 按水平条带切分，由元素自带的线程池执行（n-threads，0 = 按 CPU 核数）；
+ * opencv 后端除外，它整帧调用 cv::remap，用 OpenCV 自己的线程（元素不改 cv::setNumThreads）。
+ * 每个条带只写自己的输出行，输出与线程数、调度顺序无关；条带耗时以 LOG 级别输出。
+ *
+ * simd 后端下 fixed 表的双线性插值不走 cv::remap，而是 gstundistort_kernels 里的专用内核
+ * （SSE4.1/AVX2/AVX-512，运行时按 CPU 选择），与标量参考实现逐位一致。
+ * 同格式输出时 fixed 表按块遍历（gstundistort_tiles）：协商时统计每块的源包围盒，
+ * 选出源工作集放得进 L2 的块尺寸，块行内蛇形排列并预取下一块的源行；
+ * 强畸变的边缘不再因为一行输出跨几十行源像素而反复缺 L2。
+ *
+ * 支持 BGR / BGRx / GRAY8 / NV12 / I420，逐平面 remap：
+ *  - 亮度平面（以及 BGR/BGRx/GRAY8 的唯一平面）用全分辨率表
+ *  - 4:2:0 色度平面用由全分辨率浮点表推导出的半分辨率表（按 2x2 亮度块中心取样）
+ * YUV 格式每像素只处理 1.5 字节，并省去前后两次 videoconvert。
+ * luma-only=true 时只 remap 亮度，色度平面填 128（灰度），适合只做分析的分支。
+ *
+ * 输入还可以是 YUY2（常见的 USB 摄像头格式），输出格式也可以与输入不同，格式转换融合在
+ * 采样里，不需要前后的 videoconvert：
+ *  - YUY2/NV12/I420 -> NV12/I420/GRAY8：亮度与色度分别按各自的表直接从源布局采样、
+ *    按目标布局写出，色度取 4:2:0 样点（YUY2 的 4:2:2 色度用按行的表）
+ *  - YUY2/NV12/I420 -> BGR/BGRx：亮度与 4:2:0 色度先采样到行缓冲，再按输入 caps 的
+ *    colorimetry（BT.601/BT.709，full/limited range）用定点系数转 RGB
+ *  - BGR <-> BGRx：采样后重新打包
+ * 格式转换路径只支持定点表，map-format=float32/nearest 时按 fixed 生成。
+ *
  * Example:
   gst-launch-1.0 v4l2src device=/dev/video0 ! image/jpeg,width=1280,height=720,framerate=30/1 ! jpegdec ! videoconvert ! video/x-raw,format=BGR ! undistort fx=800 fy=800 cx=640 cy=360 k1=-0.2 k2=0.1 p1=0.0 p2=0.0 k3=0.0  ! videoconvert !  x265enc bitrate=1800 speed-preset=ultrafast tune=zerolatency ! rtspclientsink location=rtsp://127.0.0.1:8554/video1 latency=10
+  gst-launch-1.0 v4l2src device=/dev/video0 ! image/jpeg,width=1280,height=720,framerate=30/1 ! jpegdec ! undistort fx=800 fy=800 cx=640 cy=360 k1=-0.2 k2=0.1 ! video/x-raw,format=NV12 ! x265enc bitrate=1800 speed-preset=ultrafast tune=zerolatency ! rtspclientsink location=rtsp://127.0.0.1:8554/video1 latency=10
+  gst-launch-1.0 v4l2src device=/dev/video0 ! video/x-raw,format=YUY2,width=1280,height=720 ! undistort fx=800 fy=800 cx=640 cy=360 k1=-0.2 ! video/x-raw,format=BGR ! appsink
+  gst-launch-1.0 filesrc location=in.mp4 ! decodebin ! video/x-raw,format=NV12 ! undistort name=u fx=2400 fy=2400 cx=1920 cy=1080 k1=-0.2 ! queue ! x265enc ! fakesink  u.src_0 ! video/x-raw,width=1280,height=720 ! queue ! fakesink  u.src_1 ! video/x-raw,width=640,height=360 ! queue ! fakesink
+  gst-launch-1.0 v4l2src ! video/x-raw,format=NV12,width=1920,height=1080 ! undistort name=u camera-model=fisheye fx=560 fy=560 cx=960 cy=540 k1=0.05 k2=-0.01 k3=0.0 k4=0.0 src_0::yaw=-40 src_1::yaw=40 src_1::zoom=1.5 src_2::roi-x=800 src_2::roi-y=400 src_2::roi-width=320 src_2::roi-height=180 ! fakesink  u.src_0 ! video/x-raw,width=960,height=540 ! queue ! fakesink  u.src_1 ! video/x-raw,width=960,height=540 ! queue ! fakesink  u.src_2 ! video/x-raw,width=640,height=360 ! queue ! fakesink
 
 */
 
@@ -13,50 +123,342 @@
 #endif
 
 #include <gst/gst.h>
+#include <gst/allocators/gstdmabuf.h>
 #include <gst/video/gstvideofilter.h>
+#include <gst/video/gstvideopool.h>
 #include "gstundistort.h"
+#include "gstundistort_backend.h"
+#include "gstundistort_cache.h"
+#include "gstundistort_convert.h"
+#include "gstundistort_idc.h"
+#include "gstundistort_kernels.h"
+#include "gstundistort_maps.h"
+#include "gstundistort_mesh.h"
+#include "gstundistort_pool.h"
+#include "gstundistort_stats.h"
+#include "gstundistort_tiles.h"
 #include <opencv2/opencv.hpp>
-#include <opencv2/core/ocl.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <new>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_LINUX_DMA_BUF_H
+#include <linux/dma-buf.h>
+#include <sys/ioctl.h>
+#endif
 
 GST_DEBUG_CATEGORY_STATIC(gst_undistort_debug);
 #define GST_CAT_DEFAULT gst_undistort_debug
 
 using namespace cv;
 
+/* 映射表：亮度（全分辨率）与 4:2:0 色度（半分辨率） */
+enum {
+    GST_UNDISTORT_TABLE_LUMA,
+    GST_UNDISTORT_TABLE_CHROMA,
+    GST_UNDISTORT_N_TABLES
+};
+
+/* 一个视频平面的处理方式，由协商出的格式决定 */
+typedef struct {
+    int channels; // 每像素分量数（均为 8 位）
+    int comp; // 平面里的第一个分量，用于取平面宽高
+    int table; // 使用哪张映射表
+    UndistortRemapRowFunc kernel; // fixed/mesh 表使用的专用内核（float32/nearest 表走 cv::remap）
+} GstUndistortPlane;
+
+/* 一路输出的格式转换方式 */
+typedef enum {
+    GST_UNDISTORT_CONVERT_NONE, // 同格式：按 GstUndistortPlane 逐平面 remap
+    GST_UNDISTORT_CONVERT_YUV, // YUV -> NV12/I420/GRAY8：亮度、色度分别采样，按目标布局写出
+    GST_UNDISTORT_CONVERT_BGR, // YUV -> BGR/BGRx：亮度、色度采样到行缓冲后转 RGB
+    GST_UNDISTORT_CONVERT_REPACK, // BGR <-> BGRx：按源通道数 remap 到行缓冲后重排
+} GstUndistortConvertMode;
+
+typedef struct {
+    GstUndistortConvertMode mode;
+    UndistortRemapRowFunc luma_kernel; // 平面亮度（NV12/I420）的 1 通道内核，YUY2 为 NULL（走标量采样）
+    UndistortRemapRowFunc rgb_kernel; // REPACK：源通道数的内核
+    UndistortYuvToRgb yuv2rgb; // BGR：按输入 caps 的色彩矩阵与量化范围
+    size_t line_size; // 每个 worker 需要的行缓冲（字节）
+} GstUndistortConvert;
+
+/* 生成一组映射表所需的全部参数（属性快照） */
+typedef struct {
+    gdouble fx, fy, cx, cy;
+    gdouble k1, k2, p1, p2, k3;
+    gdouble k4; // 只用于鱼眼模型
+    GstUndistortCameraModel camera_model;
+    UndistortView view; // 请求 pad 的虚拟视角，src pad 与未设置视角时为默认值
+    int width, height;
+    int chroma_width, chroma_height; // 0 表示没有色度平面
+    int chroma_sub_y; // 源色度的垂直下采样：2 = 4:2:0，1 = 4:2:2（YUY2）
+    gboolean convert; // 输出格式与输入不同（恒等映射时也要走一遍转换）
+    int bytes_per_pixel[GST_UNDISTORT_N_TABLES]; // 每张表对应的所有源平面一个像素的总字节数，选块尺寸用
+    gdouble alpha; // <0 表示沿用原内参
+    int in_width, in_height; // 源图尺寸；width/height 为输出尺寸
+    GstUndistortMapFormat map_format; // 所选后端实际使用的表格式
+    UndistortBackend backend; // 协商时选定，不会是 AUTO
+    guint mesh_step_x, mesh_step_y; // 自适应时为候选的基准步长
+    gdouble max_mesh_error; // >0 时 mesh 步长按误差选择
+    std::string cache_dir; // 空串表示不缓存
+    guint output; // 属于哪路输出：0 为 src pad，其余为请求 pad 的编号
+    guint64 generation; // 协商代次，该输出重新协商后旧代次的表作废
+} GstUndistortParams;
+
+/* 一组映射表，建好后只读；流线程独占当前这组，后台线程只生成新的一组 */
+typedef struct {
+    GstUndistortParams params;
+    gboolean identity; // fx/fy 未设置且输入输出同尺寸、同格式，不做矫正
+    UndistortPlaneMap maps[GST_UNDISTORT_N_TABLES]; // 色度表只在 YUV 格式下生成
+    std::shared_ptr<UndistortCacheFile> cache_file; // 缓存命中时 maps 指向这个只读映射
+    gdouble mesh_error; // mesh 格式下网格与稠密表的最大坐标误差（像素），其他格式为 0
+    size_t mesh_row_size; // mesh 格式每个 worker 需要的行缓冲大小
+    UndistortTileGrid tiles[GST_UNDISTORT_N_TABLES]; // fixed 表同格式输出时按块遍历，其他情况为空
+    std::shared_ptr<UndistortIdc> idc; // idc 后端的硬件上下文（引用亮度网格，须在 maps 之后声明）
+    size_t bytes; // 亮度与色度表占用的内存（字节），统计用
+} GstUndistortTables;
+
+/* 后台重建一次发布的所有输出的表，在同一帧边界一起换上 */
+typedef struct {
+    std::vector<std::unique_ptr<GstUndistortTables>> outputs;
+} GstUndistortTableSet;
+
+/* 输出路数上限：src pad + 7 个 src_%u 请求 pad */
+#define GST_UNDISTORT_MAX_OUTPUTS 8
+
+/* buffer pool：行首与起始地址按 64 字节（一个 AVX-512 向量、一条缓存行）对齐 */
+#define GST_UNDISTORT_ALIGN 64
+#define GST_UNDISTORT_POOL_MIN 2
+
+/* 一路输出的 QoS 状态：earliest_time 与 proportion 由该输出 pad 的对象锁保护，统计只在流线程上访问 */
+typedef struct {
+    GstClockTime earliest_time; // 下游 QoS 事件报告的最早可用运行时间
+    gdouble proportion;
+    guint64 processed, dropped;
+} GstUndistortQos;
+
+/* 一个 src_%u 请求 pad。列表由对象锁保护，流线程持有 shared_ptr 快照，
+ * 释放 pad 后状态在流线程丢掉快照时才析构；协商状态与表只在流线程上访问 */
+typedef struct _GstUndistortSrcPad {
+    GstPad *pad; // 持有引用
+    guint output; // 在 GstUndistortParams::output 中的编号，从 1 开始
+    GstVideoInfo info; // 协商出的输出格式（格式与尺寸由下游决定）
+    GstUndistortConvert convert;
+    gboolean negotiated;
+    std::unique_ptr<GstUndistortTables> tables;
+    GstBufferPool *pool; // 输出 buffer 的 pool
+    GstUndistortQos qos;
+
+    ~_GstUndistortSrcPad() {
+        if (pool) {
+            gst_buffer_pool_set_active(pool, FALSE);
+            gst_object_unref(pool);
+        }
+        gst_object_unref(pad);
+    }
+} GstUndistortSrcPad;
+
 /* 私有数据：OpenCV 矩阵与映射表 */
 typedef struct _GstUndistortPrivate {
     GstVideoInfo info;
-    cv::Mat cameraMatrix;
-    cv::Mat distCoeffs;
-    cv::Mat mapx, mapy; // CV_32FC1
-    cv::Mat scratch; // 复用的临时图像，避免频繁分配
-    gboolean maps_ready;
+    GstUndistortPlane planes[GST_VIDEO_MAX_PLANES];
+    guint n_planes;
+    GstUndistortConvert convert; // src pad 的格式转换
+    cv::Mat scratch[GST_VIDEO_MAX_PLANES]; // 仅 in-place 回退路径使用的输入副本
+    std::unique_ptr<GstUndistortTables> tables; // src pad 当前使用的表，只在流线程上访问
+    std::atomic<gdouble> mesh_error; // 当前表的 mesh 误差，供属性读取
+    std::vector<uint8_t> mesh_rows; // mesh 格式每个 worker 一段行缓冲
+    std::vector<uint8_t> lines; // 格式转换每个 worker 一段行缓冲
+    std::unique_ptr<UndistortWorkerPool> pool; // 条带并行 remap 的线程池，只在流线程上使用
+
+    /* src_%u 请求 pad：srcpads 与 next_* 由对象锁保护，srcpads_cookie 每次增删加一 */
+    std::vector<std::shared_ptr<GstUndistortSrcPad>> srcpads;
+    guint next_pad_index;
+    guint next_output;
+    std::atomic<guint> srcpads_cookie;
+    std::vector<std::shared_ptr<GstUndistortSrcPad>> outputs; // 流线程上的快照
+    guint outputs_cookie;
+    GstUndistortQos src_qos; // 有请求 pad 时 src pad 的 QoS 由元素处理，见 gst_undistort_src_event
+
+    /* 标定参数的热更新：后台线程生成新表后放进 pending，流线程在帧边界用 exchange 取走 */
+    std::atomic<GstUndistortTableSet *> pending;
+    std::atomic<guint64> generation; // 代次计数，每次协商任何一路输出时分配新值
+    std::thread rebuild_thread; // 第一次修改标定参数时启动
+    std::mutex rebuild_lock; // 保护下面几项
+    std::condition_variable rebuild_cond;
+    guint64 rebuild_requested;
+    guint64 rebuild_outputs; // 待重建输出的位图（GST_UNDISTORT_OUTPUT_BIT）
+    gboolean rebuild_quit;
+    gboolean negotiated;
+    std::vector<GstUndistortParams> rebuild_base; // 每路输出最近一次协商的参数，重建时只替换标定参数
+
+    /* 处理统计：流线程与重建线程记录，任何线程可读（stats 等属性） */
+    UndistortTimerStats remap_stats; // 每帧所有输出一起 remap 的耗时
+    UndistortTimerStats copy_stats; // 恒等输出与 in-place 回退的整帧拷贝
+    UndistortTimerStats build_stats; // 生成（或从缓存载入）一组表
+    std::atomic<guint64> frames_processed; // 至少有一路输出做了 remap
+    std::atomic<guint64> frames_bypassed; // passthrough 或所有输出都是恒等映射
+    std::atomic<guint64> table_bytes; // 当前所有输出的表占用的内存
+    gint64 stats_last_post; // 上次发统计消息的单调时间（微秒），只在流线程上访问
+    gboolean dmabuf_sync_warned; // 本次流已就 DMA_BUF_IOCTL_SYNC 失败 WARNING 过，只在流线程上访问
 } GstUndistortPrivate;
 
+/* 一帧中一路输出的条带任务 */
+typedef struct {
+    const GstUndistortTables *tables;
+    const GstUndistortConvert *convert;
+    cv::Mat dst[GST_VIDEO_MAX_PLANES]; // 按输出格式的平面布局包装
+} GstUndistortOutputJob;
+
+/* 一帧的条带任务描述，worker 只读；每个条带处理每路输出、每个平面中按比例对应的行，
+ * 所有输出共用同一帧输入，源数据在各路之间留在缓存里 */
+typedef struct {
+    GstUndistort *self;
+    GstUndistortPrivate *priv;
+    cv::Mat src[GST_VIDEO_MAX_PLANES];
+    UndistortGatherSrc luma_src, chroma_src; // 格式转换路径按输入格式描述的采样源
+    GstUndistortOutputJob outputs[GST_UNDISTORT_MAX_OUTPUTS];
+    unsigned n_outputs;
+    gboolean luma_only;
+    uint8_t *mesh_rows; // worker i 使用 mesh_rows + i * mesh_row_size，各路输出依次复用
+    size_t mesh_row_size;
+    uint8_t *lines; // worker i 使用 lines + i * line_size
+    size_t line_size;
+    unsigned n_bands;
+    gint64 *band_us; // 每个条带的耗时（微秒）与执行它的 worker 编号，仅 LOG 级别时记录
+} GstUndistortBandJob;
+
 /* 属性与信号枚举 */
 enum {
     PROP_0,
     PROP_SILENT,
     PROP_FX, PROP_FY, PROP_CX, PROP_CY,
     PROP_K1, PROP_K2, PROP_P1, PROP_P2, PROP_K3,
+    PROP_MAP_FORMAT,
+    PROP_N_THREADS,
+    PROP_LUMA_ONLY,
+    PROP_MESH_STEP_X,
+    PROP_MESH_STEP_Y,
+    PROP_MESH_ERROR,
+    PROP_MAX_MESH_ERROR,
+    PROP_MAP_CACHE_DIR,
+    PROP_ALPHA,
+    PROP_K4,
+    PROP_CAMERA_MODEL,
+    PROP_BACKEND,
+    PROP_STATS,
+    PROP_STATS_INTERVAL,
+    PROP_FRAMES_PROCESSED,
+    PROP_FRAMES_BYPASSED,
 };
 
-/* Pad 模板（BGR 8UC3，更贴 OpenCV；若要支持更多格式，先接 videoconvert） */
+#define DEFAULT_MAP_FORMAT GST_UNDISTORT_MAP_FORMAT_FIXED
+#define DEFAULT_N_THREADS 0
+/* 线程池会创建 n-1 个 std::thread，过大的值会让进程在创建线程时中止 */
+#define MAX_N_THREADS 256
+#define DEFAULT_LUMA_ONLY FALSE
+#define DEFAULT_MESH_STEP_X 16
+#define DEFAULT_MESH_STEP_Y 8
+#define DEFAULT_MAX_MESH_ERROR 0.0
+#define DEFAULT_ALPHA (-1.0)
+#define DEFAULT_CAMERA_MODEL GST_UNDISTORT_CAMERA_MODEL_PINHOLE
+#define DEFAULT_BACKEND GST_UNDISTORT_BACKEND_AUTO
+#define DEFAULT_STATS_INTERVAL 0
+
+GType
+gst_undistort_map_format_get_type(void) {
+    static GType map_format_type = 0;
+    static const GEnumValue map_formats[] = {
+        {GST_UNDISTORT_MAP_FORMAT_FLOAT32, "Two CV_32FC1 tables, bilinear", "float32"},
+        {GST_UNDISTORT_MAP_FORMAT_FIXED, "CV_16SC2 + 1/32 pixel interpolation table, bilinear", "fixed"},
+        {GST_UNDISTORT_MAP_FORMAT_NEAREST, "Rounded CV_16SC2 only, nearest neighbour", "nearest"},
+        {GST_UNDISTORT_MAP_FORMAT_MESH, "Sparse mesh expanded per row, bilinear", "mesh"},
+        {0, NULL, NULL},
+    };
+
+    if (!map_format_type) {
+        map_format_type = g_enum_register_static("GstUndistortMapFormat", map_formats);
+    }
+    return map_format_type;
+}
+
+GType
+gst_undistort_backend_get_type(void) {
+    static GType backend_type = 0;
+    static const GEnumValue backends[] = {
+        {GST_UNDISTORT_BACKEND_AUTO, "Choose by negotiated format, map-format and host capabilities", "auto"},
+        {GST_UNDISTORT_BACKEND_OPENCV, "cv::remap", "opencv"},
+        {GST_UNDISTORT_BACKEND_SIMD, "Fixed-point maps with SSE4.1/AVX2/AVX-512 kernels", "simd"},
+        {GST_UNDISTORT_BACKEND_MESH, "Sparse mesh expanded per row with SIMD kernels", "mesh"},
+        {GST_UNDISTORT_BACKEND_IDC, "Rockchip IDC, NV12 only (hardware with librkalg_idc, CPU emulation otherwise; "
+                                    "auto only picks the hardware)", "idc"},
+        {0, NULL, NULL},
+    };
+
+    if (!backend_type) {
+        backend_type = g_enum_register_static("GstUndistortBackend", backends);
+    }
+    return backend_type;
+}
+
+GType
+gst_undistort_camera_model_get_type(void) {
+    static GType camera_model_type = 0;
+    static const GEnumValue camera_models[] = {
+        {GST_UNDISTORT_CAMERA_MODEL_PINHOLE, "Pinhole with radial/tangential distortion (k1,k2,p1,p2,k3)", "pinhole"},
+        {GST_UNDISTORT_CAMERA_MODEL_FISHEYE, "Equidistant fisheye (k1,k2,k3,k4)", "fisheye"},
+        {0, NULL, NULL},
+    };
+
+    if (!camera_model_type) {
+        camera_model_type = g_enum_register_static("GstUndistortCameraModel", camera_models);
+    }
+    return camera_model_type;
+}
+
+/* Pad 模板：打包 BGR/BGRx、GRAY8 与 4:2:0 的 NV12/I420；输入另外接受 4:2:2 的 YUY2（常见的
+ * 摄像头格式），输出格式可以与输入不同，转换融合在 remap 里（见 gst_undistort_can_convert） */
+#define UNDISTORT_SINK_FORMATS "{ BGR, BGRx, NV12, I420, YUY2, GRAY8 }"
+#define UNDISTORT_SRC_FORMATS "{ BGR, BGRx, NV12, I420, GRAY8 }"
+
+/* 输入还可以是 DMABuf（v4l2src io-mode=dmabuf、硬件解码器），直接由 CPU 映射读取；输出在系统内存 */
 static GstStaticPadTemplate sink_template_video =
         GST_STATIC_PAD_TEMPLATE("sink",
                                 GST_PAD_SINK, GST_PAD_ALWAYS,
-                                GST_STATIC_CAPS ("video/x-raw, format=(string)BGR")
+                                GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE(UNDISTORT_SINK_FORMATS) "; "
+                                                 GST_VIDEO_CAPS_MAKE_WITH_FEATURES(GST_CAPS_FEATURE_MEMORY_DMABUF,
+                                                                                   UNDISTORT_SINK_FORMATS))
         );
 
 static GstStaticPadTemplate src_template_video =
         GST_STATIC_PAD_TEMPLATE("src",
                                 GST_PAD_SRC, GST_PAD_ALWAYS,
-                                GST_STATIC_CAPS ("video/x-raw, format=(string)BGR")
+                                GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE(UNDISTORT_SRC_FORMATS))
+        );
+
+/* 额外输出：格式与尺寸各自协商 */
+static GstStaticPadTemplate src_request_template_video =
+        GST_STATIC_PAD_TEMPLATE("src_%u",
+                                GST_PAD_SRC, GST_PAD_REQUEST,
+                                GST_STATIC_CAPS (GST_VIDEO_CAPS_MAKE(UNDISTORT_SRC_FORMATS))
         );
 
 /* 类型定义：使用带私有数据的宏 */
 #define gst_undistort_parent_class parent_class
-G_DEFINE_TYPE_WITH_PRIVATE(GstUndistort, gst_undistort, GST_TYPE_VIDEO_FILTER);
+static void gst_undistort_child_proxy_init(gpointer g_iface, gpointer iface_data);
+G_DEFINE_TYPE_WITH_CODE(GstUndistort, gst_undistort, GST_TYPE_VIDEO_FILTER,
+                        G_ADD_PRIVATE(GstUndistort)
+                        G_IMPLEMENT_INTERFACE(GST_TYPE_CHILD_PROXY, gst_undistort_child_proxy_init));
 #if GST_CHECK_VERSION(1, 20, 0)
 //生成元素类型的注册函数,将自定义元素undistort注册到 GStreamer 框架，使其可以被管道识别和使用,
 GST_ELEMENT_REGISTER_DEFINE(undistort, "undistort", GST_RANK_NONE, GST_TYPE_UNDISTORT);
@@ -71,8 +473,46 @@ static gboolean gst_undistort_set_info(GstVideoFilter *filter,
                                        GstCaps *incaps, GstVideoInfo *in_info,
                                        GstCaps *outcaps, GstVideoInfo *out_info);
 
+static GstFlowReturn gst_undistort_transform_frame(GstVideoFilter *filter,
+                                                   GstVideoFrame *inframe, GstVideoFrame *outframe);
+
 static GstFlowReturn gst_undistort_transform_frame_ip(GstVideoFilter *filter, GstVideoFrame *frame);
 
+static void gst_undistort_before_transform(GstBaseTransform *trans, GstBuffer *buffer);
+
+static GstCaps *gst_undistort_transform_caps(GstBaseTransform *trans, GstPadDirection direction,
+                                             GstCaps *caps, GstCaps *filter);
+
+static GstCaps *gst_undistort_fixate_caps(GstBaseTransform *trans, GstPadDirection direction,
+                                          GstCaps *caps, GstCaps *othercaps);
+
+static GstPad *gst_undistort_request_new_pad(GstElement *element, GstPadTemplate *templ,
+                                             const gchar *name, const GstCaps *caps);
+
+static void gst_undistort_release_pad(GstElement *element, GstPad *pad);
+
+static gboolean gst_undistort_sink_event(GstBaseTransform *trans, GstEvent *event);
+
+static gboolean gst_undistort_src_event(GstBaseTransform *trans, GstEvent *event);
+
+static gboolean gst_undistort_stop(GstBaseTransform *trans);
+
+static gboolean gst_undistort_propose_allocation(GstBaseTransform *trans, GstQuery *decide_query, GstQuery *query);
+
+static gboolean gst_undistort_decide_allocation(GstBaseTransform *trans, GstQuery *query);
+
+/* 重建哪些输出：按输出编号取位（编号对 64 取模，多重建不影响正确性） */
+#define GST_UNDISTORT_OUTPUT_BIT(output) (G_GUINT64_CONSTANT(1) << ((output) & 63))
+#define GST_UNDISTORT_ALL_OUTPUTS G_MAXUINT64
+
+static void gst_undistort_request_rebuild(GstUndistort *self, guint64 outputs);
+
+static void gst_undistort_stop_rebuild(GstUndistortPrivate *priv);
+
+static void gst_undistort_finalize(GObject *object);
+
+static GstStructure *gst_undistort_stats_structure(GstUndistort *self);
+
 /* class_init：注册属性/回调/Pad 与元信息 */
 static void
 gst_undistort_class_init(GstUndistortClass *klass) {
@@ -82,6 +522,7 @@ gst_undistort_class_init(GstUndistortClass *klass) {
 
     gobject_class->set_property = gst_undistort_set_property;
     gobject_class->get_property = gst_undistort_get_property;
+    gobject_class->finalize = gst_undistort_finalize;
 
     /* 属性：silent 与相机参数，默认 0 表示“不做畸变校正”（生成单位映射） */
     g_object_class_install_property(gobject_class, PROP_SILENT,
@@ -91,31 +532,135 @@ gst_undistort_class_init(GstUndistortClass *klass) {
 
     g_object_class_install_property(gobject_class, PROP_FX,
                                     g_param_spec_double("fx", "fx", "Focal length fx (pixels)", 0.0, G_MAXDOUBLE, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_FY,
                                     g_param_spec_double("fy", "fy", "Focal length fy (pixels)", 0.0, G_MAXDOUBLE, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_CX,
                                     g_param_spec_double("cx", "cx", "Principal point cx", 0.0, G_MAXDOUBLE, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_CY,
                                     g_param_spec_double("cy", "cy", "Principal point cy", 0.0, G_MAXDOUBLE, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_K1,
                                     g_param_spec_double("k1", "k1", "Radial distortion k1", -10.0, 10.0, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_K2,
                                     g_param_spec_double("k2", "k2", "Radial distortion k2", -10.0, 10.0, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_P1,
                                     g_param_spec_double("p1", "p1", "Tangential distortion p1", -10.0, 10.0, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_P2,
                                     g_param_spec_double("p2", "p2", "Tangential distortion p2", -10.0, 10.0, 0.0,
-                                                        G_PARAM_READWRITE));
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
     g_object_class_install_property(gobject_class, PROP_K3,
                                     g_param_spec_double("k3", "k3", "Radial distortion k3", -10.0, 10.0, 0.0,
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
+    g_object_class_install_property(gobject_class, PROP_MAP_FORMAT,
+                                    g_param_spec_enum("map-format", "Map format",
+                                                      "Storage format of the remap tables (applied on next negotiation)",
+                                                      GST_TYPE_UNDISTORT_MAP_FORMAT, DEFAULT_MAP_FORMAT,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_N_THREADS,
+                                    g_param_spec_uint("n-threads", "Threads",
+                                                      "Number of threads for band-parallel remap, "
+                                                      "including the streaming thread (0 = number of CPUs); "
+                                                      "backend=opencv uses OpenCV's own threads instead",
+                                                      0, MAX_N_THREADS, DEFAULT_N_THREADS,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_LUMA_ONLY,
+                                    g_param_spec_boolean("luma-only", "Luma only",
+                                                         "Remap only the luma plane and fill chroma with 128 "
+                                                         "(YUV formats only)",
+                                                         DEFAULT_LUMA_ONLY,
+                                                         (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE)));
+    g_object_class_install_property(gobject_class, PROP_MESH_STEP_X,
+                                    g_param_spec_uint("mesh-step-x", "Mesh step X",
+                                                      "Horizontal mesh spacing in pixels for map-format=mesh",
+                                                      2, 256, DEFAULT_MESH_STEP_X,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MESH_STEP_Y,
+                                    g_param_spec_uint("mesh-step-y", "Mesh step Y",
+                                                      "Vertical mesh spacing in pixels for map-format=mesh",
+                                                      2, 256, DEFAULT_MESH_STEP_Y,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MAX_MESH_ERROR,
+                                    g_param_spec_double("max-mesh-error", "Max mesh error",
+                                                        "Pick the coarsest mesh step (mesh-step-x/y scaled by "
+                                                        "powers of two) whose maximum error against the dense "
+                                                        "map stays within this many pixels (0 = fixed step)",
+                                                        0.0, 16.0, DEFAULT_MAX_MESH_ERROR,
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_MESH_ERROR,
+                                    g_param_spec_double("mesh-error", "Mesh error",
+                                                        "Measured maximum coordinate error of the mesh against "
+                                                        "the dense map, in pixels (0 unless map-format=mesh)",
+                                                        0.0, G_MAXDOUBLE, 0.0,
+                                                        G_PARAM_READABLE));
+    g_object_class_install_property(gobject_class, PROP_MAP_CACHE_DIR,
+                                    g_param_spec_string("map-cache-dir", "Map cache directory",
+                                                        "Directory for memory-mapped remap table cache files "
+                                                        "(NULL = always generate)",
+                                                        NULL,
                                                         G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_ALPHA,
+                                    g_param_spec_double("alpha", "Alpha",
+                                                        "Free scaling of the new camera matrix: -1 keeps the input "
+                                                        "camera matrix (scaled to the output size), 0 keeps only valid "
+                                                        "pixels, 1 keeps all source pixels; output is cropped to the "
+                                                        "valid region (camera-model=fisheye: balance, output size "
+                                                        "unchanged)",
+                                                        -1.0, 1.0, DEFAULT_ALPHA,
+                                                        G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_K4,
+                                    g_param_spec_double("k4", "k4", "Fisheye distortion k4 (camera-model=fisheye)",
+                                                        -10.0, 10.0, 0.0,
+                                                        (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE |
+                                                                      GST_PARAM_MUTABLE_PLAYING)));
+    g_object_class_install_property(gobject_class, PROP_CAMERA_MODEL,
+                                    g_param_spec_enum("camera-model", "Camera model",
+                                                      "Projection model of the calibration: pinhole uses "
+                                                      "k1,k2,p1,p2,k3, fisheye uses k1,k2,k3,k4",
+                                                      GST_TYPE_UNDISTORT_CAMERA_MODEL, DEFAULT_CAMERA_MODEL,
+                                                      (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING)));
+    g_object_class_install_property(gobject_class, PROP_BACKEND,
+                                    g_param_spec_enum("backend", "Backend",
+                                                      "remap backend; an unavailable choice falls back to auto "
+                                                      "(applied on next negotiation)",
+                                                      GST_TYPE_UNDISTORT_BACKEND, DEFAULT_BACKEND,
+                                                      G_PARAM_READWRITE));
+    g_object_class_install_property(gobject_class, PROP_STATS,
+                                    g_param_spec_boxed("stats", "Statistics",
+                                                       "Processing statistics since the element was created "
+                                                       "(same fields as the undistort-stats element message)",
+                                                       GST_TYPE_STRUCTURE,
+                                                       G_PARAM_READABLE));
+    g_object_class_install_property(gobject_class, PROP_STATS_INTERVAL,
+                                    g_param_spec_uint("stats-interval", "Statistics interval",
+                                                      "Post an undistort-stats element message every this many "
+                                                      "milliseconds (0 = never)",
+                                                      0, G_MAXUINT, DEFAULT_STATS_INTERVAL,
+                                                      (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING)));
+    g_object_class_install_property(gobject_class, PROP_FRAMES_PROCESSED,
+                                    g_param_spec_uint64("frames-processed", "Frames processed",
+                                                        "Frames remapped on at least one output",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
+    g_object_class_install_property(gobject_class, PROP_FRAMES_BYPASSED,
+                                    g_param_spec_uint64("frames-bypassed", "Frames bypassed",
+                                                        "Frames passed through or only copied (identity map)",
+                                                        0, G_MAXUINT64, 0,
+                                                        G_PARAM_READABLE));
 
     gst_element_class_set_details_simple(gstelement_class,
                                          "Undistort", "Filter/Video",
@@ -126,8 +671,30 @@ gst_undistort_class_init(GstUndistortClass *klass) {
                                        gst_static_pad_template_get(&src_template_video));
     gst_element_class_add_pad_template(gstelement_class,
                                        gst_static_pad_template_get(&sink_template_video));
+    /* 请求 pad 的类型是 GstUndistortViewPad，gst-inspect 能列出它的视角属性 */
+    gst_element_class_add_pad_template(gstelement_class,
+                                       gst_pad_template_new_from_static_pad_template_with_gtype(
+                                           &src_request_template_video, GST_TYPE_UNDISTORT_VIEW_PAD));
+
+    /* src_%u：同一次遍历输入产生不同分辨率的额外输出 */
+    gstelement_class->request_new_pad = GST_DEBUG_FUNCPTR(gst_undistort_request_new_pad);
+    gstelement_class->release_pad = GST_DEBUG_FUNCPTR(gst_undistort_release_pad);
+    GST_BASE_TRANSFORM_CLASS(klass)->sink_event = GST_DEBUG_FUNCPTR(gst_undistort_sink_event);
+    GST_BASE_TRANSFORM_CLASS(klass)->src_event = GST_DEBUG_FUNCPTR(gst_undistort_src_event);
+    GST_BASE_TRANSFORM_CLASS(klass)->stop = GST_DEBUG_FUNCPTR(gst_undistort_stop);
 
     vfilter_class->set_info = GST_DEBUG_FUNCPTR(gst_undistort_set_info);
+    /* 标定参数热更新：每个 buffer 前检查后台是否发布了新表 */
+    GST_BASE_TRANSFORM_CLASS(klass)->before_transform = GST_DEBUG_FUNCPTR(gst_undistort_before_transform);
+    /* alpha >= 0 时输出尺寸由有效区域决定 */
+    GST_BASE_TRANSFORM_CLASS(klass)->transform_caps = GST_DEBUG_FUNCPTR(gst_undistort_transform_caps);
+    GST_BASE_TRANSFORM_CLASS(klass)->fixate_caps = GST_DEBUG_FUNCPTR(gst_undistort_fixate_caps);
+    /* 向上游提议、向下游选择 64 字节对齐的 video pool */
+    GST_BASE_TRANSFORM_CLASS(klass)->propose_allocation = GST_DEBUG_FUNCPTR(gst_undistort_propose_allocation);
+    GST_BASE_TRANSFORM_CLASS(klass)->decide_allocation = GST_DEBUG_FUNCPTR(gst_undistort_decide_allocation);
+    /* 默认走拷贝路径：输入只读映射，直接 remap 到下游 pool 的输出帧；
+     * transform_frame_ip 只在被配置为 in-place 时作为回退 */
+    vfilter_class->transform_frame = GST_DEBUG_FUNCPTR(gst_undistort_transform_frame);
     vfilter_class->transform_frame_ip = GST_DEBUG_FUNCPTR(gst_undistort_transform_frame_ip);
 
     GST_DEBUG_CATEGORY_INIT(gst_undistort_debug, "undistort", 0, "Undistort filter");
@@ -139,9 +706,58 @@ gst_undistort_init(GstUndistort *self) {
     self->silent = FALSE;
     self->fx = self->fy = self->cx = self->cy = 0.0;
     self->k1 = self->k2 = self->p1 = self->p2 = self->k3 = 0.0;
+    self->k4 = 0.0;
+    self->camera_model = DEFAULT_CAMERA_MODEL;
+    self->map_format = DEFAULT_MAP_FORMAT;
+    self->backend = DEFAULT_BACKEND;
+    self->n_threads = DEFAULT_N_THREADS;
+    self->luma_only = DEFAULT_LUMA_ONLY;
+    self->mesh_step_x = DEFAULT_MESH_STEP_X;
+    self->mesh_step_y = DEFAULT_MESH_STEP_Y;
+    self->max_mesh_error = DEFAULT_MAX_MESH_ERROR;
+    self->map_cache_dir = NULL;
+    self->alpha = DEFAULT_ALPHA;
+    self->stats_interval = DEFAULT_STATS_INTERVAL;
+    /* 下游来不及时丢掉已过期的帧并发 QoS 消息：没有请求 pad 时由基类在 transform 之前丢，
+     * 有请求 pad 时由元素只跳过 src pad 这一路（gst_undistort_src_event） */
+    gst_base_transform_set_qos_enabled(GST_BASE_TRANSFORM(self), TRUE);
+
+    /* 私有数据含 C++ 成员，需要显式构造，在 finalize 里析构 */
+    auto *priv = new(gst_undistort_get_instance_private(self)) GstUndistortPrivate();
+    priv->mesh_error = 0.0;
+    priv->pending = nullptr;
+    priv->generation = 0;
+    priv->rebuild_requested = 0;
+    priv->rebuild_outputs = 0;
+    priv->rebuild_quit = FALSE;
+    priv->negotiated = FALSE;
+    priv->next_pad_index = 0;
+    priv->next_output = 1;
+    priv->srcpads_cookie = 0;
+    priv->src_qos.earliest_time = GST_CLOCK_TIME_NONE;
+    priv->src_qos.proportion = 1.0;
+    priv->src_qos.processed = priv->src_qos.dropped = 0;
+    undistort_timer_reset(&priv->remap_stats);
+    undistort_timer_reset(&priv->copy_stats);
+    undistort_timer_reset(&priv->build_stats);
+    priv->frames_processed = 0;
+    priv->frames_bypassed = 0;
+    priv->table_bytes = 0;
+    priv->stats_last_post = 0;
+    priv->dmabuf_sync_warned = FALSE;
+    priv->outputs_cookie = 0;
+}
 
+/* finalize：停止后台重建线程与线程池并析构私有数据 */
+static void
+gst_undistort_finalize(GObject *object) {
+    auto *self = GST_UNDISTORT(object);
     auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
-    priv->maps_ready = FALSE;
+
+    gst_undistort_stop_rebuild(priv);
+    g_free(self->map_cache_dir);
+    priv->~GstUndistortPrivate();
+    G_OBJECT_CLASS(parent_class)->finalize(object);
 }
 
 /* 属性读写 */
@@ -151,23 +767,96 @@ gst_undistort_set_property(GObject *object, guint prop_id, const GValue *value,
     switch (prop_id) {
         case PROP_SILENT: self->silent = g_value_get_boolean(value);
             break;
-        case PROP_FX: self->fx = g_value_get_double(value);
+        case PROP_FX:
+        case PROP_FY:
+        case PROP_CX:
+        case PROP_CY:
+        case PROP_K1:
+        case PROP_K2:
+        case PROP_P1:
+        case PROP_P2:
+        case PROP_K3: {
+            /* 标定参数可在 PLAYING 中修改：写入后请求后台重建，流线程继续用旧表 */
+            gdouble *field[] = {
+                &self->fx, &self->fy, &self->cx, &self->cy,
+                &self->k1, &self->k2, &self->p1, &self->p2, &self->k3
+            };
+            const gdouble v = g_value_get_double(value);
+            GST_OBJECT_LOCK(self);
+            const gboolean changed = *field[prop_id - PROP_FX] != v;
+            *field[prop_id - PROP_FX] = v;
+            GST_OBJECT_UNLOCK(self);
+            if (changed)
+                gst_undistort_request_rebuild(self, GST_UNDISTORT_ALL_OUTPUTS);
+            break;
+        }
+        case PROP_K4:
+        case PROP_CAMERA_MODEL: {
+            GST_OBJECT_LOCK(self);
+            gboolean changed;
+            if (prop_id == PROP_K4) {
+                changed = self->k4 != g_value_get_double(value);
+                self->k4 = g_value_get_double(value);
+            } else {
+                changed = self->camera_model != (GstUndistortCameraModel) g_value_get_enum(value);
+                self->camera_model = (GstUndistortCameraModel) g_value_get_enum(value);
+            }
+            GST_OBJECT_UNLOCK(self);
+            if (changed)
+                gst_undistort_request_rebuild(self, GST_UNDISTORT_ALL_OUTPUTS);
             break;
-        case PROP_FY: self->fy = g_value_get_double(value);
+        }
+        /* 以下几项在（重新）协商时由 gst_undistort_params_init 在对象锁内读取，PLAYING 中也可能被修改 */
+        case PROP_MAP_FORMAT:
+            GST_OBJECT_LOCK(self);
+            self->map_format = (GstUndistortMapFormat) g_value_get_enum(value);
+            GST_OBJECT_UNLOCK(self);
             break;
-        case PROP_CX: self->cx = g_value_get_double(value);
+        case PROP_BACKEND:
+            GST_OBJECT_LOCK(self);
+            self->backend = (GstUndistortBackend) g_value_get_enum(value);
+            GST_OBJECT_UNLOCK(self);
             break;
-        case PROP_CY: self->cy = g_value_get_double(value);
+        case PROP_N_THREADS:
+            /* 流线程在每帧的 gst_undistort_ensure_pool 里读取 */
+            GST_OBJECT_LOCK(self);
+            self->n_threads = g_value_get_uint(value);
+            GST_OBJECT_UNLOCK(self);
             break;
-        case PROP_K1: self->k1 = g_value_get_double(value);
+        case PROP_LUMA_ONLY: self->luma_only = g_value_get_boolean(value);
             break;
-        case PROP_K2: self->k2 = g_value_get_double(value);
+        case PROP_MESH_STEP_X:
+            GST_OBJECT_LOCK(self);
+            self->mesh_step_x = g_value_get_uint(value);
+            GST_OBJECT_UNLOCK(self);
             break;
-        case PROP_P1: self->p1 = g_value_get_double(value);
+        case PROP_MESH_STEP_Y:
+            GST_OBJECT_LOCK(self);
+            self->mesh_step_y = g_value_get_uint(value);
+            GST_OBJECT_UNLOCK(self);
             break;
-        case PROP_P2: self->p2 = g_value_get_double(value);
+        case PROP_MAX_MESH_ERROR:
+            GST_OBJECT_LOCK(self);
+            self->max_mesh_error = g_value_get_double(value);
+            GST_OBJECT_UNLOCK(self);
             break;
-        case PROP_K3: self->k3 = g_value_get_double(value);
+        case PROP_MAP_CACHE_DIR: {
+            /* 在锁内换指针，旧字符串解锁后再释放 */
+            gchar *dir = g_value_dup_string(value);
+            GST_OBJECT_LOCK(self);
+            std::swap(self->map_cache_dir, dir);
+            GST_OBJECT_UNLOCK(self);
+            g_free(dir);
+            break;
+        }
+        case PROP_ALPHA:
+            GST_OBJECT_LOCK(self);
+            self->alpha = g_value_get_double(value);
+            GST_OBJECT_UNLOCK(self);
+            /* 输出尺寸可能变化，让 src pad 重新协商 */
+            gst_base_transform_reconfigure_src(GST_BASE_TRANSFORM(self));
+            break;
+        case PROP_STATS_INTERVAL: self->stats_interval = g_value_get_uint(value);
             break;
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
@@ -198,94 +887,2334 @@ gst_undistort_get_property(GObject *object, guint prop_id, GValue *value, GParam
             break;
         case PROP_K3: g_value_set_double(value, self->k3);
             break;
+        case PROP_MAP_FORMAT: g_value_set_enum(value, self->map_format);
+            break;
+        case PROP_BACKEND: g_value_set_enum(value, self->backend);
+            break;
+        case PROP_N_THREADS:
+            GST_OBJECT_LOCK(self);
+            g_value_set_uint(value, self->n_threads);
+            GST_OBJECT_UNLOCK(self);
+            break;
+        case PROP_LUMA_ONLY: g_value_set_boolean(value, self->luma_only);
+            break;
+        case PROP_MESH_STEP_X: g_value_set_uint(value, self->mesh_step_x);
+            break;
+        case PROP_MESH_STEP_Y: g_value_set_uint(value, self->mesh_step_y);
+            break;
+        case PROP_MAX_MESH_ERROR: g_value_set_double(value, self->max_mesh_error);
+            break;
+        case PROP_MAP_CACHE_DIR:
+            GST_OBJECT_LOCK(self);
+            g_value_set_string(value, self->map_cache_dir);
+            GST_OBJECT_UNLOCK(self);
+            break;
+        case PROP_ALPHA: g_value_set_double(value, self->alpha);
+            break;
+        case PROP_K4: g_value_set_double(value, self->k4);
+            break;
+        case PROP_CAMERA_MODEL: g_value_set_enum(value, self->camera_model);
+            break;
+        case PROP_MESH_ERROR: {
+            auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+            g_value_set_double(value, priv->mesh_error.load(std::memory_order_relaxed));
+            break;
+        }
+        case PROP_STATS: g_value_take_boxed(value, gst_undistort_stats_structure(self));
+            break;
+        case PROP_STATS_INTERVAL: g_value_set_uint(value, self->stats_interval);
+            break;
+        case PROP_FRAMES_PROCESSED: {
+            auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+            g_value_set_uint64(value, priv->frames_processed.load(std::memory_order_relaxed));
+            break;
+        }
+        case PROP_FRAMES_BYPASSED: {
+            auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+            g_value_set_uint64(value, priv->frames_bypassed.load(std::memory_order_relaxed));
+            break;
+        }
         default:
             G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
     }
 }
 
-/* 在协商阶段初始化 VideoInfo 并预计算 remap 映射表 */
+/* 各格式的平面布局：分量数、尺寸来源与使用的映射表。
+ * YUY2 只作为输入（按 2 通道包装，格式转换路径再拆成亮度/色度采样源） */
+typedef struct {
+    GstVideoFormat format;
+    guint n_planes;
+    GstUndistortPlane planes[3];
+} GstUndistortLayout;
+
+static const GstUndistortLayout *
+gst_undistort_find_layout(GstVideoFormat format) {
+    static const GstUndistortLayout layouts[] = {
+        {GST_VIDEO_FORMAT_BGR, 1, {{3, 0, GST_UNDISTORT_TABLE_LUMA, NULL}}},
+        {GST_VIDEO_FORMAT_BGRx, 1, {{4, 0, GST_UNDISTORT_TABLE_LUMA, NULL}}},
+        {GST_VIDEO_FORMAT_GRAY8, 1, {{1, 0, GST_UNDISTORT_TABLE_LUMA, NULL}}},
+        {
+            GST_VIDEO_FORMAT_NV12, 2, {
+                {1, 0, GST_UNDISTORT_TABLE_LUMA, NULL},
+                {2, 1, GST_UNDISTORT_TABLE_CHROMA, NULL}
+            }
+        },
+        {
+            GST_VIDEO_FORMAT_I420, 3, {
+                {1, 0, GST_UNDISTORT_TABLE_LUMA, NULL},
+                {1, 1, GST_UNDISTORT_TABLE_CHROMA, NULL},
+                {1, 2, GST_UNDISTORT_TABLE_CHROMA, NULL}
+            }
+        },
+        {GST_VIDEO_FORMAT_YUY2, 1, {{2, 0, GST_UNDISTORT_TABLE_LUMA, NULL}}},
+    };
+
+    for (const auto &layout: layouts) {
+        if (layout.format == format)
+            return &layout;
+    }
+    return NULL;
+}
+
+/* 按输入格式描述各平面，同格式输出时逐平面 remap */
 static gboolean
-gst_undistort_set_info(GstVideoFilter *filter,
-                       GstCaps *incaps, GstVideoInfo *in_info,
-                       GstCaps *outcaps, GstVideoInfo *out_info) {
-    auto *self = GST_UNDISTORT(filter);
-    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+gst_undistort_setup_planes(GstUndistortPrivate *priv, GstVideoFormat format) {
+    const GstUndistortLayout *layout = gst_undistort_find_layout(format);
+    if (!layout) {
+        priv->n_planes = 0;
+        return FALSE;
+    }
+    priv->n_planes = layout->n_planes;
+    for (guint p = 0; p < layout->n_planes; ++p)
+        priv->planes[p] = layout->planes[p];
+    return TRUE;
+}
 
-    priv->info = *in_info;
+static gboolean
+gst_undistort_format_is_yuv(GstVideoFormat format) {
+    return format == GST_VIDEO_FORMAT_NV12 || format == GST_VIDEO_FORMAT_I420 || format == GST_VIDEO_FORMAT_YUY2;
+}
 
-    const int w = GST_VIDEO_INFO_WIDTH(&priv->info);
-    const int h = GST_VIDEO_INFO_HEIGHT(&priv->info);
+static gboolean
+gst_undistort_format_is_rgb(GstVideoFormat format) {
+    return format == GST_VIDEO_FORMAT_BGR || format == GST_VIDEO_FORMAT_BGRx;
+}
 
-    /* 如果没设置内参，就退化为“恒等映射”（不做矫正） */
-    if (self->fx <= 0 || self->fy <= 0) {
-        GST_WARNING_OBJECT(self, "fx/fy not set, bypassing undistortion (identity map).");
-        priv->mapx.release();
-        priv->mapy.release();
-        priv->maps_ready = FALSE;
+/* 支持的融合转换：YUV（含 YUY2）-> NV12/I420/GRAY8/BGR/BGRx，BGR <-> BGRx；不输出 YUY2 */
+static gboolean
+gst_undistort_can_convert(GstVideoFormat in, GstVideoFormat out) {
+    if (out == GST_VIDEO_FORMAT_YUY2 || !gst_undistort_find_layout(in) || !gst_undistort_find_layout(out))
+        return FALSE;
+    if (in == out || gst_undistort_format_is_yuv(in))
+        return TRUE;
+    return gst_undistort_format_is_rgb(in) && gst_undistort_format_is_rgb(out);
+}
+
+/* 输出是否需要色度表：输出本身有色度平面，或由 YUV 转 BGR（按 4:2:0 样点采样色度） */
+static gboolean
+gst_undistort_needs_chroma(GstVideoFormat in, GstVideoFormat out) {
+    if (out == GST_VIDEO_FORMAT_NV12 || out == GST_VIDEO_FORMAT_I420)
+        return TRUE;
+    return gst_undistort_format_is_yuv(in) && gst_undistort_format_is_rgb(out);
+}
+
+/* 由输入/输出格式决定一路输出的转换方式 */
+static gboolean
+gst_undistort_setup_convert(const GstVideoInfo *in_info, const GstVideoInfo *out_info, GstUndistortConvert *convert) {
+    const GstVideoFormat in = GST_VIDEO_INFO_FORMAT(in_info);
+    const GstVideoFormat out = GST_VIDEO_INFO_FORMAT(out_info);
+    const UndistortIsa isa = undistort_kernels_detect_isa();
+    const int width = GST_VIDEO_INFO_WIDTH(out_info);
+
+    memset(convert, 0, sizeof(*convert));
+    if (in == out) {
+        convert->mode = GST_UNDISTORT_CONVERT_NONE;
+        return TRUE;
+    }
+    if (!gst_undistort_can_convert(in, out))
+        return FALSE;
+
+    if (gst_undistort_format_is_rgb(in)) {
+        convert->mode = GST_UNDISTORT_CONVERT_REPACK;
+        convert->rgb_kernel = undistort_kernels_get(in == GST_VIDEO_FORMAT_BGR ? 3 : 4, isa);
+        convert->line_size = (size_t) width * 4;
         return TRUE;
     }
 
-    /* 准备 K/D 并生成映射表（CV_32FC1） */
-    priv->cameraMatrix = (cv::Mat_<double>(3, 3) << self->fx, 0, self->cx,
-                          0, self->fy, self->cy,
-                          0, 0, 1);
-    priv->distCoeffs = (cv::Mat_<double>(1, 5) << self->k1, self->k2, self->p1, self->p2, self->k3);
+    /* 平面亮度走 SIMD 内核，YUY2 亮度与所有色度走标量采样（色度只有亮度的一半） */
+    if (in != GST_VIDEO_FORMAT_YUY2)
+        convert->luma_kernel = undistort_kernels_get(1, isa);
+    if (gst_undistort_format_is_rgb(out)) {
+        gdouble kr, kb;
+        if (!gst_video_color_matrix_get_Kr_Kb(GST_VIDEO_INFO_COLORIMETRY(in_info).matrix, &kr, &kb)) {
+            kr = 0.299;
+            kb = 0.114;
+        }
+        undistort_yuv_to_rgb_init(&convert->yuv2rgb, kr, kb,
+                                  GST_VIDEO_INFO_COLORIMETRY(in_info).range == GST_VIDEO_COLOR_RANGE_0_255);
+        convert->mode = GST_UNDISTORT_CONVERT_BGR;
+        convert->line_size = (size_t) width + 2 * (size_t) ((width + 1) / 2);
+    } else {
+        convert->mode = GST_UNDISTORT_CONVERT_YUV;
+    }
+    return TRUE;
+}
+
+/* 实际使用的相机模型：没设置内参时的虚拟相机总是无畸变的针孔 */
+static UndistortCameraModel
+gst_undistort_camera_model(const GstUndistortParams *params) {
+    if (params->fx <= 0 || params->fy <= 0)
+        return UNDISTORT_MODEL_PINHOLE;
+    return (UndistortCameraModel) params->camera_model;
+}
+
+/* 准备 K/D；没设置内参时用无畸变的虚拟相机，只剩裁剪/缩放/视角 */
+static void
+gst_undistort_camera(const GstUndistortParams *params, cv::Mat *cameraMatrix, cv::Mat *distCoeffs) {
+    if (params->fx <= 0 || params->fy <= 0) {
+        *cameraMatrix = (cv::Mat_<double>(3, 3) << params->in_width, 0, 0.5 * (params->in_width - 1),
+                         0, params->in_width, 0.5 * (params->in_height - 1),
+                         0, 0, 1);
+        *distCoeffs = cv::Mat::zeros(1, 5, CV_64F);
+        return;
+    }
+    *cameraMatrix = (cv::Mat_<double>(3, 3) << params->fx, 0, params->cx,
+                     0, params->fy, params->cy,
+                     0, 0, 1);
+    if (params->camera_model == GST_UNDISTORT_CAMERA_MODEL_FISHEYE)
+        *distCoeffs = (cv::Mat_<double>(1, 4) << params->k1, params->k2, params->k3, params->k4);
+    else
+        *distCoeffs = (cv::Mat_<double>(1, 5) << params->k1, params->k2, params->p1, params->p2, params->k3);
+}
+
+/* mesh 格式的平面只保留网格 */
+static void
+gst_undistort_plane_map_mesh_only(UndistortPlaneMap *map) {
+    map->map1.release();
+    map->map2.release();
+    map->interp = cv::INTER_LINEAR;
+}
+
+/* map-format=mesh 且步长固定时直接在网格采样点上按相机模型求值，不生成全分辨率浮点表
+ * （4K 下两张表 66 MB，生成它们也是协商耗时的大头），结果与先生成稠密表再采样在 float 精度内一致。
+ * 没有稠密表，误差改为在每个网格单元中心抽样估计 */
+static void
+gst_undistort_build_mesh_tables(GstUndistort *self, const GstUndistortParams *params, GstUndistortTables *tables,
+                                UndistortCameraModel model, const cv::Mat &K, const cv::Mat &D, const cv::Mat &R,
+                                const cv::Mat &P, cv::Size size, cv::Size csize) {
+    const int step_x = (int) params->mesh_step_x, step_y = (int) params->mesh_step_y;
+    cv::Mat gx, gy;
+    double max_error, rms_error;
+
+    if (csize.area() > 0) {
+        UndistortPlaneMap *chroma = &tables->maps[GST_UNDISTORT_TABLE_CHROMA];
+        undistort_maps_init_chroma_grid(model, K, D, R, P, size, params->chroma_sub_y,
+                                        undistort_mesh_sample_coords(csize.width, step_x),
+                                        undistort_mesh_sample_coords(csize.height, step_y), gx, gy);
+        gst_undistort_plane_map_mesh_only(chroma);
+        undistort_mesh_build_sampled(&chroma->mesh, csize.width, csize.height, step_x, step_y, gx, gy);
+
+        const std::vector<int> cols = undistort_mesh_centre_coords(csize.width, step_x);
+        const std::vector<int> rows = undistort_mesh_centre_coords(csize.height, step_y);
+        undistort_maps_init_chroma_grid(model, K, D, R, P, size, params->chroma_sub_y, cols, rows, gx, gy);
+        undistort_mesh_error_sampled(&chroma->mesh, cols, rows, gx, gy, &max_error, &rms_error);
+        GST_INFO_OBJECT(self, "chroma mesh max error %.4f px (cell centres)", max_error);
+    }
+
+    UndistortPlaneMap *luma = &tables->maps[GST_UNDISTORT_TABLE_LUMA];
+    undistort_maps_init_grid(model, K, D, R, P, undistort_mesh_sample_coords(size.width, step_x),
+                             undistort_mesh_sample_coords(size.height, step_y), gx, gy);
+    gst_undistort_plane_map_mesh_only(luma);
+    undistort_mesh_build_sampled(&luma->mesh, size.width, size.height, step_x, step_y, gx, gy);
+
+    const std::vector<int> cols = undistort_mesh_centre_coords(size.width, step_x);
+    const std::vector<int> rows = undistort_mesh_centre_coords(size.height, step_y);
+    undistort_maps_init_grid(model, K, D, R, P, cols, rows, gx, gy);
+    undistort_mesh_error_sampled(&luma->mesh, cols, rows, gx, gy, &max_error, &rms_error);
+    tables->mesh_error = max_error;
+    GST_INFO_OBJECT(self, "output %u: mesh sampled directly from the camera model, rms error %.4f px (cell centres)",
+                    params->output, rms_error);
+}
+
+/* 生成映射表：先生成全分辨率浮点表，再按 map-format 转换，色度表（csize 非空时）从浮点表推导；
+ * 固定步长的 mesh 不经过浮点表，见 gst_undistort_build_mesh_tables */
+static void
+gst_undistort_build_tables(GstUndistort *self, const GstUndistortParams *params, GstUndistortTables *tables,
+                           cv::Size size, cv::Size csize) {
+    const auto type = (UndistortMapType) params->map_format;
+
+    cv::Mat cameraMatrix, distCoeffs;
+    gst_undistort_camera(params, &cameraMatrix, &distCoeffs);
+
+    /* 视角优先；否则 alpha < 0 沿用原内参（输出尺寸不同时按比例缩放），alpha >= 0 只输出有效区域并缩放到输出尺寸 */
+    const UndistortCameraModel model = gst_undistort_camera_model(params);
+    const cv::Size in_size(params->in_width, params->in_height);
+    cv::Mat newCameraMatrix = cameraMatrix, R;
+    if (!undistort_view_is_default(&params->view)) {
+        const UndistortView *view = &params->view;
+        undistort_maps_view(cameraMatrix, view, in_size, size, &R, &newCameraMatrix);
+        GST_INFO_OBJECT(self, "output %u view: yaw %.1f pitch %.1f roll %.1f zoom %.2f roi %dx%d+%d+%d -> %dx%d",
+                        params->output, view->yaw, view->pitch, view->roll, view->zoom, view->roi.width,
+                        view->roi.height, view->roi.x, view->roi.y, size.width, size.height);
+    } else if (params->alpha >= 0 && model == UNDISTORT_MODEL_FISHEYE) {
+        newCameraMatrix = undistort_maps_fisheye_camera_matrix(cameraMatrix, distCoeffs, in_size, params->alpha,
+                                                               size);
+        GST_INFO_OBJECT(self, "fisheye balance %.2f -> %dx%d", params->alpha, size.width, size.height);
+    } else if (params->alpha >= 0) {
+        cv::Rect valid;
+        newCameraMatrix = undistort_maps_new_camera_matrix(cameraMatrix, distCoeffs, in_size,
+                                                           params->alpha, size, &valid);
+        GST_INFO_OBJECT(self, "alpha %.2f: valid region %dx%d+%d+%d -> %dx%d", params->alpha,
+                        valid.width, valid.height, valid.x, valid.y, size.width, size.height);
+    } else if (size != in_size) {
+        newCameraMatrix = undistort_maps_scale_camera_matrix(cameraMatrix, in_size, size);
+        GST_INFO_OBJECT(self, "scaling %dx%d -> %dx%d in the maps", in_size.width, in_size.height,
+                        size.width, size.height);
+    }
+
+    if (type == UNDISTORT_MAP_MESH && params->max_mesh_error <= 0) {
+        gst_undistort_build_mesh_tables(self, params, tables, model, cameraMatrix, distCoeffs, R, newCameraMatrix,
+                                        size, csize);
+        return;
+    }
+
+    /* 稠密表格式，以及按误差选步长（要用稠密表测量每个候选） */
+    cv::Mat mapx, mapy;
+    undistort_maps_init(model, cameraMatrix, distCoeffs, R, newCameraMatrix, size, mapx, mapy);
+
+    /* 按误差选 mesh 步长（以亮度为准），色度网格用同一步长 */
+    int step_x = (int) params->mesh_step_x, step_y = (int) params->mesh_step_y;
+    double mesh_error = -1.0;
+    if (type == UNDISTORT_MAP_MESH && params->max_mesh_error > 0) {
+        const gint64 start = g_get_monotonic_time();
+        UndistortMesh *mesh = &tables->maps[GST_UNDISTORT_TABLE_LUMA].mesh;
+        double rms_error;
+        undistort_mesh_build_adaptive(mesh, mapx, mapy, step_x, step_y, params->max_mesh_error, &mesh_error,
+                                      &rms_error);
+        step_x = mesh->step_x;
+        step_y = mesh->step_y;
+        if (mesh_error > params->max_mesh_error)
+            GST_WARNING_OBJECT(self, "output %u: finest mesh step %dx%d still has %.4f px error (max-mesh-error %.4f)",
+                               params->output, step_x, step_y, mesh_error, params->max_mesh_error);
+        GST_INFO_OBJECT(self, "output %u: mesh step %dx%d for max-mesh-error %.4f px: max %.4f px, rms %.4f px "
+                        "(chosen in %" G_GINT64_FORMAT " ms)", params->output, step_x, step_y,
+                        params->max_mesh_error, mesh_error, rms_error, (g_get_monotonic_time() - start) / 1000);
+    }
+
+    if (csize.area() > 0) {
+        cv::Mat cmapx, cmapy;
+        undistort_maps_derive_chroma(mapx, mapy, csize, params->chroma_sub_y, cmapx, cmapy);
+        undistort_plane_map_from_float(&tables->maps[GST_UNDISTORT_TABLE_CHROMA], cmapx, cmapy, type,
+                                       step_x, step_y);
+        if (type == UNDISTORT_MAP_MESH) {
+            GST_INFO_OBJECT(self, "chroma mesh max error %.4f px",
+                            undistort_mesh_max_error(&tables->maps[GST_UNDISTORT_TABLE_CHROMA].mesh, cmapx, cmapy));
+        }
+    }
+    /* 自适应时亮度网格已经生成 */
+    if (mesh_error < 0) {
+        undistort_plane_map_from_float(&tables->maps[GST_UNDISTORT_TABLE_LUMA], mapx, mapy, type, step_x, step_y);
+    } else {
+        gst_undistort_plane_map_mesh_only(&tables->maps[GST_UNDISTORT_TABLE_LUMA]);
+    }
+
+    /* 网格误差以亮度为准（色度误差按色度像素计，单独打印） */
+    if (type == UNDISTORT_MAP_MESH)
+        tables->mesh_error = mesh_error >= 0 ? mesh_error
+                                             : undistort_mesh_max_error(&tables->maps[GST_UNDISTORT_TABLE_LUMA].mesh,
+                                                                        mapx, mapy);
+}
+
+/* 缓存 key：标定参数、分辨率、表格式与后端，未用到的字段保持 0 */
+static void
+gst_undistort_cache_key(const GstUndistortParams *params, UndistortCacheKey *key) {
+    memset(key, 0, sizeof(*key));
+    key->fx = params->fx;
+    key->fy = params->fy;
+    key->cx = params->cx;
+    key->cy = params->cy;
+    key->k1 = params->k1;
+    key->k2 = params->k2;
+    key->p1 = params->p1;
+    key->p2 = params->p2;
+    key->k3 = params->k3;
+    key->alpha = params->alpha;
+    key->in_width = params->in_width;
+    key->in_height = params->in_height;
+    key->width = params->width;
+    key->height = params->height;
+    key->chroma_width = params->chroma_width;
+    key->chroma_height = params->chroma_height;
+    if (params->chroma_width > 0)
+        key->chroma_sub_y = params->chroma_sub_y;
+    key->map_type = params->map_format;
+    if (params->map_format == GST_UNDISTORT_MAP_FORMAT_MESH) {
+        key->mesh_step_x = (int32_t) params->mesh_step_x;
+        key->mesh_step_y = (int32_t) params->mesh_step_y;
+        key->max_mesh_error = params->max_mesh_error;
+    }
+    g_strlcpy(key->backend, undistort_backend_name(params->backend), sizeof(key->backend));
+    key->camera_model = gst_undistort_camera_model(params);
+    if (key->camera_model == UNDISTORT_MODEL_FISHEYE) {
+        key->k4 = params->k4;
+        key->p1 = key->p2 = 0; /* 鱼眼模型不用切向系数 */
+    }
+    if (!undistort_view_is_default(&params->view)) {
+        key->yaw = params->view.yaw;
+        key->pitch = params->view.pitch;
+        key->roll = params->view.roll;
+        key->zoom = params->view.zoom;
+        key->roi_x = params->view.roi.x;
+        key->roi_y = params->view.roi.y;
+        key->roi_width = params->view.roi.width;
+        key->roi_height = params->view.roi.height;
+    }
+}
+
+/* 为 fixed 表生成块网格：每块的源工作集不超过 L2 的一半 */
+static void
+gst_undistort_build_tiles(GstUndistort *self, const GstUndistortParams *params, GstUndistortTables *tables) {
+    const size_t budget = undistort_tiles_l2_size() / 2;
+
+    for (int t = 0; t < GST_UNDISTORT_N_TABLES; ++t) {
+        const UndistortPlaneMap *map = &tables->maps[t];
+        if (map->map1.empty() || map->map2.empty())
+            continue;
+        /* 同格式输出时色度源平面与色度表同为 4:2:0 */
+        const gboolean chroma = t == GST_UNDISTORT_TABLE_CHROMA;
+        const int src_width = chroma ? (params->in_width + 1) / 2 : params->in_width;
+        const int src_height = chroma ? (params->in_height + 1) / 2 : params->in_height;
+        UndistortTileGrid *grid = &tables->tiles[t];
+        undistort_tiles_build(grid, map->map1.ptr<int16_t>(), map->map1.step[0] / sizeof(int16_t),
+                              map->map1.cols, map->map1.rows, src_width, src_height,
+                              params->bytes_per_pixel[t], budget, 0, 0);
+        GST_INFO_OBJECT(self, "%s tiles %dx%d (%dx%d), max source working set %zu bytes (budget %zu)",
+                        chroma ? "chroma" : "luma", grid->tile_w, grid->tile_h, grid->cols, grid->rows,
+                        grid->max_working_set, budget);
+    }
+}
+
+/* 按 params 生成一组表（先查磁盘缓存）。只读 params，可在流线程或后台重建线程上调用 */
+static GstUndistortTables *
+gst_undistort_tables_new(GstUndistort *self, const GstUndistortParams *params) {
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    const gint64 build_start = g_get_monotonic_time();
+    auto *tables = new GstUndistortTables();
+    tables->params = *params;
+    tables->mesh_error = 0.0;
+    tables->mesh_row_size = 0;
+    tables->bytes = 0;
+
+    /* 如果没设置内参且不需要缩放、转换、换视角，就退化为“恒等映射”（不做矫正） */
+    tables->identity = (params->fx <= 0 || params->fy <= 0) && !params->convert &&
+                       params->width == params->in_width && params->height == params->in_height &&
+                       undistort_view_is_default(&params->view);
+    if (tables->identity)
+        return tables;
+
+    const cv::Size size(params->width, params->height);
+    const cv::Size csize(params->chroma_width, params->chroma_height);
+
+    UndistortCacheKey key;
+    gst_undistort_cache_key(params, &key);
+    if (!params->cache_dir.empty()) {
+        std::string why;
+        tables->cache_file = undistort_cache_load(params->cache_dir.c_str(), &key, tables->maps,
+                                                  GST_UNDISTORT_N_TABLES, &tables->mesh_error, &why);
+        if (tables->cache_file)
+            GST_INFO_OBJECT(self, "maps loaded from cache %s",
+                            undistort_cache_path(params->cache_dir.c_str(), &key).c_str());
+        else
+            GST_INFO_OBJECT(self, "map cache miss: %s", why.c_str());
+    }
+
+    if (!tables->cache_file) {
+        const gint64 start = g_get_monotonic_time();
+        gst_undistort_build_tables(self, params, tables, size, csize);
+        GST_INFO_OBJECT(self, "maps generated in %" G_GINT64_FORMAT " ms", (g_get_monotonic_time() - start) / 1000);
+
+        if (!params->cache_dir.empty()) {
+            std::string why;
+            if (g_mkdir_with_parents(params->cache_dir.c_str(), 0755) != 0 ||
+                !undistort_cache_store(params->cache_dir.c_str(), &key, tables->maps, GST_UNDISTORT_N_TABLES,
+                                       tables->mesh_error, &why)) {
+                /* 缓存只是加速，写不进去不影响处理 */
+                GST_WARNING_OBJECT(self, "failed to write map cache in %s: %s", params->cache_dir.c_str(),
+                                   why.empty() ? g_strerror(errno) : why.c_str());
+            }
+        }
+    }
+
+    /* 块网格不进缓存：只需扫一遍整数坐标，且取决于本机的 L2 */
+    if (params->backend == UNDISTORT_BACKEND_SIMD && !params->convert)
+        gst_undistort_build_tiles(self, params, tables);
+
+#ifdef HAVE_IDC
+    /* IDC 初始化失败时这组表退回 CPU 网格路径（表本身就是同一张网格） */
+    if (params->backend == UNDISTORT_BACKEND_IDC) {
+        std::string why;
+        UndistortIdc *idc = undistort_idc_new(params->in_width, params->in_height,
+                                              &tables->maps[GST_UNDISTORT_TABLE_LUMA].mesh, &why);
+        if (idc) {
+            tables->idc = std::shared_ptr<UndistortIdc>(idc, undistort_idc_free);
+        } else {
+            GST_WARNING_OBJECT(self, "output %u: %s, falling back to the mesh backend", params->output, why.c_str());
+            tables->params.backend = UNDISTORT_BACKEND_MESH;
+        }
+    }
+#endif
 
-    cv::initUndistortRectifyMap(priv->cameraMatrix, priv->distCoeffs, cv::Mat(),
-                                priv->cameraMatrix, cv::Size(w, h),
-                                CV_32FC1, priv->mapx, priv->mapy);
-    priv->scratch.release(); /* 将在第一帧按需分配 */
-    priv->maps_ready = TRUE;
+    if (params->map_format == GST_UNDISTORT_MAP_FORMAT_MESH) {
+        const UndistortMesh *mesh = &tables->maps[GST_UNDISTORT_TABLE_LUMA].mesh;
+        tables->mesh_row_size = undistort_mesh_row_buffer_size(mesh); /* 色度平面不比亮度宽 */
+        GST_INFO_OBJECT(self, "mesh %dx%d (step %dx%d), max error %.4f px", mesh->mesh_w, mesh->mesh_h,
+                        mesh->step_x, mesh->step_y, tables->mesh_error);
+    }
 
+    tables->bytes = undistort_plane_map_bytes(&tables->maps[GST_UNDISTORT_TABLE_LUMA]) +
+                    undistort_plane_map_bytes(&tables->maps[GST_UNDISTORT_TABLE_CHROMA]);
+    undistort_timer_record(&priv->build_stats, (uint64_t) (g_get_monotonic_time() - build_start));
     if (!self->silent) {
-        GST_INFO_OBJECT(self, "Prepared undistort maps (%dx%d).", w, h);
+        GST_INFO_OBJECT(self, "Prepared undistort maps (%dx%d, %s, %zu bytes).", params->width, params->height,
+                        g_enum_get_value(G_ENUM_CLASS(g_type_class_peek(GST_TYPE_UNDISTORT_MAP_FORMAT)),
+                                         params->map_format)->value_nick,
+                        tables->bytes);
+    }
+    return tables;
+}
+
+/* 从属性读出标定参数（属性可能在其他线程被修改，持对象锁读取） */
+static void
+gst_undistort_read_calibration(GstUndistort *self, GstUndistortParams *params) {
+    GST_OBJECT_LOCK(self);
+    params->fx = self->fx;
+    params->fy = self->fy;
+    params->cx = self->cx;
+    params->cy = self->cy;
+    params->k1 = self->k1;
+    params->k2 = self->k2;
+    params->p1 = self->p1;
+    params->p2 = self->p2;
+    params->k3 = self->k3;
+    params->k4 = self->k4;
+    params->camera_model = self->camera_model;
+    GST_OBJECT_UNLOCK(self);
+}
+
+/* 读出一路输出的视角：0 为 src pad（无视角），其余从对应的请求 pad 读取 */
+static void
+gst_undistort_read_view(GstUndistort *self, GstUndistortPrivate *priv, guint output, UndistortView *view) {
+    view->yaw = view->pitch = view->roll = 0.0;
+    view->zoom = 1.0;
+    view->roi = cv::Rect();
+    if (output == 0)
+        return;
+
+    GST_OBJECT_LOCK(self);
+    for (auto &sp: priv->srcpads) {
+        if (sp->output != output)
+            continue;
+        GstUndistortViewPad *vpad = GST_UNDISTORT_VIEW_PAD(sp->pad);
+        GST_OBJECT_LOCK(vpad);
+        view->yaw = vpad->yaw;
+        view->pitch = vpad->pitch;
+        view->roll = vpad->roll;
+        view->zoom = vpad->zoom;
+        if (vpad->roi_width > 0 && vpad->roi_height > 0)
+            view->roi = cv::Rect(vpad->roi_x, vpad->roi_y, vpad->roi_width, vpad->roi_height);
+        GST_OBJECT_UNLOCK(vpad);
+        break;
+    }
+    GST_OBJECT_UNLOCK(self);
+}
+
+/* alpha >= 0 时输入 in_w x in_h 对应的默认输出尺寸（有效区域）；返回 FALSE 表示输出与输入同尺寸 */
+static gboolean
+gst_undistort_output_size(GstUndistort *self, gint in_w, gint in_h, gint *out_w, gint *out_h) {
+    GstUndistortParams params;
+    gst_undistort_read_calibration(self, &params);
+    GST_OBJECT_LOCK(self);
+    params.alpha = self->alpha;
+    GST_OBJECT_UNLOCK(self);
+    /* 鱼眼模型没有针孔意义上的有效矩形，输出保持输入尺寸 */
+    if (params.alpha < 0 || params.fx <= 0 || params.fy <= 0 ||
+        params.camera_model == GST_UNDISTORT_CAMERA_MODEL_FISHEYE)
+        return FALSE;
+
+    params.in_width = in_w;
+    params.in_height = in_h;
+    cv::Mat cameraMatrix, distCoeffs;
+    gst_undistort_camera(&params, &cameraMatrix, &distCoeffs);
+    const cv::Size size = undistort_maps_valid_size(cameraMatrix, distCoeffs, cv::Size(in_w, in_h), params.alpha);
+    *out_w = size.width;
+    *out_h = size.height;
+    return TRUE;
+}
+
+/* 把一端 caps 里的 format（单个或列表）换算成另一端可以转换到的其他格式。
+ * same_family=TRUE 只取 YUV 之间的转换（像素值的色彩含义不变，保留 colorimetry），
+ * FALSE 只取跨族的转换（YUV <-> RGB/GRAY8）；结果为空时返回 FALSE */
+static gboolean
+gst_undistort_transform_formats(const GValue *formats, GstPadDirection direction, gboolean same_family,
+                                GValue *result) {
+    static const GstVideoFormat candidates[] = {
+        GST_VIDEO_FORMAT_NV12, GST_VIDEO_FORMAT_I420, GST_VIDEO_FORMAT_YUY2,
+        GST_VIDEO_FORMAT_BGR, GST_VIDEO_FORMAT_BGRx, GST_VIDEO_FORMAT_GRAY8,
+    };
+    std::vector<GstVideoFormat> from, to;
+
+    if (G_VALUE_HOLDS_STRING(formats)) {
+        from.push_back(gst_video_format_from_string(g_value_get_string(formats)));
+    } else if (GST_VALUE_HOLDS_LIST(formats)) {
+        for (guint i = 0; i < gst_value_list_get_size(formats); ++i) {
+            const GValue *v = gst_value_list_get_value(formats, i);
+            if (G_VALUE_HOLDS_STRING(v))
+                from.push_back(gst_video_format_from_string(g_value_get_string(v)));
+        }
     }
 
-    if (cv::ocl::haveOpenCL()) {
-        cv::ocl::setUseOpenCL(true);//检测到系统支持 OpenCL 时自动启用 ，前提是 OpenCV 编译时已启用 OpenCL 支持
+    for (GstVideoFormat f: from) {
+        for (GstVideoFormat c: candidates) {
+            const gboolean ok = direction == GST_PAD_SINK ? gst_undistort_can_convert(f, c)
+                                                          : gst_undistort_can_convert(c, f);
+            const gboolean yuv = gst_undistort_format_is_yuv(f) && gst_undistort_format_is_yuv(c);
+            if (!ok || c == f || yuv != same_family)
+                continue;
+            if (std::find(to.begin(), to.end(), c) == to.end())
+                to.push_back(c);
+        }
+    }
+    if (to.empty())
+        return FALSE;
+
+    g_value_init(result, GST_TYPE_LIST);
+    for (GstVideoFormat c: to) {
+        GValue v = G_VALUE_INIT;
+        g_value_init(&v, G_TYPE_STRING);
+        g_value_set_string(&v, gst_video_format_to_string(c));
+        gst_value_list_append_and_take_value(result, &v);
     }
     return TRUE;
 }
 
-/* 帧内把 frame 映射成 cv::Mat，remap 到临时图，再拷回 */
-static GstFlowReturn
-gst_undistort_transform_frame_ip(GstVideoFilter *filter, GstVideoFrame *frame) {
-    auto *self = GST_UNDISTORT(filter);
+/* 内存类型：输出总在系统内存；反推输入时系统内存优先，其次 DMABuf */
+static GstCaps *
+gst_undistort_caps_memory(GstCaps *caps, GstPadDirection direction) {
+    GstCaps *ret = gst_caps_new_empty();
+    for (guint i = 0; i < gst_caps_get_size(caps); ++i) {
+        ret = gst_caps_merge_structure_full(ret, gst_structure_copy(gst_caps_get_structure(caps, i)),
+                                            gst_caps_features_new(GST_CAPS_FEATURE_MEMORY_SYSTEM_MEMORY, NULL));
+    }
+    if (direction == GST_PAD_SRC) {
+        for (guint i = 0; i < gst_caps_get_size(caps); ++i) {
+            ret = gst_caps_merge_structure_full(ret, gst_structure_copy(gst_caps_get_structure(caps, i)),
+                                                gst_caps_features_new(GST_CAPS_FEATURE_MEMORY_DMABUF, NULL));
+        }
+    }
+    gst_caps_unref(caps);
+    return ret;
+}
+
+/* 输出尺寸与格式都可以与输入不同（像 videoscale + videoconvert，缩放与转换都融合在 remap 里）。
+ * 结构按优先顺序排列：
+ *  1. sink -> src 且尺寸固定时的默认尺寸（alpha >= 0 时为有效区域，否则与输入相同），格式不变
+ *  2. 任意尺寸，格式不变
+ *  3. 任意尺寸，YUV 之间的转换（保留 colorimetry）
+ *  4. 任意尺寸，YUV <-> RGB/GRAY8 与 BGR <-> BGRx（去掉 colorimetry） */
+static GstCaps *
+gst_undistort_transform_caps(GstBaseTransform *trans, GstPadDirection direction, GstCaps *caps, GstCaps *filter) {
+    auto *self = GST_UNDISTORT(trans);
+    GstCaps *ret = gst_caps_new_empty();
+
+    for (guint i = 0; i < gst_caps_get_size(caps); ++i) {
+        const GstStructure *in = gst_caps_get_structure(caps, i);
+        GstCapsFeatures *features = gst_caps_get_features(caps, i);
+        const gchar *name = gst_structure_get_string(in, "format");
+        const GstVideoFormat format = name ? gst_video_format_from_string(name) : GST_VIDEO_FORMAT_UNKNOWN;
+        /* 同格式只在这个格式也能出现在另一端时成立（YUY2 只能作为输入） */
+        const gboolean same_ok = format != GST_VIDEO_FORMAT_UNKNOWN && gst_undistort_can_convert(format, format);
+        const GValue *formats = gst_structure_get_value(in, "format");
+        GValue yuv = G_VALUE_INIT, other = G_VALUE_INIT;
+        const gboolean have_yuv = formats && gst_undistort_transform_formats(formats, direction, TRUE, &yuv);
+        const gboolean have_other = formats && gst_undistort_transform_formats(formats, direction, FALSE, &other);
+
+        GstStructure *any = gst_structure_copy(in);
+        gst_structure_set(any, "width", GST_TYPE_INT_RANGE, 1, G_MAXINT,
+                          "height", GST_TYPE_INT_RANGE, 1, G_MAXINT, NULL);
+
+        gint w, h, out_w, out_h;
+        if (direction == GST_PAD_SINK && gst_structure_get_int(in, "width", &w) &&
+            gst_structure_get_int(in, "height", &h) && (same_ok || !name || have_yuv || have_other)) {
+            if (!gst_undistort_output_size(self, w, h, &out_w, &out_h)) {
+                out_w = w;
+                out_h = h;
+            }
+            GstStructure *preferred = gst_structure_copy(in);
+            gst_structure_set(preferred, "width", G_TYPE_INT, out_w, "height", G_TYPE_INT, out_h, NULL);
+            if (name && !same_ok) {
+                gst_structure_set_value(preferred, "format", have_yuv ? &yuv : &other);
+                gst_structure_remove_field(preferred, "chroma-site");
+                if (!have_yuv)
+                    gst_structure_remove_field(preferred, "colorimetry");
+            }
+            gst_caps_append_structure_full(ret, preferred, gst_caps_features_copy(features));
+        }
+        /* format 为列表或未指定时原样保留（另一端的模板会再过滤一次） */
+        if (same_ok || !name)
+            gst_caps_append_structure_full(ret, gst_structure_copy(any), gst_caps_features_copy(features));
+        if (have_yuv) {
+            GstStructure *st = gst_structure_copy(any);
+            gst_structure_set_value(st, "format", &yuv);
+            gst_structure_remove_field(st, "chroma-site");
+            gst_caps_append_structure_full(ret, st, gst_caps_features_copy(features));
+            g_value_unset(&yuv);
+        }
+        if (have_other) {
+            GstStructure *st = gst_structure_copy(any);
+            gst_structure_set_value(st, "format", &other);
+            gst_structure_remove_fields(st, "colorimetry", "chroma-site", NULL);
+            gst_caps_append_structure_full(ret, st, gst_caps_features_copy(features));
+            g_value_unset(&other);
+        }
+        gst_structure_free(any);
+    }
+
+    ret = gst_undistort_caps_memory(ret, direction);
+
+    if (filter) {
+        GstCaps *tmp = gst_caps_intersect_full(filter, ret, GST_CAPS_INTERSECT_FIRST);
+        gst_caps_unref(ret);
+        ret = tmp;
+    }
+    GST_DEBUG_OBJECT(self, "transformed %" GST_PTR_FORMAT " into %" GST_PTR_FORMAT, caps, ret);
+    return ret;
+}
+
+/* 输出宽高未定时取最接近有效区域尺寸的值 */
+static GstCaps *
+gst_undistort_fixate_caps(GstBaseTransform *trans, GstPadDirection direction, GstCaps *caps, GstCaps *othercaps) {
+    auto *self = GST_UNDISTORT(trans);
+    const GstStructure *in = gst_caps_get_structure(caps, 0);
+    gint w, h, out_w, out_h;
+
+    othercaps = gst_caps_truncate(othercaps);
+    othercaps = gst_caps_make_writable(othercaps);
+    if (direction == GST_PAD_SINK && gst_structure_get_int(in, "width", &w) && gst_structure_get_int(in, "height", &h)) {
+        GstStructure *out = gst_caps_get_structure(othercaps, 0);
+        if (!gst_undistort_output_size(self, w, h, &out_w, &out_h)) {
+            out_w = w;
+            out_h = h;
+        }
+        gst_structure_fixate_field_nearest_int(out, "width", out_w);
+        gst_structure_fixate_field_nearest_int(out, "height", out_h);
+    }
+    return gst_caps_fixate(othercaps);
+}
+
+/* 释放一组后台发布的表；缓存命中时表指向只读映射，随 cache_file 一起释放 */
+static void
+gst_undistort_table_set_free(GstUndistortTableSet *set) {
+    delete set;
+}
+
+/* 只复制标定参数（fx..k3），其余参数保持协商时的值 */
+static void
+gst_undistort_copy_calibration(GstUndistortParams *dst, const GstUndistortParams *src) {
+    dst->fx = src->fx;
+    dst->fy = src->fy;
+    dst->cx = src->cx;
+    dst->cy = src->cy;
+    dst->k1 = src->k1;
+    dst->k2 = src->k2;
+    dst->p1 = src->p1;
+    dst->p2 = src->p2;
+    dst->k3 = src->k3;
+    dst->k4 = src->k4;
+    dst->camera_model = src->camera_model;
+}
+
+/* 后台重建线程：合并连续的属性修改，只为最新的一次生成受影响输出的表（标定参数变化时为所有输出，
+ * 视角变化时只有该输出），然后整组发布到 pending */
+static void
+gst_undistort_rebuild_main(GstUndistort *self) {
     auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    guint64 done = 0;
+
+    std::unique_lock<std::mutex> guard(priv->rebuild_lock);
+    for (;;) {
+        priv->rebuild_cond.wait(guard, [&] { return priv->rebuild_quit || priv->rebuild_requested != done; });
+        if (priv->rebuild_quit)
+            return;
+        done = priv->rebuild_requested;
+        const guint64 outputs = priv->rebuild_outputs;
+        priv->rebuild_outputs = 0;
+        std::vector<GstUndistortParams> bases = priv->rebuild_base;
+        guard.unlock();
 
-    const int w = GST_VIDEO_FRAME_WIDTH(frame);
-    const int h = GST_VIDEO_FRAME_HEIGHT(frame);
-    guint8 *data = static_cast<guint8 *>(GST_VIDEO_FRAME_PLANE_DATA(frame, 0));
-    const int stride = GST_VIDEO_FRAME_PLANE_STRIDE(frame, 0);
+        /* 各路输出使用同一份标定参数，流线程在同一帧边界一起换上 */
+        GstUndistortParams calib;
+        gst_undistort_read_calibration(self, &calib);
+        auto *set = new GstUndistortTableSet();
+        for (auto &params: bases) {
+            if (!(outputs & GST_UNDISTORT_OUTPUT_BIT(params.output)))
+                continue;
+            gst_undistort_copy_calibration(&params, &calib);
+            gst_undistort_read_view(self, priv, params.output, &params.view);
+            set->outputs.emplace_back(gst_undistort_tables_new(self, &params));
+        }
+        /* 上一组还没被取走时，保留其中这次没有重建的输出（只改了某一路视角时不丢掉别的输出） */
+        GstUndistortTableSet *old = priv->pending.exchange(nullptr, std::memory_order_acq_rel);
+        if (old) {
+            for (auto &tables: old->outputs) {
+                if (!(outputs & GST_UNDISTORT_OUTPUT_BIT(tables->params.output)))
+                    set->outputs.emplace_back(std::move(tables));
+            }
+            gst_undistort_table_set_free(old);
+        }
+        /* 期间重新协商过的输出由流线程按代次丢弃 */
+        gst_undistort_table_set_free(priv->pending.exchange(set, std::memory_order_acq_rel));
+        GST_DEBUG_OBJECT(self, "rebuilt tables for %zu output(s) published", set->outputs.size());
 
-    /* 当 maps 不可用时直接旁路（比如没设置 fx/fy） */
-    if (!priv->maps_ready || priv->mapx.empty() || priv->mapy.empty()) {
-        return GST_FLOW_OK;
+        guard.lock();
     }
+}
 
-    /* OpenCV 视图：注意 stride */
-    cv::Mat img(h, w, CV_8UC3, data, (size_t) stride);
-
-    if (priv->scratch.empty() || priv->scratch.cols != w || priv->scratch.rows != h)
-        priv->scratch.create(h, w, CV_8UC3);
-
-    // CV_16SC2只适合INTER_NEAREST插值方式
-    // CV_32FC1可适合INTER_LINEAR插值方式，但会慢一些
-    cv::remap(img, priv->scratch, priv->mapx, priv->mapy, cv::INTER_LINEAR); //INTER_LINEAR
-    std::memcpy(data, priv->scratch.data, (size_t) h * stride);
-    // /* 若步长一致可整块 memcpy，否则逐行 */
-    // if ((int)priv->scratch.step[0] == stride) {
-    //   std::memcpy(data, priv->scratch.data, (size_t)h * stride);
-    // } else {
-    //   for (int y = 0; y < h; ++y) {
-    //     std::memcpy(data + y * stride, priv->scratch.ptr(y), (size_t)w * 3);
-    //   }
-    // }
-
-    // if (!self->silent) {
-    //   GST_LOG_OBJECT (self, "undistort applied.");
-    // }
-    return GST_FLOW_OK;
+/* 属性线程：标定参数或视角变化后请求后台重建 outputs 中的输出（尚未协商时由 set_info 生成） */
+static void
+gst_undistort_request_rebuild(GstUndistort *self, guint64 outputs) {
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    std::lock_guard<std::mutex> guard(priv->rebuild_lock);
+    if (!priv->negotiated)
+        return;
+    ++priv->rebuild_requested;
+    priv->rebuild_outputs |= outputs;
+    if (!priv->rebuild_thread.joinable())
+        priv->rebuild_thread = std::thread(gst_undistort_rebuild_main, self);
+    priv->rebuild_cond.notify_one();
+}
+
+/* 停止后台重建线程并丢弃未取走的表 */
+static void
+gst_undistort_stop_rebuild(GstUndistortPrivate *priv) {
+    {
+        std::lock_guard<std::mutex> guard(priv->rebuild_lock);
+        priv->rebuild_quit = TRUE;
+        priv->negotiated = FALSE;
+        priv->rebuild_cond.notify_one();
+    }
+    if (priv->rebuild_thread.joinable())
+        priv->rebuild_thread.join();
+    gst_undistort_table_set_free(priv->pending.exchange(nullptr));
+}
+
+/* 记录一路输出最近一次协商的参数，后台重建以它为基础 */
+static void
+gst_undistort_set_rebuild_base(GstUndistortPrivate *priv, const GstUndistortParams *params) {
+    std::lock_guard<std::mutex> guard(priv->rebuild_lock);
+    priv->negotiated = TRUE;
+    for (auto &base: priv->rebuild_base) {
+        if (base.output == params->output) {
+            base = *params;
+            return;
+        }
+    }
+    priv->rebuild_base.push_back(*params);
+}
+
+static void
+gst_undistort_drop_rebuild_base(GstUndistortPrivate *priv, guint output) {
+    std::lock_guard<std::mutex> guard(priv->rebuild_lock);
+    for (auto it = priv->rebuild_base.begin(); it != priv->rebuild_base.end(); ++it) {
+        if (it->output == output) {
+            priv->rebuild_base.erase(it);
+            return;
+        }
+    }
+}
+
+/* 恒等映射且没有请求 pad 时直接透传，既不拷贝也不要求 buffer 可写 */
+static void
+gst_undistort_update_passthrough(GstUndistort *self, GstUndistortPrivate *priv) {
+    gst_base_transform_set_passthrough(GST_BASE_TRANSFORM(self),
+                                       priv->tables && priv->tables->identity && priv->outputs.empty());
+}
+
+/* 流线程：给 src pad 换上一组新表（协商或帧边界），并按是否恒等映射切换 passthrough */
+static void
+gst_undistort_install_tables(GstUndistort *self, GstUndistortPrivate *priv, GstUndistortTables *tables) {
+    priv->tables.reset(tables);
+    priv->mesh_error.store(tables->mesh_error, std::memory_order_relaxed);
+    if (tables->identity)
+        GST_WARNING_OBJECT(self, "fx/fy not set, bypassing undistortion (identity map).");
+    gst_undistort_update_passthrough(self, priv);
+}
+
+/* 按输入/输出格式与当前属性填写一路输出的表参数，并分配新的协商代次 */
+static void
+gst_undistort_params_init(GstUndistort *self, GstUndistortPrivate *priv, const GstVideoInfo *in_info,
+                          const GstVideoInfo *out_info, guint output, GstUndistortParams *params) {
+    /* 表格式等参数只在协商时读取；标定参数之后可在 PLAYING 中修改，由后台线程重建 */
+    /* 表按输出尺寸生成（可以比输入小，缩放烘焙在表里） */
+    params->in_width = GST_VIDEO_INFO_WIDTH(in_info);
+    params->in_height = GST_VIDEO_INFO_HEIGHT(in_info);
+    params->width = GST_VIDEO_INFO_WIDTH(out_info);
+    params->height = GST_VIDEO_INFO_HEIGHT(out_info);
+    /* 4:2:0 的色度表尺寸为输出宽高的一半，奇数宽高时向上取整 */
+    const GstVideoFormat in_format = GST_VIDEO_INFO_FORMAT(in_info);
+    const GstVideoFormat out_format = GST_VIDEO_INFO_FORMAT(out_info);
+    params->chroma_width = params->chroma_height = 0;
+    if (gst_undistort_needs_chroma(in_format, out_format)) {
+        params->chroma_width = (params->width + 1) / 2;
+        params->chroma_height = (params->height + 1) / 2;
+    }
+    params->chroma_sub_y = in_format == GST_VIDEO_FORMAT_YUY2 ? 1 : 2;
+    params->convert = in_format != out_format;
+    /* I420 的 U/V 两个平面共用色度表，源工作集按两者之和 */
+    const GstUndistortLayout *layout = gst_undistort_find_layout(in_format);
+    params->bytes_per_pixel[GST_UNDISTORT_TABLE_LUMA] = params->bytes_per_pixel[GST_UNDISTORT_TABLE_CHROMA] = 0;
+    for (guint p = 0; layout && p < layout->n_planes; ++p)
+        params->bytes_per_pixel[layout->planes[p].table] += layout->planes[p].channels;
+    GST_OBJECT_LOCK(self);
+    params->alpha = self->alpha;
+    params->map_format = self->map_format;
+    params->mesh_step_x = self->mesh_step_x;
+    params->mesh_step_y = self->mesh_step_y;
+    params->max_mesh_error = self->max_mesh_error;
+    params->cache_dir = self->map_cache_dir ? self->map_cache_dir : "";
+    const auto requested = (UndistortBackend) self->backend;
+    GST_OBJECT_UNLOCK(self);
+    gst_undistort_read_calibration(self, params);
+    gst_undistort_read_view(self, priv, output, &params->view);
+
+    /* 按格式与本机能力选后端，后端决定表格式（格式转换只在定点坐标上实现） */
+    UndistortBackendQuery query;
+    query.map_type = (UndistortMapType) params->map_format;
+    query.nv12 = in_format == GST_VIDEO_FORMAT_NV12 && out_format == GST_VIDEO_FORMAT_NV12;
+    query.convert = params->convert;
+    query.isa = undistort_kernels_detect_isa();
+#ifdef HAVE_IDC
+    query.idc_built = true;
+#else
+    query.idc_built = false;
+#endif
+#ifdef HAVE_IDC_EMU
+    query.idc_emulated = true;
+#else
+    query.idc_emulated = false;
+#endif
+    UndistortBackendChoice choice;
+    undistort_backend_select(requested, &query, &choice);
+    params->backend = choice.backend;
+    params->map_format = (GstUndistortMapFormat) choice.map_type;
+    /* IDC 要求偶数步长：以 16x8 为基准，max-mesh-error 的候选（4x2 .. 256x128）都满足 */
+    if (params->backend == UNDISTORT_BACKEND_IDC) {
+        params->mesh_step_x = UNDISTORT_IDC_STEP_X;
+        params->mesh_step_y = UNDISTORT_IDC_STEP_Y;
+    }
+    if (choice.fallback)
+        GST_WARNING_OBJECT(self, "output %u (%s -> %s): backend %s (%s)", output,
+                           gst_video_format_to_string(in_format), gst_video_format_to_string(out_format),
+                           undistort_backend_name(choice.backend), choice.reason.c_str());
+    else
+        GST_INFO_OBJECT(self, "output %u (%s -> %s): backend %s (%s)", output,
+                        gst_video_format_to_string(in_format), gst_video_format_to_string(out_format),
+                        undistort_backend_name(choice.backend), choice.reason.c_str());
+
+    /* 新的代次让仍在后台生成的该输出旧尺寸的表作废 */
+    params->output = output;
+    params->generation = priv->generation.fetch_add(1, std::memory_order_acq_rel) + 1;
+}
+
+/* 在协商阶段初始化 VideoInfo 并同步生成 remap 映射表 */
+static gboolean
+gst_undistort_set_info(GstVideoFilter *filter,
+                       GstCaps *incaps, GstVideoInfo *in_info,
+                       GstCaps *outcaps, GstVideoInfo *out_info) {
+    auto *self = GST_UNDISTORT(filter);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    priv->info = *in_info;
+
+    if (!gst_undistort_setup_planes(priv, GST_VIDEO_INFO_FORMAT(&priv->info))) {
+        GST_ERROR_OBJECT(self, "unsupported format %s", GST_VIDEO_INFO_NAME(&priv->info));
+        return FALSE;
+    }
+    if (!gst_undistort_setup_convert(in_info, out_info, &priv->convert)) {
+        GST_ERROR_OBJECT(self, "cannot convert %s to %s", GST_VIDEO_INFO_NAME(in_info), GST_VIDEO_INFO_NAME(out_info));
+        return FALSE;
+    }
+
+    GstUndistortParams params;
+    gst_undistort_params_init(self, priv, in_info, out_info, 0, &params);
+    gst_undistort_set_rebuild_base(priv, &params);
+
+    gst_undistort_install_tables(self, priv, gst_undistort_tables_new(self, &params));
+
+    const UndistortIsa isa = undistort_kernels_detect_isa();
+    for (guint p = 0; p < priv->n_planes; ++p) {
+        /* fixed 表与 mesh 展开出的行坐标都交给专用内核，按表的实际格式在条带里选择 */
+        priv->planes[p].kernel = undistort_kernels_get(priv->planes[p].channels, isa);
+        priv->scratch[p].release(); /* 仅回退路径使用，按需分配 */
+    }
+    GST_DEBUG_OBJECT(self, "remap path: %s (%s), %u plane(s) (%s -> %s)",
+                     undistort_backend_name(priv->tables->params.backend), undistort_isa_name(isa),
+                     priv->n_planes, GST_VIDEO_INFO_NAME(in_info), GST_VIDEO_INFO_NAME(out_info));
+    return TRUE;
+}
+
+/* 把 sink pad 上的粘性事件依次转发到请求 pad，caps 换成该 pad 协商出的 caps */
+typedef struct {
+    GstPad *pad;
+    GstCaps *caps;
+} GstUndistortStickyForward;
+
+static gboolean
+gst_undistort_forward_sticky(GstPad *pad, GstEvent **event, gpointer user_data) {
+    auto *fwd = (GstUndistortStickyForward *) user_data;
+
+    if (GST_EVENT_TYPE(*event) == GST_EVENT_CAPS)
+        gst_pad_push_event(fwd->pad, gst_event_new_caps(fwd->caps));
+    else if (GST_EVENT_TYPE(*event) != GST_EVENT_EOS)
+        gst_pad_push_event(fwd->pad, gst_event_ref(*event));
+    return TRUE;
+}
+
+/* ---- buffer 分配 ---- */
+
+/* 每个平面的 stride 按 GST_UNDISTORT_ALIGN 对齐，行尾至少留一个向量宽度，尾部可以整向量读写。
+ * idc 后端的输出再在底部补到 IDC 要求的高度对齐，硬件直接写进输出 buffer */
+static void
+gst_undistort_video_alignment(const GstVideoInfo *info, gboolean idc, GstVideoAlignment *align) {
+    gst_video_alignment_reset(align);
+    const gint pstride = MAX(GST_VIDEO_INFO_COMP_PSTRIDE(info, 0), 1);
+    align->padding_right = (GST_UNDISTORT_ALIGN + pstride - 1) / pstride;
+    /* 4:2:0/4:2:2 的填充要是色度下采样的整数倍 */
+    align->padding_right = GST_ROUND_UP_2(align->padding_right);
+    for (guint i = 0; i < GST_VIDEO_MAX_PLANES; ++i)
+        align->stride_align[i] = GST_UNDISTORT_ALIGN - 1;
+    if (idc) {
+        const guint height = (guint) GST_VIDEO_INFO_HEIGHT(info);
+        align->padding_bottom = GST_ROUND_UP_N(height, UNDISTORT_IDC_DST_HEIGHT_ALIGN) - height;
+    }
+}
+
+/* 配置一个 video pool；video_meta 为 FALSE 时对方只认默认布局，不能改 stride（idc 输出退回内部缓冲加拷贝） */
+static gboolean
+gst_undistort_configure_pool(GstBufferPool *pool, GstCaps *caps, const GstVideoInfo *info, guint min, guint max,
+                             GstAllocator *allocator, const GstAllocationParams *params, gboolean video_meta,
+                             gboolean idc, guint *size) {
+    GstAllocationParams aligned = *params;
+    aligned.align = MAX(aligned.align, (gsize) GST_UNDISTORT_ALIGN - 1);
+
+    GstStructure *config = gst_buffer_pool_get_config(pool);
+    gst_buffer_pool_config_set_params(config, caps, MAX(*size, (guint) GST_VIDEO_INFO_SIZE(info)), min, max);
+    gst_buffer_pool_config_set_allocator(config, allocator, &aligned);
+    if (video_meta && gst_buffer_pool_has_option(pool, GST_BUFFER_POOL_OPTION_VIDEO_META)) {
+        gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_META);
+        if (gst_buffer_pool_has_option(pool, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)) {
+            GstVideoAlignment align;
+            gst_undistort_video_alignment(info, idc, &align);
+            gst_buffer_pool_config_add_option(config, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT);
+            gst_buffer_pool_config_set_video_alignment(config, &align);
+        }
+    }
+    if (!gst_buffer_pool_set_config(pool, config)) {
+        /* 下游的 pool 可能改了参数：接受它修改后的配置，只要还满足需要 */
+        config = gst_buffer_pool_get_config(pool);
+        if (!gst_buffer_pool_config_validate_params(config, caps, (guint) GST_VIDEO_INFO_SIZE(info), min, max) ||
+            !gst_buffer_pool_set_config(pool, config))
+            return FALSE;
+    }
+
+    /* 对齐与填充后的 buffer 大小由 pool 算出 */
+    config = gst_buffer_pool_get_config(pool);
+    gst_buffer_pool_config_get_params(config, NULL, size, NULL, NULL);
+    gst_structure_free(config);
+    return TRUE;
+}
+
+/* 上游 ALLOCATION：声明接受 GstVideoMeta，提议 64 字节对齐的 video pool */
+static gboolean
+gst_undistort_propose_allocation(GstBaseTransform *trans, GstQuery *decide_query, GstQuery *query) {
+    /* passthrough 时 buffer 原样交给下游，由基类转发下游的回复 */
+    if (decide_query == NULL)
+        return GST_BASE_TRANSFORM_CLASS(parent_class)->propose_allocation(trans, decide_query, query);
+
+    GstCaps *caps;
+    gboolean need_pool;
+    gst_query_parse_allocation(query, &caps, &need_pool);
+    GstVideoInfo info;
+    if (caps == NULL || !gst_video_info_from_caps(&info, caps))
+        return FALSE;
+
+    gst_query_add_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+    /* DMABuf 由上游自己分配，只声明接受 GstVideoMeta */
+    if (gst_caps_features_contains(gst_caps_get_features(caps, 0), GST_CAPS_FEATURE_MEMORY_DMABUF))
+        return TRUE;
+    GstAllocationParams params;
+    gst_allocation_params_init(&params);
+    params.align = GST_UNDISTORT_ALIGN - 1;
+    gst_query_add_allocation_param(query, NULL, &params);
+
+    if (need_pool) {
+        GstBufferPool *pool = gst_video_buffer_pool_new();
+        guint size = 0;
+        if (!gst_undistort_configure_pool(pool, caps, &info, GST_UNDISTORT_POOL_MIN, 0, NULL, &params, TRUE, FALSE,
+                                          &size)) {
+            GST_WARNING_OBJECT(trans, "failed to configure proposed pool");
+            gst_object_unref(pool);
+            return FALSE;
+        }
+        gst_query_add_allocation_pool(query, pool, size, GST_UNDISTORT_POOL_MIN, 0);
+        gst_object_unref(pool);
+    }
+    return TRUE;
+}
+
+/* 下游 ALLOCATION 回复：选出并配置 src pad 的输出 pool，写回 query 由基类激活。
+ * 在 set_info 之后调用，这时已经知道输出是否走 idc 后端 */
+static gboolean
+gst_undistort_decide_allocation(GstBaseTransform *trans, GstQuery *query) {
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(GST_UNDISTORT(trans));
+    GstCaps *caps;
+    gst_query_parse_allocation(query, &caps, NULL);
+    GstVideoInfo info;
+    if (caps == NULL || !gst_video_info_from_caps(&info, caps))
+        return FALSE;
+    const gboolean video_meta = gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+
+    GstAllocator *allocator = NULL;
+    GstAllocationParams params;
+    gst_allocation_params_init(&params);
+    const gboolean update_param = gst_query_get_n_allocation_params(query) > 0;
+    if (update_param)
+        gst_query_parse_nth_allocation_param(query, 0, &allocator, &params);
+
+    GstBufferPool *pool = NULL;
+    guint size = 0, min = 0, max = 0;
+    const gboolean update_pool = gst_query_get_n_allocation_pools(query) > 0;
+    if (update_pool)
+        gst_query_parse_nth_allocation_pool(query, 0, &pool, &size, &min, &max);
+    /* 下游没有 pool，或者它的 pool 不能按 GstVideoMeta 布局分配时用自己的 video pool */
+    if (pool && video_meta && !gst_buffer_pool_has_option(pool, GST_BUFFER_POOL_OPTION_VIDEO_ALIGNMENT)) {
+        GST_DEBUG_OBJECT(trans, "downstream pool %" GST_PTR_FORMAT " cannot align, using our own", pool);
+        gst_object_unref(pool);
+        pool = NULL;
+    }
+    if (pool == NULL)
+        pool = gst_video_buffer_pool_new();
+    min = MAX(min, (guint) GST_UNDISTORT_POOL_MIN);
+    if (max != 0)
+        max = MAX(max, min);
+
+    const gboolean idc = priv->tables && priv->tables->idc;
+    if (!gst_undistort_configure_pool(pool, caps, &info, min, max, allocator, &params, video_meta, idc, &size)) {
+        GST_ELEMENT_ERROR(trans, RESOURCE, SETTINGS, ("failed to configure output buffer pool"), (NULL));
+        gst_object_unref(pool);
+        if (allocator)
+            gst_object_unref(allocator);
+        return FALSE;
+    }
+    GST_DEBUG_OBJECT(trans, "output pool %" GST_PTR_FORMAT ": size %u, min %u, max %u, video meta %d", pool, size,
+                     min, max, video_meta);
+
+    params.align = MAX(params.align, (gsize) GST_UNDISTORT_ALIGN - 1);
+    if (update_param)
+        gst_query_set_nth_allocation_param(query, 0, allocator, &params);
+    else
+        gst_query_add_allocation_param(query, allocator, &params);
+    if (update_pool)
+        gst_query_set_nth_allocation_pool(query, 0, pool, size, min, max);
+    else
+        gst_query_add_allocation_pool(query, pool, size, min, max);
+
+    gst_object_unref(pool);
+    if (allocator)
+        gst_object_unref(allocator);
+    return TRUE;
+}
+
+/* 流线程：按下游要求的尺寸协商请求 pad，配置它的 buffer pool 并生成它自己的表 */
+static gboolean
+gst_undistort_srcpad_negotiate(GstUndistort *self, GstUndistortPrivate *priv, GstUndistortSrcPad *sp) {
+    auto *trans = GST_BASE_TRANSFORM(self);
+
+    GstCaps *incaps = gst_video_info_to_caps(&priv->info);
+    GstCaps *templ = gst_undistort_transform_caps(trans, GST_PAD_SINK, incaps, NULL);
+    GstCaps *peercaps = gst_pad_peer_query_caps(sp->pad, templ);
+    gst_caps_unref(templ);
+    if (gst_caps_is_empty(peercaps)) {
+        GST_WARNING_OBJECT(sp->pad, "downstream accepts none of %" GST_PTR_FORMAT, incaps);
+        gst_caps_unref(peercaps);
+        gst_caps_unref(incaps);
+        return FALSE;
+    }
+    GstCaps *outcaps = gst_undistort_fixate_caps(trans, GST_PAD_SINK, incaps, peercaps);
+    gst_caps_unref(incaps);
+
+    GstVideoInfo info;
+    if (!gst_video_info_from_caps(&info, outcaps)) {
+        GST_WARNING_OBJECT(sp->pad, "invalid caps %" GST_PTR_FORMAT, outcaps);
+        gst_caps_unref(outcaps);
+        return FALSE;
+    }
+    if (!gst_undistort_setup_convert(&priv->info, &info, &sp->convert)) {
+        GST_WARNING_OBJECT(sp->pad, "cannot convert %s to %s", GST_VIDEO_INFO_NAME(&priv->info),
+                           GST_VIDEO_INFO_NAME(&info));
+        gst_caps_unref(outcaps);
+        return FALSE;
+    }
+
+    GstUndistortStickyForward fwd = {sp->pad, outcaps};
+    gst_pad_sticky_events_foreach(GST_BASE_TRANSFORM_SINK_PAD(trans), gst_undistort_forward_sticky, &fwd);
+
+    /* 先生成表：是否走 idc 后端决定输出 buffer 的布局 */
+    GstUndistortParams params;
+    gst_undistort_params_init(self, priv, &priv->info, &info, sp->output, &params);
+    gst_undistort_set_rebuild_base(priv, &params);
+    std::unique_ptr<GstUndistortTables> tables(gst_undistort_tables_new(self, &params));
+
+    /* 每个请求 pad 自带一个 pool，输出 buffer 在帧之间复用；下游支持 GstVideoMeta 时按 64 字节对齐 */
+    if (sp->pool) {
+        gst_buffer_pool_set_active(sp->pool, FALSE);
+        gst_object_unref(sp->pool);
+    }
+    GstQuery *query = gst_query_new_allocation(outcaps, TRUE);
+    const gboolean video_meta = gst_pad_peer_query(sp->pad, query) &&
+                                gst_query_find_allocation_meta(query, GST_VIDEO_META_API_TYPE, NULL);
+    gst_query_unref(query);
+    GstAllocationParams alloc_params;
+    gst_allocation_params_init(&alloc_params);
+    guint size = 0;
+    sp->pool = gst_video_buffer_pool_new();
+    const gboolean pool_ok = gst_undistort_configure_pool(sp->pool, outcaps, &info, GST_UNDISTORT_POOL_MIN, 0, NULL,
+                                                          &alloc_params, video_meta, tables->idc != nullptr, &size) &&
+                             gst_buffer_pool_set_active(sp->pool, TRUE);
+    gst_caps_unref(outcaps);
+    if (!pool_ok) {
+        GST_ERROR_OBJECT(sp->pad, "failed to activate buffer pool");
+        return FALSE;
+    }
+
+    sp->info = info;
+    sp->tables.reset(tables.release());
+    sp->negotiated = TRUE;
+    GST_INFO_OBJECT(sp->pad, "negotiated %dx%d", GST_VIDEO_INFO_WIDTH(&info), GST_VIDEO_INFO_HEIGHT(&info));
+    return TRUE;
+}
+
+/* 流线程：请求 pad 增删后刷新快照，并协商新链接或下游要求重新协商的 pad */
+static void
+gst_undistort_refresh_outputs(GstUndistort *self, GstUndistortPrivate *priv) {
+    if (priv->srcpads_cookie.load(std::memory_order_acquire) != priv->outputs_cookie) {
+        GST_OBJECT_LOCK(self);
+        priv->outputs = priv->srcpads;
+        priv->outputs_cookie = priv->srcpads_cookie.load(std::memory_order_relaxed);
+        GST_OBJECT_UNLOCK(self);
+        gst_undistort_update_passthrough(self, priv);
+    }
+
+    for (auto &sp: priv->outputs) {
+        /* 未链接的 pad 不协商也不处理，链接时 pad 会被标记为需要重新协商 */
+        if (!gst_pad_is_linked(sp->pad))
+            continue;
+        if (!gst_pad_check_reconfigure(sp->pad) && sp->negotiated)
+            continue;
+        sp->negotiated = FALSE;
+        gst_undistort_srcpad_negotiate(self, priv, sp.get());
+    }
+}
+
+/* 一个计时器的各字段：<name>-count/-total-us/-avg-us/-max-us/-p50-us/-p90-us/-p99-us，
+ * 以及 <name>-histogram（按 2 的幂分桶的次数数组，见 gstundistort_stats.h） */
+static void
+gst_undistort_stats_add_timer(GstStructure *s, const char *name, const UndistortTimerStats *timer) {
+    UndistortTimerSnapshot snap;
+    undistort_timer_snapshot(timer, &snap);
+
+    const struct {
+        const char *suffix;
+        guint64 value;
+    } fields[] = {
+        {"count", snap.count},
+        {"total-us", snap.total_us},
+        {"avg-us", snap.count ? snap.total_us / snap.count : 0},
+        {"max-us", snap.max_us},
+        {"p50-us", undistort_timer_percentile(&snap, 0.50)},
+        {"p90-us", undistort_timer_percentile(&snap, 0.90)},
+        {"p99-us", undistort_timer_percentile(&snap, 0.99)},
+    };
+    for (const auto &f: fields) {
+        gchar *key = g_strdup_printf("%s-%s", name, f.suffix);
+        gst_structure_set(s, key, G_TYPE_UINT64, f.value, NULL);
+        g_free(key);
+    }
+
+    GValue hist = G_VALUE_INIT;
+    g_value_init(&hist, GST_TYPE_ARRAY);
+    for (guint64 h: snap.hist) {
+        GValue v = G_VALUE_INIT;
+        g_value_init(&v, G_TYPE_UINT64);
+        g_value_set_uint64(&v, h);
+        gst_value_array_append_and_take_value(&hist, &v);
+    }
+    gchar *key = g_strdup_printf("%s-histogram", name);
+    gst_structure_take_value(s, key, &hist);
+    g_free(key);
+}
+
+/* stats 属性与 undistort-stats 消息的内容（任何线程可调用） */
+static GstStructure *
+gst_undistort_stats_structure(GstUndistort *self) {
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    GstStructure *s = gst_structure_new("undistort-stats",
+                                        "frames-processed", G_TYPE_UINT64,
+                                        (guint64) priv->frames_processed.load(std::memory_order_relaxed),
+                                        "frames-bypassed", G_TYPE_UINT64,
+                                        (guint64) priv->frames_bypassed.load(std::memory_order_relaxed),
+                                        "table-bytes", G_TYPE_UINT64,
+                                        (guint64) priv->table_bytes.load(std::memory_order_relaxed),
+                                        NULL);
+    gst_undistort_stats_add_timer(s, "remap", &priv->remap_stats);
+    gst_undistort_stats_add_timer(s, "copy", &priv->copy_stats);
+    gst_undistort_stats_add_timer(s, "table-build", &priv->build_stats);
+    return s;
+}
+
+/* 流线程每帧调用：更新表内存，到了 stats-interval 就发一条 undistort-stats 元素消息 */
+static void
+gst_undistort_stats_tick(GstUndistort *self, GstUndistortPrivate *priv) {
+    guint64 bytes = priv->tables ? priv->tables->bytes : 0;
+    for (auto &sp: priv->outputs) {
+        if (sp->tables)
+            bytes += sp->tables->bytes;
+    }
+    priv->table_bytes.store(bytes, std::memory_order_relaxed);
+
+    const guint interval = self->stats_interval;
+    if (interval == 0)
+        return;
+    const gint64 now = g_get_monotonic_time();
+    if (priv->stats_last_post == 0) {
+        priv->stats_last_post = now;
+        return;
+    }
+    if (now - priv->stats_last_post < (gint64) interval * 1000)
+        return;
+    priv->stats_last_post = now;
+    gst_element_post_message(GST_ELEMENT(self),
+                             gst_message_new_element(GST_OBJECT(self), gst_undistort_stats_structure(self)));
+}
+
+/* 每个 buffer 处理前（包括 passthrough 时）在帧边界取走后台发布的新表，热路径上无锁 */
+static void
+gst_undistort_before_transform(GstBaseTransform *trans, GstBuffer *buffer) {
+    auto *self = GST_UNDISTORT(trans);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    gst_undistort_refresh_outputs(self, priv);
+    gst_undistort_stats_tick(self, priv);
+
+    if (priv->pending.load(std::memory_order_relaxed) == nullptr)
+        return;
+    GstUndistortTableSet *set = priv->pending.exchange(nullptr, std::memory_order_acq_rel);
+    if (!set)
+        return;
+    GST_DEBUG_OBJECT(self, "switching to rebuilt tables at %" GST_TIME_FORMAT,
+                     GST_TIME_ARGS(GST_BUFFER_PTS(buffer)));
+    /* 只换上代次与当前表相同的（期间重新协商过的输出已经有了新尺寸的表） */
+    for (auto &tables: set->outputs) {
+        const GstUndistortParams *params = &tables->params;
+        if (params->output == 0) {
+            if (priv->tables && priv->tables->params.generation == params->generation)
+                gst_undistort_install_tables(self, priv, tables.release());
+            continue;
+        }
+        for (auto &sp: priv->outputs) {
+            if (sp->output == params->output && sp->tables && sp->tables->params.generation == params->generation) {
+                sp->tables = std::move(tables);
+                break;
+            }
+        }
+    }
+    gst_undistort_table_set_free(set);
+}
+
+/* 线程数属性变化后在下一帧重建线程池（只在流线程上访问） */
+static UndistortWorkerPool *
+gst_undistort_ensure_pool(GstUndistort *self, GstUndistortPrivate *priv) {
+    GST_OBJECT_LOCK(self);
+    const guint n_threads = self->n_threads;
+    GST_OBJECT_UNLOCK(self);
+    const unsigned n = UndistortWorkerPool::resolve_threads(n_threads);
+    if (!priv->pool || priv->pool->size() != n) {
+        priv->pool.reset(new UndistortWorkerPool(n));
+        GST_DEBUG_OBJECT(self, "remap worker pool: %u threads", n);
+    }
+    return priv->pool.get();
+}
+
+/* 取一张定点表第 y 行的坐标：fixed 表直接指向表内，mesh 展开到 mesh_row */
+static inline void
+gst_undistort_map_row(const UndistortPlaneMap *map, int y, void *mesh_row,
+                      const int16_t **xy, const uint16_t **fxy) {
+    if (!map->mesh.xy.empty()) {
+        undistort_mesh_fixed_row(&map->mesh, y, mesh_row, xy, fxy);
+        return;
+    }
+    *xy = map->map1.ptr<int16_t>(y);
+    *fxy = map->map2.ptr<uint16_t>(y);
+}
+
+/* 输出行指针：dst 的 Mat 头是 const，但指向的输出帧可写 */
+static inline uint8_t *
+gst_undistort_row(const cv::Mat &m, int y) {
+    return m.data + (size_t) y * m.step[0];
+}
+
+/* 采样一行亮度：平面亮度走 SIMD 内核，YUY2 走标量采样 */
+static inline void
+gst_undistort_luma_row(const GstUndistortBandJob *job, const GstUndistortConvert *convert, uint8_t *dst,
+                       const int16_t *xy, const uint16_t *fxy, int n) {
+    if (convert->luma_kernel) {
+        const cv::Mat &src = job->src[0];
+        const UndistortSrcPlane splane = {src.data, src.step[0], src.cols, src.rows};
+        convert->luma_kernel(&splane, dst, xy, fxy, n);
+    } else {
+        uint8_t *const d[1] = {dst};
+        undistort_gather_row(&job->luma_src, d, 1, xy, fxy, n);
+    }
+}
+
+/* 格式转换输出的一个条带：亮度（或 BGR）行与色度行各自按比例切分 */
+static void
+gst_undistort_convert_band(const GstUndistortBandJob *job, const GstUndistortOutputJob *out, unsigned band,
+                           uint8_t *mesh_row, uint8_t *line) {
+    const GstUndistortConvert *convert = out->convert;
+    const UndistortPlaneMap *lmap = &out->tables->maps[GST_UNDISTORT_TABLE_LUMA];
+    const UndistortPlaneMap *cmap = &out->tables->maps[GST_UNDISTORT_TABLE_CHROMA];
+    const cv::Mat &dst = out->dst[0];
+    const int w = dst.cols;
+    const int y0 = (int) ((gint64) dst.rows * band / job->n_bands);
+    const int y1 = (int) ((gint64) dst.rows * (band + 1) / job->n_bands);
+    const int16_t *xy;
+    const uint16_t *fxy;
+
+    switch (convert->mode) {
+        case GST_UNDISTORT_CONVERT_REPACK: {
+            const cv::Mat &src = job->src[0];
+            const UndistortSrcPlane splane = {src.data, src.step[0], src.cols, src.rows};
+            for (int y = y0; y < y1; ++y) {
+                gst_undistort_map_row(lmap, y, mesh_row, &xy, &fxy);
+                convert->rgb_kernel(&splane, line, xy, fxy, w);
+                undistort_repack_row(line, src.channels(), gst_undistort_row(dst, y), dst.channels(), w);
+            }
+            break;
+        }
+        case GST_UNDISTORT_CONVERT_YUV: {
+            for (int y = y0; y < y1; ++y) {
+                gst_undistort_map_row(lmap, y, mesh_row, &xy, &fxy);
+                gst_undistort_luma_row(job, convert, gst_undistort_row(dst, y), xy, fxy, w);
+            }
+            if (out->dst[1].empty())
+                break; /* GRAY8 */
+
+            /* NV12 的 UV 交错在一个平面，I420 的 U/V 分在两个平面 */
+            const gboolean nv12 = out->dst[2].empty();
+            const int cw = out->dst[1].cols;
+            const int c0 = (int) ((gint64) out->dst[1].rows * band / job->n_bands);
+            const int c1 = (int) ((gint64) out->dst[1].rows * (band + 1) / job->n_bands);
+            for (int c = c0; c < c1; ++c) {
+                uint8_t *u = gst_undistort_row(out->dst[1], c);
+                uint8_t *v = nv12 ? u + 1 : gst_undistort_row(out->dst[2], c);
+                if (job->luma_only) {
+                    memset(u, 128, nv12 ? 2 * (size_t) cw : (size_t) cw);
+                    if (!nv12)
+                        memset(v, 128, cw);
+                    continue;
+                }
+                uint8_t *const d[2] = {u, v};
+                gst_undistort_map_row(cmap, c, mesh_row, &xy, &fxy);
+                undistort_gather_row(&job->chroma_src, d, nv12 ? 2 : 1, xy, fxy, cw);
+            }
+            break;
+        }
+        case GST_UNDISTORT_CONVERT_BGR: {
+            /* 亮度行与色度行采样到行缓冲，色度每两行输出共用一行，条带内按需更新 */
+            const int cw = (w + 1) / 2;
+            uint8_t *yline = line;
+            uint8_t *uvline = line + w;
+            uint8_t *const d[2] = {uvline, uvline + 1};
+            int last = -1;
+            if (job->luma_only)
+                memset(uvline, 128, 2 * (size_t) cw);
+            for (int y = y0; y < y1; ++y) {
+                gst_undistort_map_row(lmap, y, mesh_row, &xy, &fxy);
+                gst_undistort_luma_row(job, convert, yline, xy, fxy, w);
+                if (!job->luma_only && y / 2 != last) {
+                    last = y / 2;
+                    gst_undistort_map_row(cmap, last, mesh_row, &xy, &fxy);
+                    undistort_gather_row(&job->chroma_src, d, 2, xy, fxy, cw);
+                }
+                undistort_yuv_to_bgr_row(&convert->yuv2rgb, yline, uvline, gst_undistort_row(dst, y), dst.channels(), w);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/* 单个条带：每路输出的每个平面按比例切出 dst 与映射表的对应行，src 整帧可读 */
+static void
+gst_undistort_remap_band(void *user_data, unsigned band, unsigned worker) {
+    auto *job = (GstUndistortBandJob *) user_data;
+    auto *priv = job->priv;
+    const gint64 start = job->band_us ? g_get_monotonic_time() : 0;
+    uint8_t *mesh_rows = job->mesh_rows + (size_t) worker * job->mesh_row_size;
+    uint8_t *line = job->lines + (size_t) worker * job->line_size;
+
+    for (unsigned o = 0; o < job->n_outputs; ++o) {
+        const GstUndistortOutputJob *out = &job->outputs[o];
+        if (out->convert->mode != GST_UNDISTORT_CONVERT_NONE) {
+            gst_undistort_convert_band(job, out, band, mesh_rows, line);
+            continue;
+        }
+        for (guint p = 0; p < priv->n_planes; ++p) {
+            const GstUndistortPlane *plane = &priv->planes[p];
+            const UndistortPlaneMap *map = &out->tables->maps[plane->table];
+            const cv::Mat &src = job->src[p];
+            const cv::Mat &dst = out->dst[p];
+            const int y0 = (int) ((gint64) dst.rows * band / job->n_bands);
+            const int y1 = (int) ((gint64) dst.rows * (band + 1) / job->n_bands);
+
+            if (y0 == y1)
+                continue;
+            if (job->luma_only && plane->table == GST_UNDISTORT_TABLE_CHROMA) {
+                dst.rowRange(y0, y1).setTo(cv::Scalar::all(128));
+            } else if (!map->mesh.xy.empty()) {
+                const UndistortSrcPlane splane = {src.data, src.step[0], src.cols, src.rows};
+                undistort_mesh_remap_rows(&map->mesh, plane->kernel, &splane, dst.data, dst.step[0], y0, y1,
+                                          mesh_rows);
+            } else if (!out->tables->tiles[plane->table].tiles.empty()) {
+                /* 块行按条带比例切分，与按行切分一样每个条带只写自己的输出行 */
+                const UndistortTileGrid *grid = &out->tables->tiles[plane->table];
+                const UndistortSrcPlane splane = {src.data, src.step[0], src.cols, src.rows};
+                undistort_tiles_remap(grid, plane->kernel, &splane, plane->channels, dst.data, dst.step[0],
+                                      map->map1.ptr<int16_t>(), map->map1.step[0] / sizeof(int16_t),
+                                      map->map2.ptr<uint16_t>(), map->map2.step[0] / sizeof(uint16_t),
+                                      (int) ((gint64) grid->rows * band / job->n_bands),
+                                      (int) ((gint64) grid->rows * (band + 1) / job->n_bands));
+            } else if (!map->map2.empty() && map->map1.type() == CV_16SC2) {
+                const UndistortSrcPlane splane = {src.data, src.step[0], src.cols, src.rows};
+                undistort_remap_rows(plane->kernel, &splane, dst.data, dst.step[0], dst.cols,
+                                     map->map1.ptr<int16_t>(), map->map1.step[0] / sizeof(int16_t),
+                                     map->map2.ptr<uint16_t>(), map->map2.step[0] / sizeof(uint16_t),
+                                     y0, y1);
+            } else {
+                /* 不会到这里：专用内核后端的表总是 mesh 或 fixed，opencv 后端不进条带调度 */
+                cv::Mat rows = dst.rowRange(y0, y1);
+                cv::remap(src, rows, map->map1.rowRange(y0, y1),
+                          map->map2.empty() ? cv::Mat() : map->map2.rowRange(y0, y1), map->interp);
+            }
+        }
+    }
+
+    if (job->band_us) {
+        job->band_us[2 * band] = g_get_monotonic_time() - start;
+        job->band_us[2 * band + 1] = worker;
+    }
+}
+
+/* 按输入格式描述格式转换路径的采样源（亮度/色度或 BGR 分量） */
+static void
+gst_undistort_setup_gather(GstUndistortPrivate *priv, GstUndistortBandJob *job) {
+    const cv::Mat *src = job->src;
+    UndistortGatherSrc *luma = &job->luma_src;
+    UndistortGatherSrc *chroma = &job->chroma_src;
+
+    memset(luma, 0, sizeof(*luma));
+    memset(chroma, 0, sizeof(*chroma));
+    luma->comp[0] = src[0].data;
+    luma->n_comp = 1;
+    luma->pixel_stride = 1;
+    luma->stride = src[0].step[0];
+    luma->width = src[0].cols;
+    luma->height = src[0].rows;
+
+    switch (GST_VIDEO_INFO_FORMAT(&priv->info)) {
+        case GST_VIDEO_FORMAT_NV12:
+            *chroma = {{src[1].data, src[1].data + 1, NULL}, 2, 2, src[1].step[0], src[1].cols, src[1].rows};
+            break;
+        case GST_VIDEO_FORMAT_I420:
+            /* I420 的 U/V 平面 stride 相同 */
+            *chroma = {{src[1].data, src[2].data, NULL}, 2, 1, src[1].step[0], src[1].cols, src[1].rows};
+            break;
+        case GST_VIDEO_FORMAT_YUY2:
+            /* Y0 U Y1 V：亮度每 2 字节一个，色度每 4 字节一对，宽度减半 */
+            luma->pixel_stride = 2;
+            *chroma = {
+                {src[0].data + 1, src[0].data + 3, NULL}, 2, 4, src[0].step[0], (src[0].cols + 1) / 2, src[0].rows
+            };
+            break;
+        default:
+            break;
+    }
+}
+
+/* idc 后端的一路输出：整帧交给硬件。返回 FALSE（本帧 IDC 失败）时由调用者按 CPU 网格路径处理 */
+static gboolean
+gst_undistort_idc_remap(GstUndistort *self, const GstUndistortBandJob *job, const GstUndistortOutputJob *out) {
+#ifdef HAVE_IDC
+    std::string why;
+    if (undistort_idc_process(out->tables->idc.get(), job->src[0].data, job->src[0].step[0], job->src[1].data,
+                              job->src[1].step[0], out->dst[0].data, out->dst[0].step[0], out->dst[1].data,
+                              out->dst[1].step[0], &why))
+        return TRUE;
+    GST_WARNING_OBJECT(self, "output %u: %s, remapping this frame on the CPU", out->tables->params.output,
+                       why.c_str());
+#endif
+    return FALSE;
+}
+
+/* opencv 后端：每个平面整帧交给一次 cv::remap（fixed 表用 OpenCV 自己的定点实现），
+ * 并行由 OpenCV 自己的线程池决定（按应用的 cv::setNumThreads），不进元素的条带调度，
+ * 否则每个条带里的 cv::remap 还会再开线程。元素不改 OpenCV 的全局设置 */
+static void
+gst_undistort_opencv_remap(GstUndistort *self, GstUndistortPrivate *priv, const GstUndistortBandJob *job,
+                           const GstUndistortOutputJob *out) {
+    for (guint p = 0; p < priv->n_planes; ++p) {
+        const GstUndistortPlane *plane = &priv->planes[p];
+        const UndistortPlaneMap *map = &out->tables->maps[plane->table];
+        cv::Mat dst = out->dst[p];
+        if (self->luma_only && plane->table == GST_UNDISTORT_TABLE_CHROMA)
+            dst.setTo(cv::Scalar::all(128));
+        else
+            cv::remap(job->src[p], dst, map->map1, map->map2, map->interp);
+    }
+}
+
+/* 把 job->src 各平面按水平条带 remap 到每路输出（dst 与各自的映射表同尺寸），所有输出一次调度 */
+static void
+gst_undistort_remap(GstUndistort *self, GstUndistortPrivate *priv, GstUndistortBandJob *job) {
+    /* idc 与 opencv 后端的输出不进条带调度，其余输出照常一起处理 */
+    unsigned n = 0;
+    for (unsigned o = 0; o < job->n_outputs; ++o) {
+        if (job->outputs[o].tables->idc && gst_undistort_idc_remap(self, job, &job->outputs[o]))
+            continue;
+        if (job->outputs[o].tables->params.backend == UNDISTORT_BACKEND_OPENCV) {
+            gst_undistort_opencv_remap(self, priv, job, &job->outputs[o]);
+            continue;
+        }
+        if (n != o)
+            job->outputs[n] = job->outputs[o];
+        ++n;
+    }
+    job->n_outputs = n;
+    if (n == 0)
+        return;
+
+    UndistortWorkerPool *pool = gst_undistort_ensure_pool(self, priv);
+    int rows = 0;
+    size_t mesh_row_size = 0, line_size = 0;
+    for (unsigned o = 0; o < job->n_outputs; ++o) {
+        rows = MAX(rows, job->outputs[o].dst[0].rows);
+        mesh_row_size = MAX(mesh_row_size, job->outputs[o].tables->mesh_row_size);
+        line_size = MAX(line_size, job->outputs[o].convert->line_size);
+    }
+    const unsigned n_bands = MIN(pool->size(), (unsigned) rows);
+    const gboolean timed = gst_debug_category_get_threshold(GST_CAT_DEFAULT) >= GST_LEVEL_LOG;
+    gint64 *band_us = timed ? g_newa(gint64, 2 * n_bands) : NULL;
+
+    job->self = self;
+    job->priv = priv;
+    job->luma_only = self->luma_only;
+    gst_undistort_setup_gather(priv, job);
+    if (priv->mesh_rows.size() < pool->size() * mesh_row_size)
+        priv->mesh_rows.resize(pool->size() * mesh_row_size);
+    if (priv->lines.size() < pool->size() * line_size)
+        priv->lines.resize(pool->size() * line_size);
+    job->mesh_rows = priv->mesh_rows.data();
+    job->mesh_row_size = mesh_row_size;
+    job->lines = priv->lines.data();
+    job->line_size = line_size;
+    job->n_bands = n_bands;
+    job->band_us = band_us;
+    pool->run(n_bands, gst_undistort_remap_band, job);
+
+    if (timed) {
+        for (unsigned i = 0; i < n_bands; ++i)
+            GST_LOG_OBJECT(self, "band %u/%u luma rows [%d,%d) of %u output(s) worker %" G_GINT64_FORMAT
+                           ": %" G_GINT64_FORMAT " us",
+                           i, n_bands, (int) ((gint64) rows * i / n_bands),
+                           (int) ((gint64) rows * (i + 1) / n_bands), job->n_outputs,
+                           band_us[2 * i + 1], band_us[2 * i]);
+    }
+}
+
+/* 把帧的每个平面按该帧自身格式的布局包装成 cv::Mat（不拷贝，使用帧自身的 stride） */
+static void
+gst_undistort_wrap_frame(GstVideoFrame *frame, cv::Mat *planes) {
+    const GstUndistortLayout *layout = gst_undistort_find_layout(GST_VIDEO_FRAME_FORMAT(frame));
+    for (guint p = 0; p < layout->n_planes; ++p) {
+        const GstUndistortPlane *plane = &layout->planes[p];
+        planes[p] = cv::Mat(GST_VIDEO_FRAME_COMP_HEIGHT(frame, plane->comp),
+                            GST_VIDEO_FRAME_COMP_WIDTH(frame, plane->comp),
+                            CV_8UC(plane->channels),
+                            GST_VIDEO_FRAME_PLANE_DATA(frame, p),
+                            (size_t) GST_VIDEO_FRAME_PLANE_STRIDE(frame, p));
+    }
+}
+
+/* 一路输出的 QoS：输入 buffer 的运行时间不晚于该路下游报告的最早可用时间时，
+ * 这一路本帧不 remap 也不推送，并像 GstBaseTransform 一样发 QoS 消息报告已处理/丢弃的帧数
+ * （source 为消息来源：src pad 用元素本身，与基类一致；请求 pad 用 pad） */
+static gboolean
+gst_undistort_qos_drop(GstUndistort *self, GstPad *pad, GstUndistortQos *qos, GstObject *source, GstBuffer *buffer) {
+    const GstSegment *segment = &GST_BASE_TRANSFORM(self)->segment;
+    const GstClockTime timestamp = GST_BUFFER_PTS(buffer);
+
+    if (segment->format != GST_FORMAT_TIME || !GST_CLOCK_TIME_IS_VALID(timestamp))
+        return FALSE;
+    GST_OBJECT_LOCK(pad);
+    const GstClockTime earliest = qos->earliest_time;
+    const gdouble proportion = qos->proportion;
+    GST_OBJECT_UNLOCK(pad);
+    const GstClockTime qostime = gst_segment_to_running_time(segment, GST_FORMAT_TIME, timestamp);
+    if (!GST_CLOCK_TIME_IS_VALID(earliest) || !GST_CLOCK_TIME_IS_VALID(qostime) || qostime > earliest)
+        return FALSE;
+
+    qos->dropped++;
+    GST_DEBUG_OBJECT(pad, "skipping late frame: running time %" GST_TIME_FORMAT " <= earliest %"
+                     GST_TIME_FORMAT, GST_TIME_ARGS(qostime), GST_TIME_ARGS(earliest));
+    GstMessage *msg = gst_message_new_qos(source, FALSE, qostime,
+                                          gst_segment_to_stream_time(segment, GST_FORMAT_TIME, timestamp),
+                                          timestamp, GST_BUFFER_DURATION(buffer));
+    gst_message_set_qos_values(msg, GST_CLOCK_DIFF(qostime, earliest), proportion, 1000000);
+    gst_message_set_qos_stats(msg, GST_FORMAT_BUFFERS, qos->processed, qos->dropped);
+    gst_element_post_message(GST_ELEMENT(self), msg);
+    return TRUE;
+}
+
+/* src pad 这一路本帧是否因 QoS 跳过：只在有请求 pad 时由元素判断（否则基类已在 transform 之前丢帧） */
+static gboolean
+gst_undistort_src_qos_drop(GstUndistort *self, GstUndistortPrivate *priv, GstBuffer *buffer) {
+    if (priv->outputs.empty() || !gst_base_transform_is_qos_enabled(GST_BASE_TRANSFORM(self)))
+        return FALSE;
+    return gst_undistort_qos_drop(self, GST_BASE_TRANSFORM_SRC_PAD(self), &priv->src_qos, GST_OBJECT(self), buffer);
+}
+
+/* 给每个已协商且已链接的请求 pad 取一个输出 buffer 加入本帧任务，与 src pad 一起 remap 后推送。
+ * inframe 在 remap 前仍是原始输入（恒等输出直接从它拷贝）；请求 pad 推送失败只记日志，不影响 src pad */
+static GstFlowReturn
+gst_undistort_process(GstUndistort *self, GstUndistortPrivate *priv, GstVideoFrame *inframe,
+                      GstUndistortBandJob *job) {
+    GstVideoFrame frames[GST_UNDISTORT_MAX_OUTPUTS];
+    GstUndistortSrcPad *pads[GST_UNDISTORT_MAX_OUTPUTS];
+    unsigned n_extra = 0;
+
+    for (auto &sp: priv->outputs) {
+        if (!sp->negotiated || !gst_pad_is_linked(sp->pad))
+            continue;
+        if (gst_undistort_qos_drop(self, sp->pad, &sp->qos, GST_OBJECT(sp->pad), inframe->buffer))
+            continue;
+        GstBuffer *buffer = NULL;
+        if (gst_buffer_pool_acquire_buffer(sp->pool, &buffer, NULL) != GST_FLOW_OK) {
+            GST_WARNING_OBJECT(sp->pad, "failed to acquire output buffer");
+            continue;
+        }
+        if (!gst_video_frame_map(&frames[n_extra], &sp->info, buffer, GST_MAP_WRITE)) {
+            gst_buffer_unref(buffer);
+            continue;
+        }
+        if (sp->tables->identity) {
+            const gint64 start = g_get_monotonic_time();
+            gst_video_frame_copy(&frames[n_extra], inframe);
+            undistort_timer_record(&priv->copy_stats, (uint64_t) (g_get_monotonic_time() - start));
+        } else {
+            GstUndistortOutputJob *out = &job->outputs[job->n_outputs++];
+            out->tables = sp->tables.get();
+            out->convert = &sp->convert;
+            gst_undistort_wrap_frame(&frames[n_extra], out->dst);
+        }
+        pads[n_extra++] = sp.get();
+    }
+
+    if (job->n_outputs > 0) {
+        const gint64 start = g_get_monotonic_time();
+        gst_undistort_remap(self, priv, job);
+        undistort_timer_record(&priv->remap_stats, (uint64_t) (g_get_monotonic_time() - start));
+        priv->frames_processed.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        /* passthrough 时基类同样调用 transform_ip（transform_ip_on_passthrough），只在这里计数 */
+        priv->frames_bypassed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    for (unsigned i = 0; i < n_extra; ++i) {
+        GstBuffer *buffer = frames[i].buffer;
+        gst_video_frame_unmap(&frames[i]);
+        gst_buffer_copy_into(buffer, inframe->buffer,
+                             (GstBufferCopyFlags) (GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS), 0, -1);
+        pads[i]->qos.processed++;
+        const GstFlowReturn ret = gst_pad_push(pads[i]->pad, buffer);
+        if (ret != GST_FLOW_OK && ret != GST_FLOW_FLUSHING && ret != GST_FLOW_NOT_LINKED)
+            GST_WARNING_OBJECT(pads[i]->pad, "push returned %s", gst_flow_get_name(ret));
+    }
+    return GST_FLOW_OK;
+}
+
+/* DMABuf：CPU 访问前后各同步一次，设备写入的内容对 CPU 可见、CPU 写回的内容对设备可见。
+ * 新版 GstDmaBufAllocator 在 map 时也会同步，重复一次没有害处；其他内存直接跳过。
+ * 同步失败（比如 fd 不是真正的 dmabuf）每个流只 WARNING 一次，之后按 DEBUG 输出 */
+static void
+gst_undistort_dmabuf_sync(GstUndistort *self, GstUndistortPrivate *priv, GstBuffer *buffer, guint64 flags) {
+#ifdef HAVE_LINUX_DMA_BUF_H
+    for (guint i = 0; i < gst_buffer_n_memory(buffer); ++i) {
+        GstMemory *mem = gst_buffer_peek_memory(buffer, i);
+        if (!gst_is_dmabuf_memory(mem))
+            continue;
+        struct dma_buf_sync sync = {flags};
+        const int fd = gst_dmabuf_memory_get_fd(mem);
+        int ret;
+        do {
+            ret = ioctl(fd, DMA_BUF_IOCTL_SYNC, &sync);
+        } while (ret < 0 && (errno == EINTR || errno == EAGAIN));
+        if (ret < 0 && !priv->dmabuf_sync_warned) {
+            GST_WARNING_OBJECT(self, "DMA_BUF_IOCTL_SYNC on fd %d failed: %s (not warning again for this stream)",
+                               fd, g_strerror(errno));
+            priv->dmabuf_sync_warned = TRUE;
+        } else if (ret < 0) {
+            GST_DEBUG_OBJECT(self, "DMA_BUF_IOCTL_SYNC on fd %d failed: %s", fd, g_strerror(errno));
+        }
+    }
+#endif
+}
+
+#ifdef HAVE_LINUX_DMA_BUF_H
+#define GST_UNDISTORT_SYNC_READ_START (DMA_BUF_SYNC_START | DMA_BUF_SYNC_READ)
+#define GST_UNDISTORT_SYNC_READ_END (DMA_BUF_SYNC_END | DMA_BUF_SYNC_READ)
+#define GST_UNDISTORT_SYNC_RW_START (DMA_BUF_SYNC_START | DMA_BUF_SYNC_RW)
+#define GST_UNDISTORT_SYNC_RW_END (DMA_BUF_SYNC_END | DMA_BUF_SYNC_RW)
+#else
+#define GST_UNDISTORT_SYNC_READ_START 0
+#define GST_UNDISTORT_SYNC_READ_END 0
+#define GST_UNDISTORT_SYNC_RW_START 0
+#define GST_UNDISTORT_SYNC_RW_END 0
+#endif
+
+/* 拷贝路径：输入帧只读映射，直接 remap 到输出帧；输入/输出 stride 各自独立 */
+static GstFlowReturn
+gst_undistort_transform_frame(GstVideoFilter *filter, GstVideoFrame *inframe, GstVideoFrame *outframe) {
+    auto *self = GST_UNDISTORT(filter);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    gst_undistort_dmabuf_sync(self, priv, inframe->buffer, GST_UNDISTORT_SYNC_READ_START);
+
+    GstUndistortBandJob job;
+    job.n_outputs = 0;
+    gst_undistort_wrap_frame(inframe, job.src);
+
+    /* 恒等映射通常已切成 passthrough；有请求 pad 时 src pad 仍输出一份拷贝 */
+    const gboolean src_late = gst_undistort_src_qos_drop(self, priv, inframe->buffer);
+    if (src_late) {
+        GST_LOG_OBJECT(self, "src pad is late, only request pads get this frame");
+    } else if (!priv->tables || priv->tables->identity) {
+        const gint64 start = g_get_monotonic_time();
+        gst_video_frame_copy(outframe, inframe);
+        undistort_timer_record(&priv->copy_stats, (uint64_t) (g_get_monotonic_time() - start));
+    } else {
+        /* dst 包装的是输出 buffer 的内存，各条带直接写入自己的行 */
+        job.outputs[0].tables = priv->tables.get();
+        job.outputs[0].convert = &priv->convert;
+        gst_undistort_wrap_frame(outframe, job.outputs[0].dst);
+        job.n_outputs = 1;
+    }
+
+    const GstFlowReturn ret = gst_undistort_process(self, priv, inframe, &job);
+    gst_undistort_dmabuf_sync(self, priv, inframe->buffer, GST_UNDISTORT_SYNC_READ_END);
+    if (src_late)
+        return ret == GST_FLOW_OK ? GST_BASE_TRANSFORM_FLOW_DROPPED : ret;
+    priv->src_qos.processed++;
+    return ret;
+}
+
+/* in-place 回退：remap 不能原地进行，先把输入各平面拷到 scratch，再 remap 回 frame（按 frame 的 stride 写） */
+static GstFlowReturn
+gst_undistort_transform_frame_ip(GstVideoFilter *filter, GstVideoFrame *frame) {
+    auto *self = GST_UNDISTORT(filter);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    gst_undistort_dmabuf_sync(self, priv, frame->buffer, GST_UNDISTORT_SYNC_RW_START);
+
+    GstUndistortBandJob job;
+    job.n_outputs = 0;
+
+    /* OpenCV 视图：注意 stride */
+    cv::Mat img[GST_VIDEO_MAX_PLANES];
+    gst_undistort_wrap_frame(frame, img);
+
+    /* 当 maps 不可用时 frame 原样输出（比如没设置 fx/fy），请求 pad 直接读 frame；
+     * src pad 这一路因 QoS 跳过时同样不动 frame */
+    const gboolean src_late = gst_undistort_src_qos_drop(self, priv, frame->buffer);
+    if (src_late || !priv->tables || priv->tables->identity) {
+        for (guint p = 0; p < priv->n_planes; ++p)
+            job.src[p] = img[p];
+    } else {
+        const gint64 start = g_get_monotonic_time();
+        for (guint p = 0; p < priv->n_planes; ++p) {
+            img[p].copyTo(priv->scratch[p]); /* 尺寸不变时复用已有内存 */
+            job.src[p] = priv->scratch[p];
+            job.outputs[0].dst[p] = img[p];
+        }
+        undistort_timer_record(&priv->copy_stats, (uint64_t) (g_get_monotonic_time() - start));
+        job.outputs[0].tables = priv->tables.get();
+        job.outputs[0].convert = &priv->convert;
+        job.n_outputs = 1;
+    }
+    const GstFlowReturn ret = gst_undistort_process(self, priv, frame, &job);
+    gst_undistort_dmabuf_sync(self, priv, frame->buffer, GST_UNDISTORT_SYNC_RW_END);
+    if (src_late)
+        return ret == GST_FLOW_OK ? GST_BASE_TRANSFORM_FLOW_DROPPED : ret;
+    priv->src_qos.processed++;
+    return ret;
+}
+
+/* ---- src_%u 请求 pad：虚拟视角 ---- */
+
+enum {
+    PROP_PAD_0,
+    PROP_PAD_YAW,
+    PROP_PAD_PITCH,
+    PROP_PAD_ROLL,
+    PROP_PAD_ZOOM,
+    PROP_PAD_ROI_X,
+    PROP_PAD_ROI_Y,
+    PROP_PAD_ROI_WIDTH,
+    PROP_PAD_ROI_HEIGHT,
+};
+
+G_DEFINE_TYPE(GstUndistortViewPad, gst_undistort_view_pad, GST_TYPE_PAD);
+
+/* 视角变化：只请求后台重建这一路输出的表，在帧边界换上 */
+static void
+gst_undistort_view_pad_changed(GstUndistortViewPad *vpad) {
+    GstObject *parent = gst_object_get_parent(GST_OBJECT(vpad));
+    if (!parent)
+        return;
+    auto *self = GST_UNDISTORT(parent);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    guint output = 0;
+
+    GST_OBJECT_LOCK(self);
+    for (auto &sp: priv->srcpads) {
+        if (sp->pad == GST_PAD(vpad))
+            output = sp->output;
+    }
+    GST_OBJECT_UNLOCK(self);
+    if (output)
+        gst_undistort_request_rebuild(self, GST_UNDISTORT_OUTPUT_BIT(output));
+    gst_object_unref(parent);
+}
+
+static void
+gst_undistort_view_pad_set_property(GObject *object, guint prop_id, const GValue *value, GParamSpec *pspec) {
+    GstUndistortViewPad *vpad = GST_UNDISTORT_VIEW_PAD(object);
+    gdouble *dfield = NULL;
+    gint *ifield = NULL;
+
+    switch (prop_id) {
+        case PROP_PAD_YAW: dfield = &vpad->yaw;
+            break;
+        case PROP_PAD_PITCH: dfield = &vpad->pitch;
+            break;
+        case PROP_PAD_ROLL: dfield = &vpad->roll;
+            break;
+        case PROP_PAD_ZOOM: dfield = &vpad->zoom;
+            break;
+        case PROP_PAD_ROI_X: ifield = &vpad->roi_x;
+            break;
+        case PROP_PAD_ROI_Y: ifield = &vpad->roi_y;
+            break;
+        case PROP_PAD_ROI_WIDTH: ifield = &vpad->roi_width;
+            break;
+        case PROP_PAD_ROI_HEIGHT: ifield = &vpad->roi_height;
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+            return;
+    }
+
+    gboolean changed;
+    GST_OBJECT_LOCK(vpad);
+    if (dfield) {
+        changed = *dfield != g_value_get_double(value);
+        *dfield = g_value_get_double(value);
+    } else {
+        changed = *ifield != g_value_get_int(value);
+        *ifield = g_value_get_int(value);
+    }
+    GST_OBJECT_UNLOCK(vpad);
+    if (changed)
+        gst_undistort_view_pad_changed(vpad);
+}
+
+static void
+gst_undistort_view_pad_get_property(GObject *object, guint prop_id, GValue *value, GParamSpec *pspec) {
+    GstUndistortViewPad *vpad = GST_UNDISTORT_VIEW_PAD(object);
+
+    GST_OBJECT_LOCK(vpad);
+    switch (prop_id) {
+        case PROP_PAD_YAW: g_value_set_double(value, vpad->yaw);
+            break;
+        case PROP_PAD_PITCH: g_value_set_double(value, vpad->pitch);
+            break;
+        case PROP_PAD_ROLL: g_value_set_double(value, vpad->roll);
+            break;
+        case PROP_PAD_ZOOM: g_value_set_double(value, vpad->zoom);
+            break;
+        case PROP_PAD_ROI_X: g_value_set_int(value, vpad->roi_x);
+            break;
+        case PROP_PAD_ROI_Y: g_value_set_int(value, vpad->roi_y);
+            break;
+        case PROP_PAD_ROI_WIDTH: g_value_set_int(value, vpad->roi_width);
+            break;
+        case PROP_PAD_ROI_HEIGHT: g_value_set_int(value, vpad->roi_height);
+            break;
+        default:
+            G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+    }
+    GST_OBJECT_UNLOCK(vpad);
+}
+
+static void
+gst_undistort_view_pad_class_init(GstUndistortViewPadClass *klass) {
+    GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+    const auto flags = (GParamFlags) (G_PARAM_READWRITE | GST_PARAM_CONTROLLABLE | GST_PARAM_MUTABLE_PLAYING);
+
+    gobject_class->set_property = gst_undistort_view_pad_set_property;
+    gobject_class->get_property = gst_undistort_view_pad_get_property;
+
+    g_object_class_install_property(gobject_class, PROP_PAD_YAW,
+                                    g_param_spec_double("yaw", "Yaw", "Pan of the virtual view in degrees "
+                                                        "(positive = right)", -180.0, 180.0, 0.0, flags));
+    g_object_class_install_property(gobject_class, PROP_PAD_PITCH,
+                                    g_param_spec_double("pitch", "Pitch", "Tilt of the virtual view in degrees "
+                                                        "(positive = up)", -90.0, 90.0, 0.0, flags));
+    g_object_class_install_property(gobject_class, PROP_PAD_ROLL,
+                                    g_param_spec_double("roll", "Roll", "Roll of the virtual view in degrees",
+                                                        -180.0, 180.0, 0.0, flags));
+    g_object_class_install_property(gobject_class, PROP_PAD_ZOOM,
+                                    g_param_spec_double("zoom", "Zoom", "Focal length of the virtual view relative "
+                                                        "to the calibrated one (scaled to the output size)",
+                                                        0.05, 32.0, 1.0, flags));
+    g_object_class_install_property(gobject_class, PROP_PAD_ROI_X,
+                                    g_param_spec_int("roi-x", "ROI x", "Left edge of the region of interest in the "
+                                                     "undistorted input-sized image", G_MININT, G_MAXINT, 0, flags));
+    g_object_class_install_property(gobject_class, PROP_PAD_ROI_Y,
+                                    g_param_spec_int("roi-y", "ROI y", "Top edge of the region of interest in the "
+                                                     "undistorted input-sized image", G_MININT, G_MAXINT, 0, flags));
+    g_object_class_install_property(gobject_class, PROP_PAD_ROI_WIDTH,
+                                    g_param_spec_int("roi-width", "ROI width", "Width of the region of interest "
+                                                     "(0 = use yaw/pitch/zoom instead)", 0, G_MAXINT, 0, flags));
+    g_object_class_install_property(gobject_class, PROP_PAD_ROI_HEIGHT,
+                                    g_param_spec_int("roi-height", "ROI height", "Height of the region of interest "
+                                                     "(0 = use yaw/pitch/zoom instead)", 0, G_MAXINT, 0, flags));
+}
+
+static void
+gst_undistort_view_pad_init(GstUndistortViewPad *vpad) {
+    vpad->yaw = vpad->pitch = vpad->roll = 0.0;
+    vpad->zoom = 1.0;
+    vpad->roi_x = vpad->roi_y = vpad->roi_width = vpad->roi_height = 0;
+}
+
+/* GstChildProxy：请求 pad 作为子对象，gst-launch 可以写 undistort src_0::yaw=30 */
+static GObject *
+gst_undistort_child_proxy_get_child_by_index(GstChildProxy *proxy, guint index) {
+    auto *self = GST_UNDISTORT(proxy);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    GObject *child = NULL;
+
+    GST_OBJECT_LOCK(self);
+    if (index < priv->srcpads.size())
+        child = (GObject *) gst_object_ref(priv->srcpads[index]->pad);
+    GST_OBJECT_UNLOCK(self);
+    return child;
+}
+
+static GObject *
+gst_undistort_child_proxy_get_child_by_name(GstChildProxy *proxy, const gchar *name) {
+    auto *self = GST_UNDISTORT(proxy);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    GObject *child = NULL;
+
+    GST_OBJECT_LOCK(self);
+    for (auto &sp: priv->srcpads) {
+        if (!g_strcmp0(GST_OBJECT_NAME(sp->pad), name)) {
+            child = (GObject *) gst_object_ref(sp->pad);
+            break;
+        }
+    }
+    GST_OBJECT_UNLOCK(self);
+    return child;
+}
+
+static guint
+gst_undistort_child_proxy_get_children_count(GstChildProxy *proxy) {
+    auto *self = GST_UNDISTORT(proxy);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    GST_OBJECT_LOCK(self);
+    const guint count = (guint) priv->srcpads.size();
+    GST_OBJECT_UNLOCK(self);
+    return count;
+}
+
+static void
+gst_undistort_child_proxy_init(gpointer g_iface, gpointer iface_data) {
+    auto *iface = (GstChildProxyInterface *) g_iface;
+
+    iface->get_child_by_index = gst_undistort_child_proxy_get_child_by_index;
+    iface->get_child_by_name = gst_undistort_child_proxy_get_child_by_name;
+    iface->get_children_count = gst_undistort_child_proxy_get_children_count;
+}
+
+/* 请求 pad 的 caps 查询：输入已协商时回答由输入 caps 换算出的尺寸，否则回答模板 */
+static gboolean
+gst_undistort_srcpad_query(GstPad *pad, GstObject *parent, GstQuery *query) {
+    if (GST_QUERY_TYPE(query) != GST_QUERY_CAPS)
+        return gst_pad_query_default(pad, parent, query);
+
+    auto *trans = GST_BASE_TRANSFORM(parent);
+    GstCaps *filter, *caps;
+    gst_query_parse_caps(query, &filter);
+    GstCaps *incaps = gst_pad_get_current_caps(GST_BASE_TRANSFORM_SINK_PAD(trans));
+    if (incaps) {
+        caps = gst_undistort_transform_caps(trans, GST_PAD_SINK, incaps, filter);
+        gst_caps_unref(incaps);
+    } else {
+        GstCaps *templ = gst_pad_get_pad_template_caps(pad);
+        caps = filter ? gst_caps_intersect_full(filter, templ, GST_CAPS_INTERSECT_FIRST) : gst_caps_ref(templ);
+        gst_caps_unref(templ);
+    }
+    gst_query_set_caps_result(query, caps);
+    gst_caps_unref(caps);
+    return TRUE;
+}
+
+/* QoS 事件：与 GstBaseTransform 相同，最早可用时间 = timestamp + diff */
+static void
+gst_undistort_qos_update(GstPad *pad, GstUndistortQos *qos, GstEvent *event) {
+    GstQOSType type;
+    gdouble proportion;
+    GstClockTimeDiff diff;
+    GstClockTime timestamp;
+
+    gst_event_parse_qos(event, &type, &proportion, &diff, &timestamp);
+    GST_OBJECT_LOCK(pad);
+    qos->proportion = proportion;
+    if (diff >= 0 || timestamp > (GstClockTime) -diff)
+        qos->earliest_time = timestamp + diff;
+    else
+        qos->earliest_time = 0;
+    GST_OBJECT_UNLOCK(pad);
+    GST_LOG_OBJECT(pad, "QoS: proportion %.3f, diff %" G_GINT64_FORMAT ", timestamp %" GST_TIME_FORMAT,
+                   proportion, diff, GST_TIME_ARGS(timestamp));
+}
+
+/* 清除一路输出的 QoS 状态（flush 或停止后） */
+static void
+gst_undistort_qos_reset(GstPad *pad, GstUndistortQos *qos) {
+    GST_OBJECT_LOCK(pad);
+    qos->earliest_time = GST_CLOCK_TIME_NONE;
+    qos->proportion = 1.0;
+    GST_OBJECT_UNLOCK(pad);
+}
+
+/* 请求 pad 的 QoS 事件 */
+static void
+gst_undistort_srcpad_update_qos(GstUndistort *self, GstPad *pad, GstEvent *event) {
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    GST_OBJECT_LOCK(self);
+    for (auto &sp: priv->srcpads) {
+        if (sp->pad == pad) {
+            gst_undistort_qos_update(pad, &sp->qos, event);
+            break;
+        }
+    }
+    GST_OBJECT_UNLOCK(self);
+}
+
+/* 请求 pad 的上游事件：RECONFIGURE 只在本 pad 上处理（pad 已打上标记，下一帧重新协商）；
+ * QoS 只影响这一路输出，不转发到上游（否则一个慢分支会让上游为所有输出丢帧）；其余默认处理 */
+static gboolean
+gst_undistort_srcpad_event(GstPad *pad, GstObject *parent, GstEvent *event) {
+    switch (GST_EVENT_TYPE(event)) {
+        case GST_EVENT_RECONFIGURE:
+            gst_event_unref(event);
+            return TRUE;
+        case GST_EVENT_QOS:
+            gst_undistort_srcpad_update_qos(GST_UNDISTORT(parent), pad, event);
+            gst_event_unref(event);
+            return TRUE;
+        default:
+            return gst_pad_event_default(pad, parent, event);
+    }
+}
+
+/* 申请 src_%u：只创建 pad，尺寸在下一帧到来时在流线程上按下游协商 */
+static GstPad *
+gst_undistort_request_new_pad(GstElement *element, GstPadTemplate *templ, const gchar *name, const GstCaps *caps) {
+    auto *self = GST_UNDISTORT(element);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    guint index;
+
+    GST_OBJECT_LOCK(self);
+    if (priv->srcpads.size() + 1 >= GST_UNDISTORT_MAX_OUTPUTS) {
+        GST_OBJECT_UNLOCK(self);
+        GST_WARNING_OBJECT(self, "at most %d request pads are supported", GST_UNDISTORT_MAX_OUTPUTS - 1);
+        return NULL;
+    }
+    if (name && sscanf(name, "src_%u", &index) == 1)
+        priv->next_pad_index = MAX(priv->next_pad_index, index + 1);
+    else
+        index = priv->next_pad_index++;
+    const guint output = priv->next_output++;
+    GST_OBJECT_UNLOCK(self);
+
+    gchar *pad_name = g_strdup_printf("src_%u", index);
+    GstPad *pad = GST_PAD(g_object_new(GST_TYPE_UNDISTORT_VIEW_PAD, "name", pad_name, "direction", GST_PAD_SRC,
+                                       "template", templ, NULL));
+    g_free(pad_name);
+    gst_pad_set_query_function(pad, GST_DEBUG_FUNCPTR(gst_undistort_srcpad_query));
+    gst_pad_set_event_function(pad, GST_DEBUG_FUNCPTR(gst_undistort_srcpad_event));
+
+    auto sp = std::make_shared<GstUndistortSrcPad>();
+    sp->pad = GST_PAD(gst_object_ref(pad));
+    sp->output = output;
+    sp->negotiated = FALSE;
+    sp->pool = NULL;
+    sp->qos.earliest_time = GST_CLOCK_TIME_NONE;
+    sp->qos.proportion = 1.0;
+    sp->qos.processed = sp->qos.dropped = 0;
+    gst_video_info_init(&sp->info);
+
+    /* 元素已在 PAUSED 以上时 add_pad 会激活 pad；名字重复时失败 */
+    if (!gst_element_add_pad(element, pad)) {
+        gst_object_unref(pad);
+        return NULL;
+    }
+    GST_OBJECT_LOCK(self);
+    priv->srcpads.push_back(sp);
+    priv->srcpads_cookie.fetch_add(1, std::memory_order_release);
+    GST_OBJECT_UNLOCK(self);
+    /* 从此 src pad 的 QoS 由元素处理，清掉基类记下的最早时间（不然它仍会为所有输出丢帧） */
+    gst_base_transform_update_qos(GST_BASE_TRANSFORM(self), 1.0, 0, GST_CLOCK_TIME_NONE);
+    gst_child_proxy_child_added(GST_CHILD_PROXY(self), G_OBJECT(pad), GST_OBJECT_NAME(pad));
+    GST_DEBUG_OBJECT(self, "added %s (output %u)", GST_PAD_NAME(pad), output);
+    return pad;
+}
+
+/* 释放 src_%u：从列表摘下，流线程在下一帧丢掉快照后状态才析构 */
+static void
+gst_undistort_release_pad(GstElement *element, GstPad *pad) {
+    auto *self = GST_UNDISTORT(element);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+    guint output = 0;
+
+    GST_OBJECT_LOCK(self);
+    for (auto it = priv->srcpads.begin(); it != priv->srcpads.end(); ++it) {
+        if ((*it)->pad == pad) {
+            output = (*it)->output;
+            priv->srcpads.erase(it);
+            priv->srcpads_cookie.fetch_add(1, std::memory_order_release);
+            break;
+        }
+    }
+    GST_OBJECT_UNLOCK(self);
+    if (!output)
+        return;
+
+    gst_undistort_drop_rebuild_base(priv, output);
+    gst_child_proxy_child_removed(GST_CHILD_PROXY(self), G_OBJECT(pad), GST_OBJECT_NAME(pad));
+    gst_pad_set_active(pad, FALSE);
+    gst_element_remove_pad(element, pad);
+}
+
+/* 输入 caps 变化时请求 pad 需要重新协商；其余事件（segment、EOS、flush 等）转发到请求 pad。
+ * 未协商的 pad 在协商时才收到粘性事件，这里只给它转发 flush 与 EOS */
+static gboolean
+gst_undistort_sink_event(GstBaseTransform *trans, GstEvent *event) {
+    auto *self = GST_UNDISTORT(trans);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    GST_OBJECT_LOCK(self);
+    std::vector<std::shared_ptr<GstUndistortSrcPad>> pads = priv->srcpads;
+    GST_OBJECT_UNLOCK(self);
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
+        gst_undistort_qos_reset(GST_BASE_TRANSFORM_SRC_PAD(trans), &priv->src_qos);
+    for (auto &sp: pads) {
+        if (GST_EVENT_TYPE(event) == GST_EVENT_CAPS) {
+            gst_pad_mark_reconfigure(sp->pad);
+            continue;
+        }
+        if (GST_EVENT_TYPE(event) == GST_EVENT_FLUSH_STOP)
+            gst_undistort_qos_reset(sp->pad, &sp->qos);
+        /* flush-start 不在流线程上，先判断事件类型，不读 negotiated */
+        if (GST_EVENT_IS_STICKY(event) && GST_EVENT_TYPE(event) != GST_EVENT_EOS && !sp->negotiated)
+            continue;
+        if (GST_EVENT_TYPE(event) == GST_EVENT_EOS && !sp->negotiated) {
+            GstEvent *stream_start = gst_pad_get_sticky_event(GST_BASE_TRANSFORM_SINK_PAD(trans),
+                                                              GST_EVENT_STREAM_START, 0);
+            if (stream_start)
+                gst_pad_push_event(sp->pad, stream_start);
+        }
+        gst_pad_push_event(sp->pad, gst_event_ref(event));
+    }
+    return GST_BASE_TRANSFORM_CLASS(parent_class)->sink_event(trans, event);
+}
+
+/* src pad 的 QoS 事件：总是记进 src_qos。没有请求 pad 时交给基类（在 transform 之前整帧丢掉并转发到上游）；
+ * 有请求 pad 时不更新基类的状态也不转发（与请求 pad 相同，否则 src pad 下游慢会让所有输出丢帧），
+ * 由 transform 只跳过 src pad 这一路 */
+static gboolean
+gst_undistort_src_event(GstBaseTransform *trans, GstEvent *event) {
+    auto *self = GST_UNDISTORT(trans);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    if (GST_EVENT_TYPE(event) == GST_EVENT_QOS) {
+        gst_undistort_qos_update(GST_BASE_TRANSFORM_SRC_PAD(trans), &priv->src_qos, event);
+        GST_OBJECT_LOCK(self);
+        const gboolean own = !priv->srcpads.empty();
+        GST_OBJECT_UNLOCK(self);
+        if (own) {
+            gst_event_unref(event);
+            return TRUE;
+        }
+    }
+    return GST_BASE_TRANSFORM_CLASS(parent_class)->src_event(trans, event);
+}
+
+/* 停止时请求 pad 的协商状态作废，下次启动后重新转发粘性事件并协商 */
+static gboolean
+gst_undistort_stop(GstBaseTransform *trans) {
+    auto *self = GST_UNDISTORT(trans);
+    auto *priv = (GstUndistortPrivate *) gst_undistort_get_instance_private(self);
+
+    GST_OBJECT_LOCK(self);
+    for (auto &sp: priv->srcpads) {
+        sp->negotiated = FALSE;
+        sp->qos.processed = sp->qos.dropped = 0;
+        gst_undistort_qos_reset(sp->pad, &sp->qos);
+    }
+    GST_OBJECT_UNLOCK(self);
+    priv->src_qos.processed = priv->src_qos.dropped = 0;
+    gst_undistort_qos_reset(GST_BASE_TRANSFORM_SRC_PAD(trans), &priv->src_qos);
+    priv->dmabuf_sync_warned = FALSE;
+    return TRUE;
 }
 
 /* 插件初始化：注册元素 */
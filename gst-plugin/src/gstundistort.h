@@ -12,6 +12,42 @@ G_BEGIN_DECLS
 #define GST_IS_UNDISTORT_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_UNDISTORT))
 //#define GST_ELEMENT_REGISTER_DECLARE(element) GType gst_##element##_get_type(void)
 
+/* remap 映射表格式：
+ *  FLOAT32 : mapx/mapy 两张 CV_32FC1 表，8 字节/像素
+ *  FIXED   : CV_16SC2 整数坐标 + CV_16UC1 1/32 像素插值索引，6 字节/像素，双线性
+ *  NEAREST : 仅 CV_16SC2 四舍五入后的整数坐标，4 字节/像素，最近邻
+ *  MESH    : 稀疏网格（每 mesh-step-x x mesh-step-y 像素一个 float 坐标对），逐行展开后双线性 */
+typedef enum {
+    GST_UNDISTORT_MAP_FORMAT_FLOAT32,
+    GST_UNDISTORT_MAP_FORMAT_FIXED,
+    GST_UNDISTORT_MAP_FORMAT_NEAREST,
+    GST_UNDISTORT_MAP_FORMAT_MESH,
+} GstUndistortMapFormat;
+
+#define GST_TYPE_UNDISTORT_MAP_FORMAT (gst_undistort_map_format_get_type())
+GType gst_undistort_map_format_get_type (void);
+
+/* 相机模型：与 UndistortCameraModel 取值一一对应 */
+typedef enum {
+    GST_UNDISTORT_CAMERA_MODEL_PINHOLE,
+    GST_UNDISTORT_CAMERA_MODEL_FISHEYE,
+} GstUndistortCameraModel;
+
+#define GST_TYPE_UNDISTORT_CAMERA_MODEL (gst_undistort_camera_model_get_type())
+GType gst_undistort_camera_model_get_type (void);
+
+/* remap 后端：与 UndistortBackend 取值一一对应，auto 按协商出的格式与本机能力选择 */
+typedef enum {
+    GST_UNDISTORT_BACKEND_AUTO,
+    GST_UNDISTORT_BACKEND_OPENCV,
+    GST_UNDISTORT_BACKEND_SIMD,
+    GST_UNDISTORT_BACKEND_MESH,
+    GST_UNDISTORT_BACKEND_IDC,
+} GstUndistortBackend;
+
+#define GST_TYPE_UNDISTORT_BACKEND (gst_undistort_backend_get_type())
+GType gst_undistort_backend_get_type (void);
+
 typedef struct _GstUndistort        GstUndistort;
 typedef struct _GstUndistortClass   GstUndistortClass;
 typedef struct _GstUndistort {
@@ -20,6 +56,17 @@ typedef struct _GstUndistort {
     gboolean silent;
     gdouble fx, fy, cx, cy;   /* 内参 */
     gdouble k1, k2, p1, p2, k3; /* 畸变系数（径向 k1/k2/k3 + 切向 p1/p2） */
+    gdouble k4; /* 鱼眼模型的第 4 个系数（鱼眼模型使用 k1..k4，不用 p1/p2） */
+    GstUndistortCameraModel camera_model;
+    GstUndistortMapFormat map_format; /* 映射表格式，协商时一次性生成 */
+    GstUndistortBackend backend; /* remap 后端，协商时选择 */
+    guint n_threads; /* remap 线程数（含流线程），0 = 按 CPU 核数自动 */
+    gboolean luma_only; /* YUV 格式只 remap 亮度，色度填 128 */
+    guint mesh_step_x, mesh_step_y; /* map-format=mesh 的网格步长（像素） */
+    gdouble max_mesh_error; /* >0 时按误差选 mesh 步长（像素），0 = 固定用 mesh-step-x/y */
+    gchar *map_cache_dir; /* 映射表磁盘缓存目录，NULL 表示不缓存 */
+    gdouble alpha; /* <0：新内参 = 原内参（按输出尺寸缩放）；0..1：getOptimalNewCameraMatrix，只输出有效区域 */
+    guint stats_interval; /* 统计消息的间隔（毫秒），0 = 不发 */
 } GstUndistort;
 
 typedef struct _GstUndistortClass {
@@ -27,6 +74,24 @@ typedef struct _GstUndistortClass {
 } GstUndistortClass;
 
 GType gst_undistort_get_type (void);
+
+/* src_%u 请求 pad：每个 pad 是一个虚拟视角（PTZ 或 ROI），属性可在 PLAYING 中修改 */
+#define GST_TYPE_UNDISTORT_VIEW_PAD (gst_undistort_view_pad_get_type())
+#define GST_UNDISTORT_VIEW_PAD(obj) (G_TYPE_CHECK_INSTANCE_CAST((obj),GST_TYPE_UNDISTORT_VIEW_PAD,GstUndistortViewPad))
+#define GST_IS_UNDISTORT_VIEW_PAD(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_UNDISTORT_VIEW_PAD))
+
+typedef struct _GstUndistortViewPad {
+    GstPad parent;
+    gdouble yaw, pitch, roll; /* 度 */
+    gdouble zoom; /* 相对原焦距（按输出尺寸缩放）的倍数 */
+    gint roi_x, roi_y, roi_width, roi_height; /* 矫正后图像（源图尺寸）中的裁剪矩形，宽高为 0 表示不用 */
+} GstUndistortViewPad;
+
+typedef struct _GstUndistortViewPadClass {
+    GstPadClass parent_class;
+} GstUndistortViewPadClass;
+
+GType gst_undistort_view_pad_get_type (void);
 //GST_ELEMENT_REGISTER_DECLARE (undistort)
 
 G_END_DECLS
@@ -0,0 +1,126 @@
+/* remap 后端的选择，见 gstundistort_backend.h */
+
+#include "gstundistort_backend.h"
+
+const char *
+undistort_backend_name(UndistortBackend backend) {
+    switch (backend) {
+        case UNDISTORT_BACKEND_OPENCV: return "opencv";
+        case UNDISTORT_BACKEND_SIMD: return "simd";
+        case UNDISTORT_BACKEND_MESH: return "mesh";
+        case UNDISTORT_BACKEND_IDC: return "idc";
+        default: return "auto";
+    }
+}
+
+static const char *
+map_type_name(UndistortMapType type) {
+    switch (type) {
+        case UNDISTORT_MAP_FLOAT32: return "float32";
+        case UNDISTORT_MAP_NEAREST: return "nearest";
+        case UNDISTORT_MAP_MESH: return "mesh";
+        default: return "fixed";
+    }
+}
+
+/* 显式请求的后端能否处理这路输出，不能时 why 为原因 */
+static bool
+backend_supported(UndistortBackend backend, const UndistortBackendQuery *query, std::string *why) {
+    switch (backend) {
+        case UNDISTORT_BACKEND_IDC:
+            if (!query->idc_built) {
+                *why = "IDC support not built (meson -Didc=disabled)";
+                return false;
+            }
+            if (!query->nv12 || query->convert) {
+                *why = "IDC only handles NV12 -> NV12";
+                return false;
+            }
+            return true;
+        case UNDISTORT_BACKEND_OPENCV:
+            if (query->convert) {
+                *why = "cv::remap cannot fuse format conversion";
+                return false;
+            }
+            return true;
+        default:
+            return true;
+    }
+}
+
+/* auto：硬件优先，其次按 map-format；本机没有 x86 专用内核时 fixed 表交给 cv::remap */
+static void
+backend_auto(const UndistortBackendQuery *query, UndistortBackendChoice *choice) {
+    if (query->idc_built && !query->idc_emulated && query->nv12 && !query->convert) {
+        choice->backend = UNDISTORT_BACKEND_IDC;
+        choice->reason = "NV12 and IDC hardware support built in";
+        return;
+    }
+
+    switch (query->map_type) {
+        case UNDISTORT_MAP_MESH:
+            choice->backend = UNDISTORT_BACKEND_MESH;
+            choice->reason = "map-format=mesh";
+            return;
+        case UNDISTORT_MAP_FLOAT32:
+        case UNDISTORT_MAP_NEAREST:
+            if (query->convert) {
+                choice->backend = UNDISTORT_BACKEND_SIMD;
+                choice->reason = "format conversion needs fixed-point maps";
+            } else {
+                choice->backend = UNDISTORT_BACKEND_OPENCV;
+                choice->reason = std::string("map-format=") + map_type_name(query->map_type) +
+                                 " is only handled by cv::remap";
+            }
+            return;
+        default:
+            if (query->convert) {
+                choice->backend = UNDISTORT_BACKEND_SIMD;
+                choice->reason = "fused format conversion";
+            } else if (query->isa == UNDISTORT_ISA_SCALAR) {
+                /* 例如 ARM：OpenCV 的 remap 自带 NEON 实现，比标量内核快 */
+                choice->backend = UNDISTORT_BACKEND_OPENCV;
+                choice->reason = "no SSE4.1/AVX2/AVX-512 on this CPU, using OpenCV's vectorised remap";
+            } else {
+                choice->backend = UNDISTORT_BACKEND_SIMD;
+                choice->reason = std::string(undistort_isa_name(query->isa)) + " kernels";
+            }
+            return;
+    }
+}
+
+void
+undistort_backend_select(UndistortBackend requested, const UndistortBackendQuery *query,
+                         UndistortBackendChoice *choice) {
+    std::string why;
+
+    choice->fallback = false;
+    if (requested == UNDISTORT_BACKEND_AUTO) {
+        backend_auto(query, choice);
+    } else if (!backend_supported(requested, query, &why)) {
+        backend_auto(query, choice);
+        choice->fallback = true;
+        choice->reason = std::string(undistort_backend_name(requested)) + " unavailable: " + why +
+                         "; auto: " + choice->reason;
+    } else {
+        choice->backend = requested;
+        choice->reason = "requested";
+    }
+
+    /* 各后端使用的表格式：opencv 可用除 mesh 外的任何表，simd 只用 fixed，mesh/idc 用网格 */
+    switch (choice->backend) {
+        case UNDISTORT_BACKEND_OPENCV:
+            choice->map_type = query->map_type == UNDISTORT_MAP_MESH ? UNDISTORT_MAP_FLOAT32 : query->map_type;
+            break;
+        case UNDISTORT_BACKEND_SIMD:
+            choice->map_type = UNDISTORT_MAP_FIXED;
+            break;
+        default:
+            choice->map_type = UNDISTORT_MAP_MESH;
+            break;
+    }
+    if (choice->map_type != query->map_type) {
+        choice->reason += std::string(", map-format ") + map_type_name(query->map_type) + " -> " +
+                          map_type_name(choice->map_type);
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef __GST_UNDISTORT_BACKEND_H__
+#define __GST_UNDISTORT_BACKEND_H__
+
+/* remap 后端的选择，不依赖 GStreamer。
+ *  - opencv : cv::remap（float32/nearest 表，或把 fixed 表交给 OpenCV 自己的向量化实现）
+ *  - simd   : fixed 表 + gstundistort_kernels 的专用内核（同格式时按块遍历）
+ *  - mesh   : 稀疏网格逐行展开 + 专用内核
+ *  - idc    : Rockchip IDC 硬件（gstundistort_idc），只支持 NV12 -> NV12，网格步长以 16x8 为基准；
+ *             没有厂商库时是 CPU 实现（rkalg_idc_lut_emu），auto 不选
+ * auto 按协商出的格式、map-format 与本机能力选择；显式请求满足不了时退回 auto。
+ * 每次选择都给出原因，元素按 INFO（退回时 WARNING）级别输出。 */
+
+#include "gstundistort_kernels.h"
+#include "gstundistort_maps.h"
+
+#include <string>
+
+/* 与 GstUndistortBackend 取值一一对应 */
+typedef enum {
+    UNDISTORT_BACKEND_AUTO,
+    UNDISTORT_BACKEND_OPENCV,
+    UNDISTORT_BACKEND_SIMD,
+    UNDISTORT_BACKEND_MESH,
+    UNDISTORT_BACKEND_IDC,
+} UndistortBackend;
+
+/* IDC 的 merged meshXY 默认步长，也是 max-mesh-error 选择的基准。
+ * IDC 只接受偶数步长（色度网格用一半），基准按 2 的幂缩放后仍是偶数 */
+#define UNDISTORT_IDC_STEP_X 16
+#define UNDISTORT_IDC_STEP_Y 8
+
+/* 选择依据：一路输出协商出的格式与本机能力 */
+typedef struct {
+    UndistortMapType map_type; // map-format 属性
+    bool nv12; // 输入、输出都是 NV12
+    bool convert; // 输出格式与输入不同（只有融合采样路径支持）
+    UndistortIsa isa; // 专用内核可用的指令集
+    bool idc_built; // 编译时启用了 IDC 后端
+    bool idc_emulated; // IDC 接口是 CPU 实现（没有厂商库），auto 不选它
+} UndistortBackendQuery;
+
+typedef struct {
+    UndistortBackend backend; // 不会是 AUTO
+    UndistortMapType map_type; // 该后端实际使用的表格式
+    bool fallback; // 显式请求的后端不可用，已退回 auto 的选择
+    std::string reason;
+} UndistortBackendChoice;
+
+const char *undistort_backend_name(UndistortBackend backend);
+
+void undistort_backend_select(UndistortBackend requested, const UndistortBackendQuery *query,
+                              UndistortBackendChoice *choice);
+
+#endif /* __GST_UNDISTORT_BACKEND_H__ */
@@ -0,0 +1,327 @@
+/* undistort 映射表的磁盘缓存，见 gstundistort_cache.h */
+
+#include "gstundistort_cache.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_MAGIC "UNDMAP\0"
+#define CACHE_BYTE_ORDER 0x01020304u
+#define CACHE_ALIGN 64
+#define CACHE_MAX_ENTRIES 16
+
+enum {
+    CACHE_KIND_MAP1,
+    CACHE_KIND_MAP2,
+    CACHE_KIND_MESH,
+};
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order; // 按本机字节序写入，读回不一致说明文件来自其他架构
+    UndistortCacheKey key;
+    uint32_t n_entries;
+    uint32_t reserved;
+    double aux;
+    uint64_t payload_offset; // 相对文件开头
+    uint64_t payload_size;
+    uint64_t checksum; // 载荷校验和
+} CacheHeader;
+
+typedef struct {
+    int32_t table; // maps[] 下标
+    int32_t kind;
+    int32_t rows, cols, type;
+    int32_t mesh_step; // mesh 条目的网格步长：(step_x << 16) | step_y，其他条目为 0
+    uint64_t offset; // 相对载荷开头
+    uint64_t step; // 行步长（字节）
+} CacheEntry;
+
+UndistortCacheFile::~UndistortCacheFile() {
+    munmap(addr_, size_);
+}
+
+static uint64_t
+fnv1a64(const void *data, size_t size) {
+    const uint8_t *p = (const uint8_t *) data;
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/* 载荷校验和：按 8 字节一组混合，4K 表几十 MB 也只需几毫秒（顺便把页预读进来） */
+static uint64_t
+payload_checksum(const uint8_t *data, size_t size) {
+    uint64_t h = 0x9E3779B97F4A7C15ull ^ size;
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8) {
+        uint64_t v;
+        memcpy(&v, data + i, sizeof(v));
+        h = (h ^ v) * 0xFF51AFD7ED558CCDull;
+        h ^= h >> 32;
+    }
+    for (; i < size; ++i)
+        h = (h ^ data[i]) * 0x100000001B3ull;
+    return h;
+}
+
+static size_t
+align_up(size_t v) {
+    return (v + CACHE_ALIGN - 1) & ~(size_t) (CACHE_ALIGN - 1);
+}
+
+std::string
+undistort_cache_path(const char *dir, const UndistortCacheKey *key) {
+    char name[64];
+    snprintf(name, sizeof(name), "undistort-%016llx.map", (unsigned long long) fnv1a64(key, sizeof(*key)));
+    return std::string(dir) + "/" + name;
+}
+
+/* 某种表格式下，每种条目应有的矩阵类型；-1 表示不应出现 */
+static int
+expected_type(int32_t map_type, int32_t kind) {
+    switch (map_type) {
+        case UNDISTORT_MAP_FLOAT32:
+            return kind == CACHE_KIND_MESH ? -1 : CV_32FC1;
+        case UNDISTORT_MAP_FIXED:
+            return kind == CACHE_KIND_MAP1 ? CV_16SC2 : kind == CACHE_KIND_MAP2 ? CV_16UC1 : -1;
+        case UNDISTORT_MAP_NEAREST:
+            return kind == CACHE_KIND_MAP1 ? CV_16SC2 : -1;
+        case UNDISTORT_MAP_MESH:
+            return kind == CACHE_KIND_MESH ? CV_32FC1 : -1;
+        default:
+            return -1;
+    }
+}
+
+std::shared_ptr<UndistortCacheFile>
+undistort_cache_load(const char *dir, const UndistortCacheKey *key,
+                     UndistortPlaneMap *maps, int n_maps,
+                     double *aux, std::string *why) {
+    const std::string path = undistort_cache_path(dir, key);
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        *why = path + ": " + strerror(errno);
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(CacheHeader)) {
+        close(fd);
+        *why = path + ": truncated";
+        return nullptr;
+    }
+    void *addr = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        *why = path + ": mmap: " + strerror(errno);
+        return nullptr;
+    }
+    auto file = std::make_shared<UndistortCacheFile>(addr, (size_t) st.st_size);
+    madvise(addr, (size_t) st.st_size, MADV_WILLNEED);
+
+    const auto *hdr = (const CacheHeader *) file->data();
+    if (memcmp(hdr->magic, CACHE_MAGIC, sizeof(hdr->magic)) != 0 || hdr->byte_order != CACHE_BYTE_ORDER) {
+        *why = path + ": bad magic";
+        return nullptr;
+    }
+    if (hdr->version != UNDISTORT_CACHE_VERSION) {
+        *why = path + ": version " + std::to_string(hdr->version);
+        return nullptr;
+    }
+    if (memcmp(&hdr->key, key, sizeof(*key)) != 0) {
+        *why = path + ": key mismatch";
+        return nullptr;
+    }
+    if (hdr->n_entries > CACHE_MAX_ENTRIES ||
+        sizeof(CacheHeader) + hdr->n_entries * sizeof(CacheEntry) > hdr->payload_offset ||
+        hdr->payload_offset % CACHE_ALIGN != 0 ||
+        hdr->payload_offset > file->size() || hdr->payload_size != file->size() - hdr->payload_offset) {
+        *why = path + ": bad layout";
+        return nullptr;
+    }
+    const uint8_t *payload = file->data() + hdr->payload_offset;
+    if (payload_checksum(payload, hdr->payload_size) != hdr->checksum) {
+        *why = path + ": checksum mismatch";
+        return nullptr;
+    }
+
+    std::vector<UndistortPlaneMap> loaded(n_maps);
+    std::vector<unsigned> seen(n_maps, 0);
+    const auto *entries = (const CacheEntry *) (file->data() + sizeof(CacheHeader));
+    for (uint32_t i = 0; i < hdr->n_entries; ++i) {
+        const CacheEntry *e = &entries[i];
+        if (e->table < 0 || e->table >= n_maps || e->kind < CACHE_KIND_MAP1 || e->kind > CACHE_KIND_MESH ||
+            (seen[e->table] & (1u << e->kind)) || e->type != expected_type(key->map_type, e->kind) ||
+            e->rows <= 0 || e->cols <= 0 || e->offset % CACHE_ALIGN != 0) {
+            *why = path + ": bad entry " + std::to_string(i);
+            return nullptr;
+        }
+        const int tw = e->table == 0 ? key->width : key->chroma_width;
+        const int th = e->table == 0 ? key->height : key->chroma_height;
+        UndistortPlaneMap *map = &loaded[e->table];
+        bool dims_ok;
+        if (e->kind == CACHE_KIND_MESH) {
+            /* 固定步长时条目里的步长必须与 key 一致，自适应时以条目为准 */
+            const int step_x = e->mesh_step >> 16, step_y = e->mesh_step & 0xffff;
+            const bool step_ok = key->max_mesh_error > 0 ||
+                                 (step_x == key->mesh_step_x && step_y == key->mesh_step_y);
+            map->mesh.width = tw;
+            map->mesh.height = th;
+            map->mesh.step_x = step_x;
+            map->mesh.step_y = step_y;
+            map->mesh.mesh_w = step_x > 0 ? (tw - 1) / step_x + 2 : 0;
+            map->mesh.mesh_h = step_y > 0 ? (th - 1) / step_y + 2 : 0;
+            dims_ok = step_ok && step_x > 0 && step_y > 0 && e->rows == map->mesh.mesh_h &&
+                      e->cols == 2 * map->mesh.mesh_w;
+        } else {
+            dims_ok = e->rows == th && e->cols == tw;
+        }
+        const size_t row_bytes = (size_t) e->cols * CV_ELEM_SIZE(e->type);
+        if (!dims_ok || tw <= 0 || th <= 0 || e->step < row_bytes ||
+            e->offset + (uint64_t) (e->rows - 1) * e->step + row_bytes > hdr->payload_size) {
+            *why = path + ": bad entry " + std::to_string(i);
+            return nullptr;
+        }
+        seen[e->table] |= 1u << e->kind;
+
+        void *data = (void *) (payload + e->offset);
+        if (e->kind == CACHE_KIND_MESH) {
+            /* 网格很小，拷出来放进 vector */
+            const auto *xy = (const float *) data;
+            map->mesh.xy.assign(xy, xy + (size_t) e->rows * e->cols);
+        } else {
+            /* 直接指向只读映射，调用者不得写入 */
+            cv::Mat m(e->rows, e->cols, e->type, data, (size_t) e->step);
+            (e->kind == CACHE_KIND_MAP1 ? map->map1 : map->map2) = m;
+        }
+    }
+
+    /* 每张需要的表都必须完整 */
+    for (int t = 0; t < n_maps; ++t) {
+        const bool wanted = t == 0 || key->chroma_width > 0;
+        unsigned need = 0;
+        for (int32_t kind = CACHE_KIND_MAP1; kind <= CACHE_KIND_MESH; ++kind)
+            if (expected_type(key->map_type, kind) >= 0)
+                need |= 1u << kind;
+        if (seen[t] != (wanted ? need : 0u)) {
+            *why = path + ": incomplete";
+            return nullptr;
+        }
+    }
+
+    for (int t = 0; t < n_maps; ++t) {
+        loaded[t].interp = key->map_type == UNDISTORT_MAP_NEAREST ? cv::INTER_NEAREST : cv::INTER_LINEAR;
+        maps[t] = loaded[t];
+    }
+    *aux = hdr->aux;
+    return file;
+}
+
+bool
+undistort_cache_store(const char *dir, const UndistortCacheKey *key,
+                      const UndistortPlaneMap *maps, int n_maps,
+                      double aux, std::string *why) {
+    std::vector<CacheEntry> entries;
+    std::vector<cv::Mat> mats;
+    size_t payload_size = 0;
+
+    auto add = [&](int table, int kind, const cv::Mat &m) {
+        CacheEntry e;
+        memset(&e, 0, sizeof(e));
+        e.table = table;
+        e.kind = kind;
+        e.rows = m.rows;
+        e.cols = m.cols;
+        e.type = m.type();
+        e.step = m.cols * m.elemSize(); /* 按紧凑行写，去掉原有的行填充 */
+        e.offset = payload_size;
+        payload_size = align_up(payload_size + (size_t) e.rows * e.step);
+        entries.push_back(e);
+        mats.push_back(m);
+    };
+    for (int t = 0; t < n_maps; ++t) {
+        if (!maps[t].map1.empty())
+            add(t, CACHE_KIND_MAP1, maps[t].map1);
+        if (!maps[t].map2.empty())
+            add(t, CACHE_KIND_MAP2, maps[t].map2);
+        if (!maps[t].mesh.xy.empty()) {
+            add(t, CACHE_KIND_MESH, cv::Mat(maps[t].mesh.mesh_h, 2 * maps[t].mesh.mesh_w, CV_32FC1,
+                                            (void *) maps[t].mesh.xy.data()));
+            entries.back().mesh_step = (maps[t].mesh.step_x << 16) | maps[t].mesh.step_y;
+        }
+    }
+
+    /* 先在内存里拼出载荷，算校验和 */
+    std::vector<uint8_t> payload(payload_size, 0);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const CacheEntry &e = entries[i];
+        for (int y = 0; y < e.rows; ++y)
+            memcpy(payload.data() + e.offset + (size_t) y * e.step, mats[i].ptr(y), e.step);
+    }
+
+    CacheHeader hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CACHE_MAGIC, sizeof(hdr.magic));
+    hdr.version = UNDISTORT_CACHE_VERSION;
+    hdr.byte_order = CACHE_BYTE_ORDER;
+    memcpy(&hdr.key, key, sizeof(*key));
+    hdr.n_entries = (uint32_t) entries.size();
+    hdr.aux = aux;
+    hdr.payload_offset = align_up(sizeof(CacheHeader) + entries.size() * sizeof(CacheEntry));
+    hdr.payload_size = payload.size();
+    hdr.checksum = payload_checksum(payload.data(), payload.size());
+
+    std::vector<uint8_t> head(hdr.payload_offset, 0);
+    memcpy(head.data(), &hdr, sizeof(hdr));
+    if (!entries.empty())
+        memcpy(head.data() + sizeof(hdr), entries.data(), entries.size() * sizeof(CacheEntry));
+
+    /* 临时文件写完整后 rename，并发的读者要么看到旧文件，要么看到完整的新文件 */
+    const std::string path = undistort_cache_path(dir, key);
+    std::string tmp = path + ".XXXXXX";
+    const int fd = mkstemp(&tmp[0]);
+    if (fd < 0) {
+        *why = tmp + ": " + strerror(errno);
+        return false;
+    }
+    bool ok = true;
+    for (const auto *buf: {&head, &payload}) {
+        size_t done = 0;
+        while (ok && done < buf->size()) {
+            const ssize_t n = write(fd, buf->data() + done, buf->size() - done);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                ok = false;
+            else
+                done += (size_t) n;
+        }
+    }
+    if (!ok)
+        *why = tmp + ": write: " + strerror(errno);
+    /* mkstemp 建的文件是 0600，改成和普通缓存文件一样让其他进程也能读 */
+    fchmod(fd, 0644);
+    if (close(fd) != 0 && ok) {
+        *why = tmp + ": close: " + strerror(errno);
+        ok = false;
+    }
+    if (ok && rename(tmp.c_str(), path.c_str()) != 0) {
+        *why = path + ": rename: " + strerror(errno);
+        ok = false;
+    }
+    if (!ok)
+        unlink(tmp.c_str());
+    return ok;
+}
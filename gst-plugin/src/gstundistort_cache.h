@@ -0,0 +1,71 @@
+#ifndef __GST_UNDISTORT_CACHE_H__
+#define __GST_UNDISTORT_CACHE_H__
+
+/* undistort 映射表的磁盘缓存，不依赖 GStreamer。
+ *
+ * 每组表（亮度 + 可选的色度）存成一个文件 <dir>/undistort-<key hash>.map：
+ *  - 固定头：magic、版本、字节序标记、完整的 key（防止 hash 碰撞）、载荷长度与校验和
+ *  - 条目表：每个矩阵的表号、种类、行列、类型、偏移与行步长
+ *  - 载荷：各矩阵按 64 字节对齐依次存放
+ * 加载时只读 mmap（MAP_SHARED，多个进程共享同一份页），稠密表直接包装成 cv::Mat 不拷贝；
+ * 任何不一致（版本、key、尺寸、越界、校验和）都视为失效，由调用者重新生成并覆盖。
+ * 写入先写临时文件再 rename，读者不会看到写了一半的文件。 */
+
+#include "gstundistort_maps.h"
+
+#include <memory>
+#include <string>
+
+#define UNDISTORT_CACHE_VERSION 5
+
+/* 决定表内容的全部参数；按字节比较与求 hash，使用前必须整体清零 */
+typedef struct {
+    double fx, fy, cx, cy;
+    double k1, k2, p1, p2, k3;
+    double alpha;
+    int32_t in_width, in_height; // 源图尺寸
+    int32_t width, height; // 输出尺寸
+    int32_t chroma_width, chroma_height; // 0 表示没有色度表
+    int32_t map_type; // UndistortMapType
+    int32_t mesh_step_x, mesh_step_y; // 只对 mesh 有效，其他格式为 0；自适应时为候选的基准步长
+    char backend[16]; // 生成并使用这组表的后端
+    int32_t chroma_sub_y; // 源色度的垂直下采样（2 = 4:2:0，1 = 4:2:2），没有色度表时为 0
+    double k4; // 只对鱼眼模型有效
+    double yaw, pitch, roll, zoom; // 虚拟视角，默认视角时全为 0
+    int32_t roi_x, roi_y, roi_width, roi_height;
+    int32_t camera_model; // UndistortCameraModel
+    int32_t reserved; // 补齐到 8 字节，保证没有未初始化的填充
+    double max_mesh_error; // mesh 按误差选步长的上限（像素），0 表示固定步长；实际步长记在条目里
+} UndistortCacheKey;
+
+/* 一个已映射的缓存文件，析构时 munmap；从它加载的 cv::Mat 在其存活期间有效 */
+class UndistortCacheFile {
+public:
+    UndistortCacheFile(void *addr, size_t size) : addr_(addr), size_(size) {}
+    ~UndistortCacheFile();
+
+    UndistortCacheFile(const UndistortCacheFile &) = delete;
+    UndistortCacheFile &operator=(const UndistortCacheFile &) = delete;
+
+    const uint8_t *data() const { return (const uint8_t *) addr_; }
+    size_t size() const { return size_; }
+
+private:
+    void *addr_;
+    size_t size_;
+};
+
+std::string undistort_cache_path(const char *dir, const UndistortCacheKey *key);
+
+/* 命中时填好 maps[0..n_maps)（map1/map2 指向映射内存）与 aux，返回映射对象；
+ * 文件不存在或失效时返回空，why 说明原因 */
+std::shared_ptr<UndistortCacheFile> undistort_cache_load(const char *dir, const UndistortCacheKey *key,
+                                                         UndistortPlaneMap *maps, int n_maps,
+                                                         double *aux, std::string *why);
+
+/* 写入缓存；aux 为调用者自定义的附加值（例如 mesh 误差） */
+bool undistort_cache_store(const char *dir, const UndistortCacheKey *key,
+                           const UndistortPlaneMap *maps, int n_maps,
+                           double aux, std::string *why);
+
+#endif /* __GST_UNDISTORT_CACHE_H__ */
@@ -0,0 +1,101 @@
+/* remap 与格式转换的融合，见 gstundistort_convert.h */
+
+#include "gstundistort_convert.h"
+
+#include <cmath>
+
+#define UNDISTORT_RGB_BITS 14
+
+void
+undistort_gather_row(const UndistortGatherSrc *src, uint8_t *const *dst, int dst_pixel_stride,
+                     const int16_t *xy, const uint16_t *fxy, int n) {
+    const int ps = src->pixel_stride;
+
+    for (int i = 0; i < n; ++i) {
+        const int sx = xy[2 * i];
+        const int sy = xy[2 * i + 1];
+        const int fx = fxy[i] & (UNDISTORT_INTER_TAB_SIZE - 1);
+        const int fy = fxy[i] >> UNDISTORT_INTER_BITS;
+        const int w00 = (UNDISTORT_INTER_TAB_SIZE - fx) * (UNDISTORT_INTER_TAB_SIZE - fy);
+        const int w01 = fx * (UNDISTORT_INTER_TAB_SIZE - fy);
+        const int w10 = (UNDISTORT_INTER_TAB_SIZE - fx) * fy;
+        const int w11 = fx * fy;
+        const size_t o = (size_t) i * dst_pixel_stride;
+
+        if ((unsigned) sx < (unsigned) (src->width - 1) && (unsigned) sy < (unsigned) (src->height - 1)) {
+            const size_t off = (size_t) sy * src->stride + (size_t) sx * ps;
+            for (int c = 0; c < src->n_comp; ++c) {
+                const uint8_t *p0 = src->comp[c] + off;
+                const uint8_t *p1 = p0 + src->stride;
+                dst[c][o] = (uint8_t) ((p0[0] * w00 + p0[ps] * w01 + p1[0] * w10 + p1[ps] * w11 + 512) >> 10);
+            }
+            continue;
+        }
+
+        /* 边缘：逐个邻点判断，越界按 0（与内核相同） */
+        const int w[4] = {w00, w01, w10, w11};
+        int acc[3] = {0, 0, 0};
+        for (int k = 0; k < 4; ++k) {
+            const int x = sx + (k & 1);
+            const int y = sy + (k >> 1);
+            if ((unsigned) x >= (unsigned) src->width || (unsigned) y >= (unsigned) src->height)
+                continue;
+            const size_t off = (size_t) y * src->stride + (size_t) x * ps;
+            for (int c = 0; c < src->n_comp; ++c)
+                acc[c] += src->comp[c][off] * w[k];
+        }
+        for (int c = 0; c < src->n_comp; ++c)
+            dst[c][o] = (uint8_t) ((acc[c] + 512) >> 10);
+    }
+}
+
+void
+undistort_yuv_to_rgb_init(UndistortYuvToRgb *m, double kr, double kb, bool full_range) {
+    const double one = (double) (1 << UNDISTORT_RGB_BITS);
+    const double kg = 1.0 - kr - kb;
+    const double ys = full_range ? 1.0 : 255.0 / 219.0;
+    const double cs = full_range ? 1.0 : 255.0 / 224.0;
+
+    m->y_off = full_range ? 0 : 16;
+    m->y_mul = (int) std::lround(ys * one);
+    m->rv = (int) std::lround(2.0 * (1.0 - kr) * cs * one);
+    m->bu = (int) std::lround(2.0 * (1.0 - kb) * cs * one);
+    m->gu = (int) std::lround(2.0 * kb * (1.0 - kb) / kg * cs * one);
+    m->gv = (int) std::lround(2.0 * kr * (1.0 - kr) / kg * cs * one);
+}
+
+static inline uint8_t
+clamp_u8(int v) {
+    return (uint8_t) (v < 0 ? 0 : v > 255 ? 255 : v);
+}
+
+void
+undistort_yuv_to_bgr_row(const UndistortYuvToRgb *m, const uint8_t *y, const uint8_t *uv,
+                         uint8_t *dst, int channels, int n) {
+    const int round = 1 << (UNDISTORT_RGB_BITS - 1);
+
+    for (int i = 0; i < n; ++i) {
+        const int yy = (y[i] - m->y_off) * m->y_mul + round;
+        const int u = uv[2 * (i >> 1)] - 128;
+        const int v = uv[2 * (i >> 1) + 1] - 128;
+        uint8_t *p = dst + (size_t) i * channels;
+        p[0] = clamp_u8((yy + m->bu * u) >> UNDISTORT_RGB_BITS);
+        p[1] = clamp_u8((yy - m->gu * u - m->gv * v) >> UNDISTORT_RGB_BITS);
+        p[2] = clamp_u8((yy + m->rv * v) >> UNDISTORT_RGB_BITS);
+        if (channels == 4)
+            p[3] = 255;
+    }
+}
+
+void
+undistort_repack_row(const uint8_t *src, int src_channels, uint8_t *dst, int dst_channels, int n) {
+    for (int i = 0; i < n; ++i) {
+        const uint8_t *s = src + (size_t) i * src_channels;
+        uint8_t *d = dst + (size_t) i * dst_channels;
+        d[0] = s[0];
+        d[1] = s[1];
+        d[2] = s[2];
+        if (dst_channels == 4)
+            d[3] = 255;
+    }
+}
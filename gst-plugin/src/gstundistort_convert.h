@@ -0,0 +1,47 @@
+#ifndef __GST_UNDISTORT_CONVERT_H__
+#define __GST_UNDISTORT_CONVERT_H__
+
+/* remap 与格式转换的融合，不依赖 GStreamer / OpenCV。
+ *
+ * 采样时直接按源格式的分量布局取邻点、按目标格式的布局写出，省去前后的 videoconvert：
+ *  - 采样使用与 gstundistort_kernels 相同的定点表（xy + fxy）、插值公式与边界处理，
+ *    因此 YUV 之间的转换与“先转换再 remap”（同样按 4:2:0 样点）逐位一致
+ *  - 转 BGR 时亮度/色度先采样到行缓冲（留在 L1），再用 14 位定点系数转 RGB，
+ *    每 2x2 个输出像素共用一个色度样点（与 4:2:0 输出的色度位置相同） */
+
+#include "gstundistort_kernels.h"
+
+/* 采样源：最多 3 个分量，分量 c 的像素 (x, y) 在 comp[c] + y * stride + x * pixel_stride。
+ * 例如 YUY2 的亮度为 {data}、pixel_stride 2；色度为 {data + 1, data + 3}、pixel_stride 4、宽度减半；
+ * I420 的色度为 {U 平面, V 平面}、pixel_stride 1（两个平面 stride 相同） */
+typedef struct {
+    const uint8_t *comp[3];
+    int n_comp;
+    int pixel_stride;
+    size_t stride;
+    int width, height;
+} UndistortGatherSrc;
+
+/* 按定点坐标采样一行 n 个像素，分量 c 写到 dst[c] + i * dst_pixel_stride（标量实现） */
+void undistort_gather_row(const UndistortGatherSrc *src, uint8_t *const *dst, int dst_pixel_stride,
+                          const int16_t *xy, const uint16_t *fxy, int n);
+
+/* YUV -> RGB 的 14 位定点系数 */
+typedef struct {
+    int y_off; // limited range 为 16，full range 为 0
+    int y_mul;
+    int rv, gu, gv, bu;
+} UndistortYuvToRgb;
+
+/* kr/kb 为色彩矩阵的亮度系数（BT.601: 0.299/0.114，BT.709: 0.2126/0.0722） */
+void undistort_yuv_to_rgb_init(UndistortYuvToRgb *m, double kr, double kb, bool full_range);
+
+/* 一行转 BGR/BGRx：y 为 n 个亮度，uv 为 (n + 1) / 2 对交错的 U/V（每两个像素共用一对），
+ * dst 每像素 channels 字节（3 或 4，第 4 字节写 255） */
+void undistort_yuv_to_bgr_row(const UndistortYuvToRgb *m, const uint8_t *y, const uint8_t *uv,
+                              uint8_t *dst, int channels, int n);
+
+/* BGR <-> BGRx：前三个分量不变，dst 为 4 通道时第 4 字节写 255 */
+void undistort_repack_row(const uint8_t *src, int src_channels, uint8_t *dst, int dst_channels, int n);
+
+#endif /* __GST_UNDISTORT_CONVERT_H__ */
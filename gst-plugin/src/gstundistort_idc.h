@@ -0,0 +1,34 @@
+#ifndef __GST_UNDISTORT_IDC_H__
+#define __GST_UNDISTORT_IDC_H__
+
+/* Rockchip IDC（librkalg_idc）后端：用 merged meshXY（与 UndistortMesh 同格式，步长为偶数，默认 16x8）
+ * 驱动硬件 remap，只支持 NV12。meson 选项 idc 不为 disabled 时编译，此时 config.h 定义 HAVE_IDC；
+ * 找不到厂商库时接口由 rkalg_idc_lut_emu（CPU 实现）提供，另外定义 HAVE_IDC_EMU。
+ * 没有 HAVE_IDC 时元素不会选择这个后端，也不调用这里的函数。 */
+
+#include "gstundistort_mesh.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+typedef struct _UndistortIdc UndistortIdc;
+
+/* IDC 输出的对齐要求：Y/UV 的 stride 按 16 字节，UV 平面从 Y 的 stride x 按 8 行对齐的高度处开始。
+ * 输出帧满足这个布局时硬件直接写进输出帧，否则写到内部对齐缓冲再按行拷贝 */
+#define UNDISTORT_IDC_DST_STRIDE_ALIGN 16
+#define UNDISTORT_IDC_DST_HEIGHT_ALIGN 8
+
+/* 一路输出的 IDC 上下文：源图 src_width x src_height，输出与 mesh 的平面同尺寸。
+ * 只保存 mesh 的指针，mesh 必须比上下文活得久。失败返回 NULL，why 为原因 */
+UndistortIdc *undistort_idc_new(int src_width, int src_height, const UndistortMesh *mesh, std::string *why);
+
+void undistort_idc_free(UndistortIdc *idc);
+
+/* 处理一帧 NV12；源或输出 stride 与初始化时不同会重新初始化。厂商库的初始化只有一个源 stride，
+ * 源 Y/UV stride 不同时只有 CPU 实现能处理。失败返回 false（输出未写），why 为原因 */
+bool undistort_idc_process(UndistortIdc *idc, const uint8_t *src_y, size_t src_y_stride, const uint8_t *src_uv,
+                           size_t src_uv_stride, uint8_t *dst_y, size_t dst_y_stride, uint8_t *dst_uv, size_t dst_uv_stride,
+                           std::string *why);
+
+#endif /* __GST_UNDISTORT_IDC_H__ */
@@ -0,0 +1,567 @@
+/* undistort 定点双线性 remap 内核，见 gstundistort_kernels.h
+ *
+ * 向量实现的思路：每个输出像素、每个通道需要 2x2 个源像素。把同一行的左右两个
+ * 邻点拼成一对 int16 (p0, p1)，权重拼成 (w0, w1)，一条 madd 就得到一行的贡献；
+ * 两行相加、+512、>>10 后与标量公式完全一致。
+ *  - SSE4.1 : 没有 gather，邻点对用标量读入后拼成向量
+ *  - AVX2   : 用 32/64 位 gather 一次取多个像素的邻点对
+ *  - AVX-512: 单通道 16 像素、双通道 8 像素一组；三/四通道沿用 AVX2
+ * 一组像素中只要有一个邻点越界就整组走标量路径（只发生在图像边缘）。 */
+
+#include "gstundistort_kernels.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define UNDISTORT_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+/* ================= 标量参考实现 ================= */
+
+template<int CN>
+static inline void
+remap_pixel_ref(const UndistortSrcPlane *src, uint8_t *dst, int sx, int sy, int f) {
+    const int fx = f & (UNDISTORT_INTER_TAB_SIZE - 1);
+    const int fy = f >> UNDISTORT_INTER_BITS;
+    const int w00 = (UNDISTORT_INTER_TAB_SIZE - fx) * (UNDISTORT_INTER_TAB_SIZE - fy);
+    const int w01 = fx * (UNDISTORT_INTER_TAB_SIZE - fy);
+    const int w10 = (UNDISTORT_INTER_TAB_SIZE - fx) * fy;
+    const int w11 = fx * fy;
+
+    if ((unsigned) sx < (unsigned) (src->width - 1) && (unsigned) sy < (unsigned) (src->height - 1)) {
+        const uint8_t *p0 = src->data + (size_t) sy * src->stride + (size_t) sx * CN;
+        const uint8_t *p1 = p0 + src->stride;
+        for (int c = 0; c < CN; ++c)
+            dst[c] = (uint8_t) ((p0[c] * w00 + p0[c + CN] * w01 + p1[c] * w10 + p1[c + CN] * w11 + 512) >> 10);
+        return;
+    }
+
+    /* 边缘：逐个邻点判断，越界按 0 */
+    const uint8_t *taps[4];
+    for (int k = 0; k < 4; ++k) {
+        const int x = sx + (k & 1);
+        const int y = sy + (k >> 1);
+        taps[k] = ((unsigned) x < (unsigned) src->width && (unsigned) y < (unsigned) src->height)
+                      ? src->data + (size_t) y * src->stride + (size_t) x * CN
+                      : nullptr;
+    }
+    for (int c = 0; c < CN; ++c) {
+        const int v = (taps[0] ? taps[0][c] * w00 : 0) + (taps[1] ? taps[1][c] * w01 : 0) +
+                      (taps[2] ? taps[2][c] * w10 : 0) + (taps[3] ? taps[3][c] * w11 : 0);
+        dst[c] = (uint8_t) ((v + 512) >> 10);
+    }
+}
+
+template<int CN>
+static inline void
+remap_span_ref(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    for (int i = 0; i < n; ++i)
+        remap_pixel_ref<CN>(src, dst + i * CN, xy[2 * i], xy[2 * i + 1], fxy[i]);
+}
+
+template<int CN>
+static void
+remap_row_ref(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    remap_span_ref<CN>(src, dst, xy, fxy, n);
+}
+
+#ifdef UNDISTORT_HAVE_X86
+
+#define UNDISTORT_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define UNDISTORT_TARGET_AVX2 __attribute__((target("avx2")))
+#define UNDISTORT_TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+
+#define Z (-128)
+
+/* ================= SSE4.1 ================= */
+
+/* 4 个像素的 (x, y) 是否都满足快速路径：0 <= x < w-1 且 0 <= y < h-1 */
+UNDISTORT_TARGET_SSE41 static inline bool
+inside4_sse(__m128i v, __m128i xmax, __m128i ymax) {
+    const __m128i neg1 = _mm_set1_epi32(-1);
+    const __m128i x = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+    const __m128i y = _mm_srai_epi32(v, 16);
+    const __m128i in = _mm_and_si128(_mm_and_si128(_mm_cmpgt_epi32(x, neg1), _mm_cmpgt_epi32(xmax, x)),
+                                     _mm_and_si128(_mm_cmpgt_epi32(y, neg1), _mm_cmpgt_epi32(ymax, y)));
+    return _mm_movemask_epi8(in) == 0xFFFF;
+}
+
+/* 4 个像素的权重：wa = w00 | w01 << 16（上一行），wb = w10 | w11 << 16（下一行） */
+UNDISTORT_TARGET_SSE41 static inline void
+weights4_sse(const uint16_t *fxy, __m128i *wa, __m128i *wb) {
+    const __m128i f = _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *) fxy));
+    const __m128i one = _mm_set1_epi32(UNDISTORT_INTER_TAB_SIZE);
+    const __m128i fx = _mm_and_si128(f, _mm_set1_epi32(UNDISTORT_INTER_TAB_SIZE - 1));
+    const __m128i fy = _mm_srli_epi32(f, UNDISTORT_INTER_BITS);
+    const __m128i ifx = _mm_sub_epi32(one, fx);
+    const __m128i ify = _mm_sub_epi32(one, fy);
+    /* 乘积 <= 1024，高 16 位都是 0，16 位乘法即可 */
+    *wa = _mm_or_si128(_mm_mullo_epi16(ifx, ify), _mm_slli_epi32(_mm_mullo_epi16(fx, ify), 16));
+    *wb = _mm_or_si128(_mm_mullo_epi16(ifx, fy), _mm_slli_epi32(_mm_mullo_epi16(fx, fy), 16));
+}
+
+UNDISTORT_TARGET_SSE41 static inline __m128i
+lerp_sse(__m128i r0, __m128i r1, __m128i wa, __m128i wb) {
+    const __m128i s = _mm_add_epi32(_mm_madd_epi16(r0, wa), _mm_madd_epi16(r1, wb));
+    return _mm_srli_epi32(_mm_add_epi32(s, _mm_set1_epi32(512)), 10);
+}
+
+/* 4 个 int32 结果压成 4 字节 */
+UNDISTORT_TARGET_SSE41 static inline uint32_t
+pack4_sse(__m128i s) {
+    const __m128i p = _mm_packus_epi32(s, s);
+    return (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(p, p));
+}
+
+static inline uint32_t
+load_u16(const uint8_t *p) {
+    uint16_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t
+load_u32(const uint8_t *p) {
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+/* 读一个像素对（2*CN 字节），不多读；BGR 拆成 4+2 字节，避免经栈中转的 store-forwarding 停顿 */
+template<int CN>
+UNDISTORT_TARGET_SSE41 static inline __m128i
+load_pair_sse(const uint8_t *p) {
+    if (CN == 4)
+        return _mm_loadl_epi64((const __m128i *) p);
+    return _mm_setr_epi32((int) load_u32(p), (int) load_u16(p + 4), 0, 0);
+}
+
+/* 三/四通道单个像素：邻点对重排成 (c_left, c_right) 交错后与权重 madd，L 为像素在组内的序号 */
+template<int CN, int L>
+UNDISTORT_TARGET_SSE41 static inline uint32_t
+pixel34_sse(const uint8_t *p0, size_t stride, __m128i wa, __m128i wb) {
+    const __m128i order = CN == 4
+                              ? _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, Z, Z, Z, Z, Z, Z, Z, Z)
+                              : _mm_setr_epi8(0, 3, 1, 4, 2, 5, Z, Z, Z, Z, Z, Z, Z, Z, Z, Z);
+    const __m128i r0 = _mm_cvtepu8_epi16(_mm_shuffle_epi8(load_pair_sse<CN>(p0), order));
+    const __m128i r1 = _mm_cvtepu8_epi16(_mm_shuffle_epi8(load_pair_sse<CN>(p0 + stride), order));
+    return pack4_sse(lerp_sse(r0, r1, _mm_shuffle_epi32(wa, L * 0x55), _mm_shuffle_epi32(wb, L * 0x55)));
+}
+
+template<int CN>
+UNDISTORT_TARGET_SSE41 static void
+remap_row_sse41(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    const __m128i xmax = _mm_set1_epi32(src->width - 1);
+    const __m128i ymax = _mm_set1_epi32(src->height - 1);
+    const size_t stride = src->stride;
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const int16_t *c = xy + 2 * i;
+        if (!inside4_sse(_mm_loadu_si128((const __m128i *) c), xmax, ymax)) {
+            remap_span_ref<CN>(src, dst + i * CN, c, fxy + i, 4);
+            continue;
+        }
+        __m128i wa, wb;
+        weights4_sse(fxy + i, &wa, &wb);
+
+        const uint8_t *p[4];
+        for (int k = 0; k < 4; ++k)
+            p[k] = src->data + (size_t) c[2 * k + 1] * stride + (size_t) c[2 * k] * CN;
+
+        if (CN == 1) {
+            const __m128i order = _mm_setr_epi8(0, Z, 1, Z, 4, Z, 5, Z, 8, Z, 9, Z, 12, Z, 13, Z);
+            const __m128i r0 = _mm_shuffle_epi8(_mm_setr_epi32(load_u16(p[0]), load_u16(p[1]),
+                                                               load_u16(p[2]), load_u16(p[3])), order);
+            const __m128i r1 = _mm_shuffle_epi8(_mm_setr_epi32(load_u16(p[0] + stride), load_u16(p[1] + stride),
+                                                               load_u16(p[2] + stride), load_u16(p[3] + stride)),
+                                                order);
+            const uint32_t v = pack4_sse(lerp_sse(r0, r1, wa, wb));
+            memcpy(dst + i, &v, 4);
+        } else if (CN == 2) {
+            /* [u0 v0 u1 v1] -> [u0 u1 v0 v1]，每次两个像素 */
+            const __m128i order = _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, Z, Z, Z, Z, Z, Z, Z, Z);
+            for (int k = 0; k < 4; k += 2) {
+                const __m128i r0 = _mm_cvtepu8_epi16(_mm_shuffle_epi8(
+                    _mm_setr_epi32(load_u32(p[k]), load_u32(p[k + 1]), 0, 0), order));
+                const __m128i r1 = _mm_cvtepu8_epi16(_mm_shuffle_epi8(
+                    _mm_setr_epi32(load_u32(p[k] + stride), load_u32(p[k + 1] + stride), 0, 0), order));
+                const __m128i pa = k == 0 ? _mm_shuffle_epi32(wa, 0x50) : _mm_shuffle_epi32(wa, 0xFA);
+                const __m128i pb = k == 0 ? _mm_shuffle_epi32(wb, 0x50) : _mm_shuffle_epi32(wb, 0xFA);
+                const uint32_t v = pack4_sse(lerp_sse(r0, r1, pa, pb));
+                memcpy(dst + (i + k) * 2, &v, 4);
+            }
+        } else {
+            const uint32_t v0 = pixel34_sse<CN, 0>(p[0], stride, wa, wb);
+            const uint32_t v1 = pixel34_sse<CN, 1>(p[1], stride, wa, wb);
+            const uint32_t v2 = pixel34_sse<CN, 2>(p[2], stride, wa, wb);
+            const uint32_t v3 = pixel34_sse<CN, 3>(p[3], stride, wa, wb);
+            uint8_t *d = dst + i * CN;
+            memcpy(d, &v0, CN);
+            memcpy(d + CN, &v1, CN);
+            memcpy(d + 2 * CN, &v2, CN);
+            memcpy(d + 3 * CN, &v3, CN);
+        }
+    }
+    remap_span_ref<CN>(src, dst + i * CN, xy + 2 * i, fxy + i, n - i);
+}
+
+/* ================= AVX2 ================= */
+
+UNDISTORT_TARGET_AVX2 static inline bool
+inside8_avx2(__m256i v, __m256i xmax, __m256i ymax) {
+    const __m256i neg1 = _mm256_set1_epi32(-1);
+    const __m256i x = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+    const __m256i y = _mm256_srai_epi32(v, 16);
+    const __m256i in = _mm256_and_si256(
+        _mm256_and_si256(_mm256_cmpgt_epi32(x, neg1), _mm256_cmpgt_epi32(xmax, x)),
+        _mm256_and_si256(_mm256_cmpgt_epi32(y, neg1), _mm256_cmpgt_epi32(ymax, y)));
+    return _mm256_movemask_epi8(in) == -1;
+}
+
+UNDISTORT_TARGET_AVX2 static inline void
+weights8_avx2(const uint16_t *fxy, __m256i *wa, __m256i *wb) {
+    const __m256i f = _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *) fxy));
+    const __m256i one = _mm256_set1_epi32(UNDISTORT_INTER_TAB_SIZE);
+    const __m256i fx = _mm256_and_si256(f, _mm256_set1_epi32(UNDISTORT_INTER_TAB_SIZE - 1));
+    const __m256i fy = _mm256_srli_epi32(f, UNDISTORT_INTER_BITS);
+    const __m256i ifx = _mm256_sub_epi32(one, fx);
+    const __m256i ify = _mm256_sub_epi32(one, fy);
+    *wa = _mm256_or_si256(_mm256_mullo_epi16(ifx, ify), _mm256_slli_epi32(_mm256_mullo_epi16(fx, ify), 16));
+    *wb = _mm256_or_si256(_mm256_mullo_epi16(ifx, fy), _mm256_slli_epi32(_mm256_mullo_epi16(fx, fy), 16));
+}
+
+UNDISTORT_TARGET_AVX2 static inline __m256i
+lerp_avx2(__m256i r0, __m256i r1, __m256i wa, __m256i wb) {
+    const __m256i s = _mm256_add_epi32(_mm256_madd_epi16(r0, wa), _mm256_madd_epi16(r1, wb));
+    return _mm256_srli_epi32(_mm256_add_epi32(s, _mm256_set1_epi32(512)), 10);
+}
+
+/* 8 个 int32 结果按顺序压成 8 字节 */
+UNDISTORT_TARGET_AVX2 static inline void
+store8_avx2(uint8_t *dst, __m256i s) {
+    __m256i p = _mm256_packus_epi32(s, s);
+    p = _mm256_packus_epi16(p, p);
+    p = _mm256_permutevar8x32_epi32(p, _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4));
+    _mm_storel_epi64((__m128i *) dst, _mm256_castsi256_si128(p));
+}
+
+/* 源坐标 -> 字节偏移 y * stride + x * CN */
+template<int CN>
+UNDISTORT_TARGET_AVX2 static inline __m256i
+offsets8_avx2(__m256i v, __m256i stride) {
+    const __m256i x = _mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16);
+    const __m256i y = _mm256_srai_epi32(v, 16);
+    __m256i xo = x;
+    if (CN == 2) xo = _mm256_slli_epi32(x, 1);
+    if (CN == 3) xo = _mm256_add_epi32(_mm256_slli_epi32(x, 1), x);
+    if (CN == 4) xo = _mm256_slli_epi32(x, 2);
+    return _mm256_add_epi32(_mm256_mullo_epi32(y, stride), xo);
+}
+
+/* 单通道：一组 8 像素，32 位 gather。
+ * 上一行从 x 处取 4 字节（用前 2 个，多读的部分落在下一行内）；
+ * 下一行从 x-2 处取 4 字节（用后 2 个），这样最后一行也不会读出缓冲区。 */
+UNDISTORT_TARGET_AVX2 static void
+remap_row_avx2_c1(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    const __m256i xmax = _mm256_set1_epi32(src->width - 1);
+    const __m256i ymax = _mm256_set1_epi32(src->height - 1);
+    const __m256i stride = _mm256_set1_epi32((int) src->stride);
+    const __m256i order0 = _mm256_setr_epi8(0, Z, 1, Z, 4, Z, 5, Z, 8, Z, 9, Z, 12, Z, 13, Z,
+                                            0, Z, 1, Z, 4, Z, 5, Z, 8, Z, 9, Z, 12, Z, 13, Z);
+    const __m256i order1 = _mm256_setr_epi8(2, Z, 3, Z, 6, Z, 7, Z, 10, Z, 11, Z, 14, Z, 15, Z,
+                                            2, Z, 3, Z, 6, Z, 7, Z, 10, Z, 11, Z, 14, Z, 15, Z);
+    const int *row0 = (const int *) src->data;
+    const int *row1 = (const int *) (src->data + src->stride - 2);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) (xy + 2 * i));
+        if (!inside8_avx2(v, xmax, ymax)) {
+            remap_span_ref<1>(src, dst + i, xy + 2 * i, fxy + i, 8);
+            continue;
+        }
+        __m256i wa, wb;
+        weights8_avx2(fxy + i, &wa, &wb);
+        const __m256i off = offsets8_avx2<1>(v, stride);
+        const __m256i r0 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(row0, off, 1), order0);
+        const __m256i r1 = _mm256_shuffle_epi8(_mm256_i32gather_epi32(row1, off, 1), order1);
+        store8_avx2(dst + i, lerp_avx2(r0, r1, wa, wb));
+    }
+    remap_span_ref<1>(src, dst + i, xy + 2 * i, fxy + i, n - i);
+}
+
+/* 双通道（NV12 UV）：一组 4 像素，每个像素对正好 4 字节，不会多读 */
+UNDISTORT_TARGET_AVX2 static void
+remap_row_avx2_c2(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    const __m128i xmax = _mm_set1_epi32(src->width - 1);
+    const __m128i ymax = _mm_set1_epi32(src->height - 1);
+    const __m128i stride = _mm_set1_epi32((int) src->stride);
+    const __m128i order = _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+    const __m256i spread = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    const int *row0 = (const int *) src->data;
+    const int *row1 = (const int *) (src->data + src->stride);
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (xy + 2 * i));
+        if (!inside4_sse(v, xmax, ymax)) {
+            remap_span_ref<2>(src, dst + 2 * i, xy + 2 * i, fxy + i, 4);
+            continue;
+        }
+        __m128i wa4, wb4;
+        weights4_sse(fxy + i, &wa4, &wb4);
+        const __m256i wa = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(wa4), spread);
+        const __m256i wb = _mm256_permutevar8x32_epi32(_mm256_castsi128_si256(wb4), spread);
+
+        const __m128i x = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        const __m128i y = _mm_srai_epi32(v, 16);
+        const __m128i off = _mm_add_epi32(_mm_mullo_epi32(y, stride), _mm_slli_epi32(x, 1));
+        const __m256i r0 = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_i32gather_epi32(row0, off, 1), order));
+        const __m256i r1 = _mm256_cvtepu8_epi16(_mm_shuffle_epi8(_mm_i32gather_epi32(row1, off, 1), order));
+        store8_avx2(dst + 2 * i, lerp_avx2(r0, r1, wa, wb));
+    }
+    remap_span_ref<2>(src, dst + 2 * i, xy + 2 * i, fxy + i, n - i);
+}
+
+/* 三/四通道：一组 4 像素，64 位 gather。
+ * BGRx 每个像素对正好 8 字节；BGR 只用 6 字节，处理方式同单通道：
+ * 上一行从 x 处取（多读 2 字节），下一行从 x-2 字节处取。 */
+template<int CN>
+UNDISTORT_TARGET_AVX2 static void
+remap_row_avx2_c34(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    const __m128i xmax = _mm_set1_epi32(src->width - 1);
+    const __m128i ymax = _mm_set1_epi32(src->height - 1);
+    const __m128i stride = _mm_set1_epi32((int) src->stride);
+    const __m256i order0 = CN == 4
+                               ? _mm256_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15,
+                                                  0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15)
+                               : _mm256_setr_epi8(0, 3, 1, 4, 2, 5, Z, Z, 8, 11, 9, 12, 10, 13, Z, Z,
+                                                  0, 3, 1, 4, 2, 5, Z, Z, 8, 11, 9, 12, 10, 13, Z, Z);
+    const __m256i order1 = CN == 4
+                               ? order0
+                               : _mm256_setr_epi8(2, 5, 3, 6, 4, 7, Z, Z, 10, 13, 11, 14, 12, 15, Z, Z,
+                                                  2, 5, 3, 6, 4, 7, Z, Z, 10, 13, 11, 14, 12, 15, Z, Z);
+    const __m256i spread_lo = _mm256_setr_epi32(0, 0, 0, 0, 1, 1, 1, 1);
+    const __m256i spread_hi = _mm256_setr_epi32(2, 2, 2, 2, 3, 3, 3, 3);
+    const __m128i compact3 = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, Z, Z, Z, Z);
+    const long long *row0 = (const long long *) src->data;
+    const long long *row1 = (const long long *) (src->data + src->stride - (CN == 3 ? 2 : 0));
+    int i = 0;
+
+    for (; i + 4 <= n; i += 4) {
+        const __m128i v = _mm_loadu_si128((const __m128i *) (xy + 2 * i));
+        if (!inside4_sse(v, xmax, ymax)) {
+            remap_span_ref<CN>(src, dst + CN * i, xy + 2 * i, fxy + i, 4);
+            continue;
+        }
+        __m128i wa4, wb4;
+        weights4_sse(fxy + i, &wa4, &wb4);
+
+        const __m128i x = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+        const __m128i y = _mm_srai_epi32(v, 16);
+        const __m128i xo = CN == 4 ? _mm_slli_epi32(x, 2) : _mm_add_epi32(_mm_slli_epi32(x, 1), x);
+        const __m128i off = _mm_add_epi32(_mm_mullo_epi32(y, stride), xo);
+        const __m256i g0 = _mm256_shuffle_epi8(_mm256_i32gather_epi64(row0, off, 1), order0);
+        const __m256i g1 = _mm256_shuffle_epi8(_mm256_i32gather_epi64(row1, off, 1), order1);
+
+        /* lo: 像素 0/1，hi: 像素 2/3，每个像素 4 个 int32 结果（BGR 的第 4 个为 0） */
+        const __m256i wa = _mm256_castsi128_si256(wa4);
+        const __m256i wb = _mm256_castsi128_si256(wb4);
+        const __m256i s_lo = lerp_avx2(_mm256_cvtepu8_epi16(_mm256_castsi256_si128(g0)),
+                                       _mm256_cvtepu8_epi16(_mm256_castsi256_si128(g1)),
+                                       _mm256_permutevar8x32_epi32(wa, spread_lo),
+                                       _mm256_permutevar8x32_epi32(wb, spread_lo));
+        const __m256i s_hi = lerp_avx2(_mm256_cvtepu8_epi16(_mm256_extracti128_si256(g0, 1)),
+                                       _mm256_cvtepu8_epi16(_mm256_extracti128_si256(g1, 1)),
+                                       _mm256_permutevar8x32_epi32(wa, spread_hi),
+                                       _mm256_permutevar8x32_epi32(wb, spread_hi));
+        __m256i p = _mm256_packus_epi32(s_lo, s_hi);
+        p = _mm256_packus_epi16(p, p);
+        const __m128i px = _mm256_castsi256_si128(
+            _mm256_permutevar8x32_epi32(p, _mm256_setr_epi32(0, 4, 1, 5, 0, 4, 1, 5)));
+        if (CN == 4) {
+            _mm_storeu_si128((__m128i *) (dst + 4 * i), px);
+        } else {
+            const __m128i bgr = _mm_shuffle_epi8(px, compact3);
+            const uint32_t tail = (uint32_t) _mm_extract_epi32(bgr, 2);
+            _mm_storel_epi64((__m128i *) (dst + 3 * i), bgr);
+            memcpy(dst + 3 * i + 8, &tail, 4);
+        }
+    }
+    remap_span_ref<CN>(src, dst + CN * i, xy + 2 * i, fxy + i, n - i);
+}
+
+/* ================= AVX-512（F + BW） ================= */
+
+/* GCC 12 对 avx512 intrinsic 内部的 _mm512_undefined_epi32() 会误报未初始化 */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+UNDISTORT_TARGET_AVX512 static inline void
+weights16_avx512(const uint16_t *fxy, __m512i *wa, __m512i *wb) {
+    const __m512i f = _mm512_cvtepu16_epi32(_mm256_loadu_si256((const __m256i *) fxy));
+    const __m512i one = _mm512_set1_epi32(UNDISTORT_INTER_TAB_SIZE);
+    const __m512i fx = _mm512_and_si512(f, _mm512_set1_epi32(UNDISTORT_INTER_TAB_SIZE - 1));
+    const __m512i fy = _mm512_srli_epi32(f, UNDISTORT_INTER_BITS);
+    const __m512i ifx = _mm512_sub_epi32(one, fx);
+    const __m512i ify = _mm512_sub_epi32(one, fy);
+    *wa = _mm512_or_si512(_mm512_mullo_epi16(ifx, ify), _mm512_slli_epi32(_mm512_mullo_epi16(fx, ify), 16));
+    *wb = _mm512_or_si512(_mm512_mullo_epi16(ifx, fy), _mm512_slli_epi32(_mm512_mullo_epi16(fx, fy), 16));
+}
+
+UNDISTORT_TARGET_AVX512 static inline __m512i
+lerp_avx512(__m512i r0, __m512i r1, __m512i wa, __m512i wb) {
+    const __m512i s = _mm512_add_epi32(_mm512_madd_epi16(r0, wa), _mm512_madd_epi16(r1, wb));
+    return _mm512_srli_epi32(_mm512_add_epi32(s, _mm512_set1_epi32(512)), 10);
+}
+
+/* 单通道：一组 16 像素，读法同 AVX2 版本 */
+UNDISTORT_TARGET_AVX512 static void
+remap_row_avx512_c1(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    const __m512i xmax = _mm512_set1_epi32(src->width - 1);
+    const __m512i ymax = _mm512_set1_epi32(src->height - 1);
+    const __m512i stride = _mm512_set1_epi32((int) src->stride);
+    /* 与 AVX2 版本的 order0/order1 相同，按 dword 写出（0x80 为置零） */
+    const __m512i order0 = _mm512_set4_epi32((int) 0x800D800C, (int) 0x80098008,
+                                             (int) 0x80058004, (int) 0x80018000);
+    const __m512i order1 = _mm512_set4_epi32((int) 0x800F800E, (int) 0x800B800A,
+                                             (int) 0x80078006, (int) 0x80038002);
+    const uint8_t *row0 = src->data;
+    const uint8_t *row1 = src->data + src->stride - 2;
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        const __m512i v = _mm512_loadu_si512((const void *) (xy + 2 * i));
+        const __m512i x = _mm512_srai_epi32(_mm512_slli_epi32(v, 16), 16);
+        const __m512i y = _mm512_srai_epi32(v, 16);
+        /* 无符号比较把负坐标一并排除 */
+        const __mmask16 in = _mm512_cmplt_epu32_mask(x, xmax) & _mm512_cmplt_epu32_mask(y, ymax);
+        if (in != 0xFFFF) {
+            remap_span_ref<1>(src, dst + i, xy + 2 * i, fxy + i, 16);
+            continue;
+        }
+        __m512i wa, wb;
+        weights16_avx512(fxy + i, &wa, &wb);
+        const __m512i off = _mm512_add_epi32(_mm512_mullo_epi32(y, stride), x);
+        const __m512i r0 = _mm512_shuffle_epi8(_mm512_i32gather_epi32(off, row0, 1), order0);
+        const __m512i r1 = _mm512_shuffle_epi8(_mm512_i32gather_epi32(off, row1, 1), order1);
+        _mm_storeu_si128((__m128i *) (dst + i), _mm512_cvtepi32_epi8(lerp_avx512(r0, r1, wa, wb)));
+    }
+    remap_span_ref<1>(src, dst + i, xy + 2 * i, fxy + i, n - i);
+}
+
+/* 双通道：一组 8 像素，16 个 int32 结果正好是 u0 v0 ... u7 v7 */
+UNDISTORT_TARGET_AVX512 static void
+remap_row_avx512_c2(const UndistortSrcPlane *src, uint8_t *dst, const int16_t *xy, const uint16_t *fxy, int n) {
+    const __m256i xmax = _mm256_set1_epi32(src->width - 1);
+    const __m256i ymax = _mm256_set1_epi32(src->height - 1);
+    const __m256i stride = _mm256_set1_epi32((int) src->stride);
+    const __m256i order = _mm256_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15,
+                                           0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15);
+    const __m512i spread = _mm512_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7);
+    const int *row0 = (const int *) src->data;
+    const int *row1 = (const int *) (src->data + src->stride);
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const __m256i v = _mm256_loadu_si256((const __m256i *) (xy + 2 * i));
+        if (!inside8_avx2(v, xmax, ymax)) {
+            remap_span_ref<2>(src, dst + 2 * i, xy + 2 * i, fxy + i, 8);
+            continue;
+        }
+        __m256i wa8, wb8;
+        weights8_avx2(fxy + i, &wa8, &wb8);
+        const __m512i wa = _mm512_permutexvar_epi32(spread, _mm512_castsi256_si512(wa8));
+        const __m512i wb = _mm512_permutexvar_epi32(spread, _mm512_castsi256_si512(wb8));
+        const __m256i off = offsets8_avx2<2>(v, stride);
+        const __m512i r0 = _mm512_cvtepu8_epi16(_mm256_shuffle_epi8(_mm256_i32gather_epi32(row0, off, 1), order));
+        const __m512i r1 = _mm512_cvtepu8_epi16(_mm256_shuffle_epi8(_mm256_i32gather_epi32(row1, off, 1), order));
+        _mm_storeu_si128((__m128i *) (dst + 2 * i), _mm512_cvtepi32_epi8(lerp_avx512(r0, r1, wa, wb)));
+    }
+    remap_span_ref<2>(src, dst + 2 * i, xy + 2 * i, fxy + i, n - i);
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#undef Z
+
+#endif /* UNDISTORT_HAVE_X86 */
+
+/* ================= 分发 ================= */
+
+static UndistortIsa
+detect_isa(void) {
+#ifdef UNDISTORT_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+        return UNDISTORT_ISA_AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return UNDISTORT_ISA_AVX2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return UNDISTORT_ISA_SSE41;
+#endif
+    return UNDISTORT_ISA_SCALAR;
+}
+
+UndistortIsa
+undistort_kernels_detect_isa(void) {
+    static const UndistortIsa isa = detect_isa();
+    return isa;
+}
+
+const char *
+undistort_isa_name(UndistortIsa isa) {
+    switch (isa) {
+        case UNDISTORT_ISA_SSE41: return "sse4.1";
+        case UNDISTORT_ISA_AVX2: return "avx2";
+        case UNDISTORT_ISA_AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+UndistortRemapRowFunc
+undistort_kernels_get(int channels, UndistortIsa isa) {
+    static const UndistortRemapRowFunc ref[4] = {
+        remap_row_ref<1>, remap_row_ref<2>, remap_row_ref<3>, remap_row_ref<4>,
+    };
+    if (channels < 1 || channels > 4)
+        return nullptr;
+    if (isa > undistort_kernels_detect_isa())
+        isa = undistort_kernels_detect_isa();
+
+#ifdef UNDISTORT_HAVE_X86
+    static const UndistortRemapRowFunc sse41[4] = {
+        remap_row_sse41<1>, remap_row_sse41<2>, remap_row_sse41<3>, remap_row_sse41<4>,
+    };
+    static const UndistortRemapRowFunc avx2[4] = {
+        remap_row_avx2_c1, remap_row_avx2_c2, remap_row_avx2_c34<3>, remap_row_avx2_c34<4>,
+    };
+    static const UndistortRemapRowFunc avx512[4] = {
+        remap_row_avx512_c1, remap_row_avx512_c2, remap_row_avx2_c34<3>, remap_row_avx2_c34<4>,
+    };
+    switch (isa) {
+        case UNDISTORT_ISA_AVX512: return avx512[channels - 1];
+        case UNDISTORT_ISA_AVX2: return avx2[channels - 1];
+        case UNDISTORT_ISA_SSE41: return sse41[channels - 1];
+        default: break;
+    }
+#endif
+    return ref[channels - 1];
+}
+
+void
+undistort_remap_rows(UndistortRemapRowFunc func, const UndistortSrcPlane *src,
+                     uint8_t *dst, size_t dst_stride, int width,
+                     const int16_t *xy, size_t xy_stride,
+                     const uint16_t *fxy, size_t fxy_stride,
+                     int y0, int y1) {
+    for (int y = y0; y < y1; ++y)
+        func(src, dst + (size_t) y * dst_stride, xy + (size_t) y * xy_stride, fxy + (size_t) y * fxy_stride, width);
+}
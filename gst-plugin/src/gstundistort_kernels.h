@@ -0,0 +1,56 @@
+#ifndef __GST_UNDISTORT_KERNELS_H__
+#define __GST_UNDISTORT_KERNELS_H__
+
+/* undistort 专用的定点双线性 remap 内核，不依赖 GStreamer / OpenCV。
+ *
+ * 映射表与 OpenCV 的 CV_16SC2 + CV_16UC1 格式一致（map-format=fixed）：
+ *  - xy[2*i], xy[2*i+1] : 源坐标整数部分（向下取整）
+ *  - fxy[i]             : (fy << 5) | fx，1/32 像素的小数部分
+ * 插值公式（所有实现逐位一致）：
+ *  v = (p00*(32-fx)*(32-fy) + p01*fx*(32-fy) + p10*(32-fx)*fy + p11*fx*fy + 512) >> 10
+ * 落在图像外的邻点按 0 处理（同 cv::BORDER_CONSTANT）。
+ *
+ * 每种通道数（1 = GRAY8/Y 平面，2 = NV12 UV 平面，3 = BGR，4 = BGRx）都有
+ * 标量参考实现与 SSE4.1/AVX2/AVX-512 实现，运行时按 CPU 特性选择。 */
+
+#include <cstddef>
+#include <cstdint>
+
+#define UNDISTORT_INTER_BITS 5
+#define UNDISTORT_INTER_TAB_SIZE (1 << UNDISTORT_INTER_BITS)
+
+typedef enum {
+    UNDISTORT_ISA_SCALAR,
+    UNDISTORT_ISA_SSE41,
+    UNDISTORT_ISA_AVX2,
+    UNDISTORT_ISA_AVX512,
+} UndistortIsa;
+
+/* 源平面：整帧可读，width/height 以像素计 */
+typedef struct {
+    const uint8_t *data;
+    size_t stride;
+    int width;
+    int height;
+} UndistortSrcPlane;
+
+/* 计算一行中连续 n 个输出像素 */
+typedef void (*UndistortRemapRowFunc)(const UndistortSrcPlane *src, uint8_t *dst,
+                                      const int16_t *xy, const uint16_t *fxy, int n);
+
+/* 当前 CPU 支持的最高 ISA（结果缓存） */
+UndistortIsa undistort_kernels_detect_isa(void);
+
+const char *undistort_isa_name(UndistortIsa isa);
+
+/* channels 为 1..4；返回不高于 isa 的最佳实现，isa=SCALAR 即参考实现 */
+UndistortRemapRowFunc undistort_kernels_get(int channels, UndistortIsa isa);
+
+/* 按行调用内核，处理输出的 [y0, y1) 行；xy_stride/fxy_stride 以元素个数计 */
+void undistort_remap_rows(UndistortRemapRowFunc func, const UndistortSrcPlane *src,
+                          uint8_t *dst, size_t dst_stride, int width,
+                          const int16_t *xy, size_t xy_stride,
+                          const uint16_t *fxy, size_t fxy_stride,
+                          int y0, int y1);
+
+#endif /* __GST_UNDISTORT_KERNELS_H__ */
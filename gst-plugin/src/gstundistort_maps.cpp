@@ -0,0 +1,258 @@
+/* undistort 映射表的生成与格式转换，见 gstundistort_maps.h */
+
+#include "gstundistort_maps.h"
+
+#include <algorithm>
+#include <cmath>
+
+void
+undistort_plane_map_from_float(UndistortPlaneMap *map, const cv::Mat &mapx, const cv::Mat &mapy,
+                               UndistortMapType type, int mesh_step_x, int mesh_step_y) {
+    map->mesh.xy.clear();
+    switch (type) {
+        case UNDISTORT_MAP_FLOAT32:
+            map->map1 = mapx;
+            map->map2 = mapy;
+            map->interp = cv::INTER_LINEAR;
+            break;
+        case UNDISTORT_MAP_FIXED:
+            cv::convertMaps(mapx, mapy, map->map1, map->map2, CV_16SC2, false);
+            map->interp = cv::INTER_LINEAR;
+            break;
+        case UNDISTORT_MAP_NEAREST:
+            /* nninterpolation=true 时坐标四舍五入，不输出插值索引 */
+            cv::convertMaps(mapx, mapy, map->map1, map->map2, CV_16SC2, true);
+            map->map2.release();
+            map->interp = cv::INTER_NEAREST;
+            break;
+        case UNDISTORT_MAP_MESH:
+            map->map1.release();
+            map->map2.release();
+            undistort_mesh_build(&map->mesh, mapx, mapy, mesh_step_x, mesh_step_y);
+            map->interp = cv::INTER_LINEAR;
+            break;
+    }
+}
+
+size_t
+undistort_plane_map_bytes(const UndistortPlaneMap *map) {
+    return map->map1.total() * map->map1.elemSize() + map->map2.total() * map->map2.elemSize() +
+           map->mesh.xy.size() * sizeof(float);
+}
+
+void
+undistort_maps_derive_chroma(const cv::Mat &mapx, const cv::Mat &mapy, cv::Size chroma_size,
+                             int src_sub_y, cv::Mat &cmapx, cv::Mat &cmapy) {
+    const int w = mapx.cols;
+    const int h = mapx.rows;
+
+    cmapx.create(chroma_size, CV_32FC1);
+    cmapy.create(chroma_size, CV_32FC1);
+
+    for (int v = 0; v < chroma_size.height; ++v) {
+        /* 奇数尺寸时最后一个色度样点只覆盖一行/一列亮度 */
+        const int y0 = std::min(2 * v, h - 1);
+        const int y1 = std::min(2 * v + 1, h - 1);
+        const float *x0row = mapx.ptr<float>(y0), *x1row = mapx.ptr<float>(y1);
+        const float *y0row = mapy.ptr<float>(y0), *y1row = mapy.ptr<float>(y1);
+        float *cx = cmapx.ptr<float>(v);
+        float *cy = cmapy.ptr<float>(v);
+        for (int u = 0; u < chroma_size.width; ++u) {
+            const int x0 = std::min(2 * u, w - 1);
+            const int x1 = std::min(2 * u + 1, w - 1);
+            const float X = 0.25f * (x0row[x0] + x0row[x1] + x1row[x0] + x1row[x1]);
+            const float Y = 0.25f * (y0row[x0] + y0row[x1] + y1row[x0] + y1row[x1]);
+            cx[u] = (X - 0.5f) * 0.5f;
+            cy[u] = src_sub_y == 2 ? (Y - 0.5f) * 0.5f : Y;
+        }
+    }
+}
+
+/* 有效区域为空（畸变参数异常）时退回整幅图 */
+static cv::Rect
+valid_roi(const cv::Mat &K, const cv::Mat &D, cv::Size in_size, double alpha, cv::Mat *newK) {
+    cv::Rect valid;
+    *newK = cv::getOptimalNewCameraMatrix(K, D, in_size, alpha, in_size, &valid);
+    if (valid.width <= 0 || valid.height <= 0)
+        valid = cv::Rect(0, 0, in_size.width, in_size.height);
+    return valid;
+}
+
+cv::Mat
+undistort_maps_new_camera_matrix(const cv::Mat &K, const cv::Mat &D, cv::Size in_size, double alpha,
+                                 cv::Size out_size, cv::Rect *valid) {
+    cv::Mat newK;
+    const cv::Rect roi = valid_roi(K, D, in_size, alpha, &newK);
+
+    /* 以像素中心对齐：输出像素 u 对应有效区域内坐标 (u + 0.5) / s - 0.5 + roi.x */
+    const double sx = (double) out_size.width / roi.width;
+    const double sy = (double) out_size.height / roi.height;
+    newK.at<double>(0, 0) *= sx;
+    newK.at<double>(1, 1) *= sy;
+    newK.at<double>(0, 2) = (newK.at<double>(0, 2) - roi.x + 0.5) * sx - 0.5;
+    newK.at<double>(1, 2) = (newK.at<double>(1, 2) - roi.y + 0.5) * sy - 0.5;
+
+    if (valid)
+        *valid = roi;
+    return newK;
+}
+
+cv::Mat
+undistort_maps_roi_camera_matrix(const cv::Mat &K, cv::Rect roi, cv::Size out_size) {
+    cv::Mat newK = K.clone();
+    const double sx = (double) out_size.width / roi.width;
+    const double sy = (double) out_size.height / roi.height;
+    newK.at<double>(0, 0) *= sx;
+    newK.at<double>(1, 1) *= sy;
+    newK.at<double>(0, 2) = (newK.at<double>(0, 2) - roi.x + 0.5) * sx - 0.5;
+    newK.at<double>(1, 2) = (newK.at<double>(1, 2) - roi.y + 0.5) * sy - 0.5;
+    return newK;
+}
+
+cv::Mat
+undistort_maps_scale_camera_matrix(const cv::Mat &K, cv::Size in_size, cv::Size out_size) {
+    return undistort_maps_roi_camera_matrix(K, cv::Rect(0, 0, in_size.width, in_size.height), out_size);
+}
+
+cv::Size
+undistort_maps_valid_size(const cv::Mat &K, const cv::Mat &D, cv::Size in_size, double alpha) {
+    cv::Mat newK;
+    const cv::Rect roi = valid_roi(K, D, in_size, alpha, &newK);
+    return cv::Size(std::max(roi.width & ~1, 2), std::max(roi.height & ~1, 2));
+}
+
+bool
+undistort_view_is_default(const UndistortView *view) {
+    return view->yaw == 0 && view->pitch == 0 && view->roll == 0 && view->zoom == 1 && view->roi.area() <= 0;
+}
+
+void
+undistort_maps_view(const cv::Mat &K, const UndistortView *view, cv::Size in_size, cv::Size out_size,
+                    cv::Mat *R, cv::Mat *P) {
+    /* 虚拟相机的光线 v 在原相机里是 Ry(yaw) * Rx(pitch) * Rz(roll) * v（y 轴向下，pitch 向上取反），
+     * initUndistortRectifyMap 用 R 的逆把虚拟光线转回原相机，所以 R 取它的转置 */
+    const double yaw = view->yaw * CV_PI / 180.0;
+    const double pitch = -view->pitch * CV_PI / 180.0;
+    const double roll = view->roll * CV_PI / 180.0;
+    const cv::Mat ry = (cv::Mat_<double>(3, 3) << cos(yaw), 0, sin(yaw), 0, 1, 0, -sin(yaw), 0, cos(yaw));
+    const cv::Mat rx = (cv::Mat_<double>(3, 3) << 1, 0, 0, 0, cos(pitch), -sin(pitch), 0, sin(pitch), cos(pitch));
+    const cv::Mat rz = (cv::Mat_<double>(3, 3) << cos(roll), -sin(roll), 0, sin(roll), cos(roll), 0, 0, 0, 1);
+    *R = (ry * rx * rz).t();
+
+    if (view->roi.area() > 0) {
+        *P = undistort_maps_roi_camera_matrix(K, view->roi, out_size);
+        return;
+    }
+    const double sx = (double) out_size.width / in_size.width;
+    const double sy = (double) out_size.height / in_size.height;
+    *P = (cv::Mat_<double>(3, 3) << K.at<double>(0, 0) * view->zoom * sx, 0, 0.5 * (out_size.width - 1),
+          0, K.at<double>(1, 1) * view->zoom * sy, 0.5 * (out_size.height - 1),
+          0, 0, 1);
+}
+
+cv::Mat
+undistort_maps_fisheye_camera_matrix(const cv::Mat &K, const cv::Mat &D, cv::Size in_size, double balance,
+                                     cv::Size out_size) {
+    cv::Mat newK;
+    cv::fisheye::estimateNewCameraMatrixForUndistortRectify(K, D, in_size, cv::Mat::eye(3, 3, CV_64F), newK,
+                                                            balance, out_size);
+    return newK;
+}
+
+void
+undistort_maps_init(UndistortCameraModel model, const cv::Mat &K, const cv::Mat &D, const cv::Mat &R,
+                    const cv::Mat &P, cv::Size size, cv::Mat &mapx, cv::Mat &mapy) {
+    if (model == UNDISTORT_MODEL_FISHEYE)
+        cv::fisheye::initUndistortRectifyMap(K, D, R.empty() ? cv::Mat::eye(3, 3, CV_64F) : R, P, size, CV_32FC1,
+                                             mapx, mapy);
+    else
+        cv::initUndistortRectifyMap(K, D, R, P, size, CV_32FC1, mapx, mapy);
+}
+
+/* 逐点的映射公式与 OpenCV 的 initUndistortRectifyMap / fisheye::initUndistortRectifyMap 相同：
+ * 输出像素经 (P * R)^-1 转成归一化坐标，加畸变后乘原内参 */
+void
+undistort_maps_init_grid(UndistortCameraModel model, const cv::Mat &K, const cv::Mat &D, const cv::Mat &R,
+                         const cv::Mat &P, const std::vector<int> &cols, const std::vector<int> &rows,
+                         cv::Mat &mapx, cv::Mat &mapy) {
+    cv::Mat K64, D64, R64, P64;
+    K.convertTo(K64, CV_64F);
+    D.reshape(1, 1).convertTo(D64, CV_64F);
+    if (R.empty())
+        R64 = cv::Mat::eye(3, 3, CV_64F);
+    else
+        R.convertTo(R64, CV_64F);
+    P.colRange(0, 3).convertTo(P64, CV_64F);
+    const cv::Mat iR = (P64 * R64).inv(model == UNDISTORT_MODEL_FISHEYE ? cv::DECOMP_SVD : cv::DECOMP_LU);
+
+    double ir[9], d[5] = {0, 0, 0, 0, 0};
+    for (int i = 0; i < 9; ++i)
+        ir[i] = iR.at<double>(i / 3, i % 3);
+    for (int i = 0; i < std::min(D64.cols, 5); ++i)
+        d[i] = D64.at<double>(0, i);
+    const double fx = K64.at<double>(0, 0), fy = K64.at<double>(1, 1);
+    const double cx = K64.at<double>(0, 2), cy = K64.at<double>(1, 2);
+
+    mapx.create((int) rows.size(), (int) cols.size(), CV_32FC1);
+    mapy.create((int) rows.size(), (int) cols.size(), CV_32FC1);
+    cv::parallel_for_(cv::Range(0, (int) rows.size()), [&](const cv::Range &range) {
+        for (int r = range.start; r < range.end; ++r) {
+            const double v = rows[r];
+            float *mx = mapx.ptr<float>(r);
+            float *my = mapy.ptr<float>(r);
+            for (size_t c = 0; c < cols.size(); ++c) {
+                const double u = cols[c];
+                const double X = u * ir[0] + v * ir[1] + ir[2];
+                const double Y = u * ir[3] + v * ir[4] + ir[5];
+                const double W = u * ir[6] + v * ir[7] + ir[8];
+                double su, sv;
+                if (model == UNDISTORT_MODEL_FISHEYE) {
+                    /* 等距模型，D = k1..k4；光线在相机后方时同 OpenCV 给出无穷远 */
+                    if (W <= 0) {
+                        su = X > 0 ? -HUGE_VAL : HUGE_VAL;
+                        sv = Y > 0 ? -HUGE_VAL : HUGE_VAL;
+                    } else {
+                        const double x = X / W, y = Y / W;
+                        const double rr = std::sqrt(x * x + y * y);
+                        const double theta = std::atan(rr);
+                        const double t2 = theta * theta, t4 = t2 * t2, t6 = t4 * t2, t8 = t4 * t4;
+                        const double theta_d = theta * (1 + d[0] * t2 + d[1] * t4 + d[2] * t6 + d[3] * t8);
+                        const double scale = rr == 0 ? 1.0 : theta_d / rr;
+                        su = fx * x * scale + cx;
+                        sv = fy * y * scale + cy;
+                    }
+                } else {
+                    /* 针孔模型，D = k1,k2,p1,p2,k3 */
+                    const double w = 1.0 / W, x = X * w, y = Y * w;
+                    const double x2 = x * x, y2 = y * y, r2 = x2 + y2, _2xy = 2 * x * y;
+                    const double kr = 1 + ((d[4] * r2 + d[1]) * r2 + d[0]) * r2;
+                    su = fx * (x * kr + d[2] * _2xy + d[3] * (r2 + 2 * x2)) + cx;
+                    sv = fy * (y * kr + d[2] * (r2 + 2 * y2) + d[3] * _2xy) + cy;
+                }
+                mx[c] = (float) su;
+                my[c] = (float) sv;
+            }
+        }
+    });
+}
+
+void
+undistort_maps_init_chroma_grid(UndistortCameraModel model, const cv::Mat &K, const cv::Mat &D, const cv::Mat &R,
+                                const cv::Mat &P, cv::Size luma_size, int src_sub_y, const std::vector<int> &cols,
+                                const std::vector<int> &rows, cv::Mat &cmapx, cv::Mat &cmapy) {
+    /* 每个色度样点对应的 2x2 亮度像素（奇数尺寸时夹到最后一行/列），
+     * 在这些亮度像素上求值后按 undistort_maps_derive_chroma 同样的方式平均 */
+    std::vector<int> lcols, lrows;
+    for (int c : cols) {
+        lcols.push_back(std::min(2 * c, luma_size.width - 1));
+        lcols.push_back(std::min(2 * c + 1, luma_size.width - 1));
+    }
+    for (int r : rows) {
+        lrows.push_back(std::min(2 * r, luma_size.height - 1));
+        lrows.push_back(std::min(2 * r + 1, luma_size.height - 1));
+    }
+    cv::Mat mapx, mapy;
+    undistort_maps_init_grid(model, K, D, R, P, lcols, lrows, mapx, mapy);
+    undistort_maps_derive_chroma(mapx, mapy, cv::Size((int) cols.size(), (int) rows.size()), src_sub_y,
+                                 cmapx, cmapy);
+}
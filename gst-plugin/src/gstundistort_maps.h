@@ -0,0 +1,100 @@
+#ifndef __GST_UNDISTORT_MAPS_H__
+#define __GST_UNDISTORT_MAPS_H__
+
+/* undistort 映射表的生成与格式转换，只依赖 OpenCV（基准程序也直接使用）。 */
+
+#include "gstundistort_mesh.h"
+
+#include <opencv2/opencv.hpp>
+
+/* 与 GstUndistortMapFormat 取值一一对应 */
+typedef enum {
+    UNDISTORT_MAP_FLOAT32,
+    UNDISTORT_MAP_FIXED,
+    UNDISTORT_MAP_NEAREST,
+    UNDISTORT_MAP_MESH,
+} UndistortMapType;
+
+/* 一个平面的 remap 表：
+ *  float32 : map1/map2 = mapx/mapy（CV_32FC1）
+ *  fixed   : map1 = CV_16SC2 整数坐标，map2 = CV_16UC1 插值索引
+ *  nearest : map1 = CV_16SC2 四舍五入坐标，map2 为空
+ *  mesh    : map1/map2 为空，只保存稀疏网格 mesh */
+typedef struct {
+    cv::Mat map1, map2;
+    int interp; /* cv::INTER_LINEAR 或 cv::INTER_NEAREST */
+    UndistortMesh mesh;
+} UndistortPlaneMap;
+
+/* 把浮点表转换成指定格式（只在协商时调用）；mesh_step_x/y 只对 mesh 格式有效 */
+void undistort_plane_map_from_float(UndistortPlaneMap *map, const cv::Mat &mapx, const cv::Mat &mapy,
+                                    UndistortMapType type, int mesh_step_x, int mesh_step_y);
+
+size_t undistort_plane_map_bytes(const UndistortPlaneMap *map);
+
+/* 由全分辨率浮点表推导 2x2 下采样色度平面的浮点表。
+ * 色度样点取 2x2 亮度块中心：亮度坐标 (2u+0.5, 2v+0.5) 处的映射为四个亮度表项的均值，
+ * 再换算回源色度坐标：水平 (X - 0.5) / 2；垂直按源的色度下采样，
+ * src_sub_y=2（4:2:0）为 (Y - 0.5) / 2，src_sub_y=1（4:2:2，例如 YUY2）为 Y。 */
+void undistort_maps_derive_chroma(const cv::Mat &mapx, const cv::Mat &mapy, cv::Size chroma_size,
+                                  int src_sub_y, cv::Mat &cmapx, cv::Mat &cmapy);
+
+/* 按 getOptimalNewCameraMatrix 计算新内参：alpha=0 只保留有效像素，alpha=1 保留全部源像素。
+ * 输出只覆盖有效区域，并把它缩放到 out_size；valid 返回有效区域（源图尺寸下），可为 NULL */
+cv::Mat undistort_maps_new_camera_matrix(const cv::Mat &K, const cv::Mat &D, cv::Size in_size, double alpha,
+                                         cv::Size out_size, cv::Rect *valid);
+
+/* alpha < 0 时的新内参：保留原视场，只把整幅源图缩放到 out_size（像素中心对齐） */
+cv::Mat undistort_maps_scale_camera_matrix(const cv::Mat &K, cv::Size in_size, cv::Size out_size);
+
+/* 新内参：把矫正后（内参为 K、源图尺寸）图像中的矩形 roi 缩放到 out_size（像素中心对齐） */
+cv::Mat undistort_maps_roi_camera_matrix(const cv::Mat &K, cv::Rect roi, cv::Size out_size);
+
+/* 有效区域的尺寸（宽高向下取偶数，便于 4:2:0），协商输出尺寸时使用 */
+cv::Size undistort_maps_valid_size(const cv::Mat &K, const cv::Mat &D, cv::Size in_size, double alpha);
+
+/* 相机模型：针孔（D = k1,k2,p1,p2,k3）或鱼眼（cv::fisheye 的等距模型，D = k1,k2,k3,k4） */
+typedef enum {
+    UNDISTORT_MODEL_PINHOLE,
+    UNDISTORT_MODEL_FISHEYE,
+} UndistortCameraModel;
+
+/* 虚拟视角：虚拟针孔相机相对原相机转过 yaw（向右为正）、pitch（向上为正）、roll（度），
+ * 焦距为原焦距（按输出尺寸缩放）的 zoom 倍，主点在输出中心；
+ * roi 非空时改为把转过之后的矫正图像（内参为原内参、源图尺寸）中的 roi 缩放到输出，zoom 不起作用 */
+typedef struct {
+    double yaw, pitch, roll;
+    double zoom;
+    cv::Rect roi;
+} UndistortView;
+
+/* 默认视角（不转、zoom 1、无 roi）等同于不设视角 */
+bool undistort_view_is_default(const UndistortView *view);
+
+/* 按视角求 initUndistortRectifyMap 的 R（校正旋转）与 P（新内参） */
+void undistort_maps_view(const cv::Mat &K, const UndistortView *view, cv::Size in_size, cv::Size out_size,
+                         cv::Mat *R, cv::Mat *P);
+
+/* 鱼眼模型的新内参：balance 0 只保留有效像素，1 保留全部源像素（同 alpha），缩放到 out_size */
+cv::Mat undistort_maps_fisheye_camera_matrix(const cv::Mat &K, const cv::Mat &D, cv::Size in_size, double balance,
+                                             cv::Size out_size);
+
+/* 按相机模型生成 CV_32FC1 的 mapx/mapy；R 为空表示不旋转 */
+void undistort_maps_init(UndistortCameraModel model, const cv::Mat &K, const cv::Mat &D, const cv::Mat &R,
+                         const cv::Mat &P, cv::Size size, cv::Mat &mapx, cv::Mat &mapy);
+
+/* 只在输出像素 cols x rows 的交叉点上直接按相机模型求映射，mapx/mapy 为 rows.size() x cols.size()
+ * 的 CV_32FC1，与 undistort_maps_init 在对应位置的值在 float 精度内一致。按行并行（cv::parallel_for_）。
+ * 稀疏网格只需要采样点，不用先生成两张全分辨率浮点表（4K 下 66 MB） */
+void undistort_maps_init_grid(UndistortCameraModel model, const cv::Mat &K, const cv::Mat &D, const cv::Mat &R,
+                              const cv::Mat &P, const std::vector<int> &cols, const std::vector<int> &rows,
+                              cv::Mat &mapx, cv::Mat &mapy);
+
+/* 同上，求 2x2 下采样色度平面在色度像素 cols x rows 交叉点上的映射，
+ * 与 undistort_maps_derive_chroma 对 luma_size 稠密表的结果一致 */
+void undistort_maps_init_chroma_grid(UndistortCameraModel model, const cv::Mat &K, const cv::Mat &D,
+                                     const cv::Mat &R, const cv::Mat &P, cv::Size luma_size, int src_sub_y,
+                                     const std::vector<int> &cols, const std::vector<int> &rows,
+                                     cv::Mat &cmapx, cv::Mat &cmapy);
+
+#endif /* __GST_UNDISTORT_MAPS_H__ */
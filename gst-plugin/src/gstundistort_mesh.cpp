@@ -0,0 +1,314 @@
+/* 稀疏网格 remap，见 gstundistort_mesh.h */
+
+#include "gstundistort_mesh.h"
+
+#include <algorithm>
+#include <cmath>
+
+/* 网格右边界外推：已知最后一个采样点 last（位于 last_col）与图像最后一列的值 edge，
+ * 求 col 处的网格值，使网格在 last_col..col 之间线性插值时恰好经过 edge。
+ * 最后一个采样点就在图像边缘时（a == 0）改用前一个采样点 prev 线性外推，避免除 0 */
+static inline float
+mesh_extrapolate(float last, float prev, float edge, int a, int b, int step) {
+    if (a == 0)
+        return last + (last - prev);
+    return (step * edge - b * last) / a;
+}
+
+/* 最后一行在 col 列的值；col 超出右边界时按右边界外推规则给出虚拟值，
+ * 这样右下角网格点同时满足最后一行与最后一列的插值约束。at(row, col) 读映射 */
+template <typename At>
+static float
+mesh_last_row(const At &at, int dstW, int dstH, int stepX, int col) {
+    if (col < dstW)
+        return at(dstH - 1, col);
+    int last_sampled_col = col;
+    while (last_sampled_col >= dstW) last_sampled_col -= stepX;
+    const int prev_col = last_sampled_col >= stepX ? last_sampled_col - stepX : last_sampled_col;
+    return mesh_extrapolate(at(dstH - 1, last_sampled_col), at(dstH - 1, prev_col), at(dstH - 1, dstW - 1),
+                            (dstW - 1) - last_sampled_col, col - (dstW - 1), stepX);
+}
+
+/* 由映射生成 IDC merged meshXY——来自 Rockchip 文档逻辑。
+ * 与原实现相比：先处理下边界（右下角用 mesh_last_row 的虚拟值，原实现在角上会有
+ * 接近 1 像素的误差），并处理了最后一个采样点恰好落在边缘时的除 0。
+ * at_x/at_y(row, col) 只会在采样行/列（步长的整数倍）与最后一行/列的交叉点上读取 */
+template <typename AtX, typename AtY>
+static void
+mesh_from_map(int dstW, int dstH, int meshW, int meshH, int stepX, int stepY, const AtX &at_x, const AtY &at_y,
+              float *pMeshXY) {
+    for (int row = 0, mesh_row = 0; mesh_row < meshH; row += stepY, mesh_row++) {
+        for (int col = 0, mesh_col = 0; mesh_col < meshW; col += stepX, mesh_col++) {
+            size_t mesh_idx = ((size_t) mesh_row * meshW + mesh_col) * 2;
+            if (row >= dstH) {  /* Bottom border extrapolate */
+                int last_sampled_row = row;
+                while (last_sampled_row >= dstH) last_sampled_row -= stepY;
+                int a = (dstH - 1) - last_sampled_row;
+                int b = row - (dstH - 1);
+                const float *last = &pMeshXY[2 * (mesh_col + (size_t) meshW * (last_sampled_row / stepY))];
+                const float *prev = last_sampled_row >= stepY ? last - 2 * (size_t) meshW : last;
+                pMeshXY[mesh_idx] = mesh_extrapolate(last[0], prev[0],
+                                                     mesh_last_row(at_x, dstW, dstH, stepX, col), a, b, stepY);
+                pMeshXY[mesh_idx + 1] = mesh_extrapolate(last[1], prev[1],
+                                                         mesh_last_row(at_y, dstW, dstH, stepX, col), a, b, stepY);
+                continue;
+            }
+            if (col >= dstW) {    /* Right border extrapolate */
+                int last_sampled_col = col;
+                while (last_sampled_col >= dstW) last_sampled_col -= stepX;
+                int a = (dstW - 1) - last_sampled_col;
+                int b = col - (dstW - 1);
+                const float *last = &pMeshXY[2 * (last_sampled_col / stepX + (size_t) meshW * mesh_row)];
+                const float *prev = last_sampled_col >= stepX ? last - 2 : last;
+                pMeshXY[mesh_idx] = mesh_extrapolate(last[0], prev[0], at_x(row, dstW - 1), a, b, stepX);
+                pMeshXY[mesh_idx + 1] = mesh_extrapolate(last[1], prev[1], at_y(row, dstW - 1), a, b, stepX);
+                continue;
+            }
+            pMeshXY[mesh_idx] = at_x(row, col);
+            pMeshXY[mesh_idx + 1] = at_y(row, col);
+        }
+    }
+}
+
+void
+undistort_mesh_from_dense(int dstW, int dstH,
+                          int meshW, int meshH,
+                          int stepX, int stepY,
+                          const float *pf32mapx, const float *pf32mapy,
+                          float *pMeshXY) {
+    mesh_from_map(dstW, dstH, meshW, meshH, stepX, stepY,
+                  [=](int row, int col) { return pf32mapx[(size_t) row * dstW + col]; },
+                  [=](int row, int col) { return pf32mapy[(size_t) row * dstW + col]; }, pMeshXY);
+}
+
+static void
+mesh_init(UndistortMesh *mesh, int w, int h, int step_x, int step_y) {
+    mesh->width = w;
+    mesh->height = h;
+    mesh->step_x = step_x;
+    mesh->step_y = step_y;
+    mesh->mesh_w = (w - 1) / step_x + 2;
+    mesh->mesh_h = (h - 1) / step_y + 2;
+    mesh->xy.assign((size_t) mesh->mesh_w * mesh->mesh_h * 2, 0.0f);
+}
+
+void
+undistort_mesh_build(UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy, int step_x, int step_y) {
+    const int w = mapx.cols;
+    const int h = mapx.rows;
+    mesh_init(mesh, w, h, step_x, step_y);
+
+    /* 外推读取的是整行连续的稠密表 */
+    const cv::Mat mx = mapx.isContinuous() ? mapx : mapx.clone();
+    const cv::Mat my = mapy.isContinuous() ? mapy : mapy.clone();
+    undistort_mesh_from_dense(w, h, mesh->mesh_w, mesh->mesh_h, step_x, step_y,
+                              mx.ptr<float>(), my.ptr<float>(), mesh->xy.data());
+}
+
+std::vector<int>
+undistort_mesh_sample_coords(int size, int step) {
+    std::vector<int> coords;
+    for (int i = 0; i < size; i += step)
+        coords.push_back(i);
+    if (coords.back() != size - 1)
+        coords.push_back(size - 1);
+    return coords;
+}
+
+std::vector<int>
+undistort_mesh_centre_coords(int size, int step) {
+    std::vector<int> coords;
+    for (int i = 0; i < size; i += step)
+        coords.push_back(i + std::min(step, size - i) / 2);
+    return coords;
+}
+
+void
+undistort_mesh_build_sampled(UndistortMesh *mesh, int width, int height, int step_x, int step_y,
+                             const cv::Mat &gx, const cv::Mat &gy) {
+    mesh_init(mesh, width, height, step_x, step_y);
+
+    /* 采样列 col 是 step_x 的整数倍时在第 col / step_x 列，最后一列 width - 1 在末列（同时是整数倍时两者相同） */
+    const int last_c = gx.cols - 1, last_r = gx.rows - 1;
+    auto index = [=](int row, int col, int *r, int *c) {
+        *r = row == height - 1 ? last_r : row / step_y;
+        *c = col == width - 1 ? last_c : col / step_x;
+    };
+    mesh_from_map(width, height, mesh->mesh_w, mesh->mesh_h, step_x, step_y,
+                  [&](int row, int col) {
+                      int r, c;
+                      index(row, col, &r, &c);
+                      return gx.at<float>(r, c);
+                  },
+                  [&](int row, int col) {
+                      int r, c;
+                      index(row, col, &r, &c);
+                      return gy.at<float>(r, c);
+                  },
+                  mesh->xy.data());
+}
+
+/* 展开第 y 行的浮点坐标：先在上下两行网格点之间竖直插值，再在每个网格单元内水平步进 */
+static void
+mesh_expand_row(const UndistortMesh *mesh, int y, float *xs, float *ys) {
+    const int my = y / mesh->step_y;
+    const float ty = (float) (y - my * mesh->step_y) / (float) mesh->step_y;
+    const float inv_sx = 1.0f / (float) mesh->step_x;
+    const float *r0 = &mesh->xy[(size_t) my * mesh->mesh_w * 2];
+    const float *r1 = r0 + (size_t) mesh->mesh_w * 2;
+
+    float lx = r0[0] + (r1[0] - r0[0]) * ty;
+    float ly = r0[1] + (r1[1] - r0[1]) * ty;
+    for (int mx = 0, x0 = 0; x0 < mesh->width; ++mx, x0 += mesh->step_x) {
+        const float rx = r0[2 * mx + 2] + (r1[2 * mx + 2] - r0[2 * mx + 2]) * ty;
+        const float ry = r0[2 * mx + 3] + (r1[2 * mx + 3] - r0[2 * mx + 3]) * ty;
+        const float dx = (rx - lx) * inv_sx;
+        const float dy = (ry - ly) * inv_sx;
+        const int n = std::min(mesh->step_x, mesh->width - x0);
+        for (int i = 0; i < n; ++i) {
+            xs[x0 + i] = lx + dx * (float) i;
+            ys[x0 + i] = ly + dy * (float) i;
+        }
+        lx = rx;
+        ly = ry;
+    }
+}
+
+bool
+undistort_mesh_error(const UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy, double limit,
+                     double *max_error, double *rms_error) {
+    std::vector<float> xs(mesh->width), ys(mesh->width);
+    const double limit2 = limit > 0 ? limit * limit : HUGE_VAL;
+    double max_err2 = 0.0, sum_err2 = 0.0;
+
+    for (int y = 0; y < mesh->height; ++y) {
+        mesh_expand_row(mesh, y, xs.data(), ys.data());
+        const float *dx = mapx.ptr<float>(y);
+        const float *dy = mapy.ptr<float>(y);
+        for (int x = 0; x < mesh->width; ++x) {
+            const double ex = xs[x] - dx[x];
+            const double ey = ys[x] - dy[x];
+            const double e2 = ex * ex + ey * ey;
+            max_err2 = std::max(max_err2, e2);
+            sum_err2 += e2;
+        }
+        /* 按行检查即可：超出后这一行剩下的像素不影响结论 */
+        if (max_err2 > limit2) {
+            *max_error = std::sqrt(max_err2);
+            *rms_error = 0.0;
+            return false;
+        }
+    }
+    *max_error = std::sqrt(max_err2);
+    *rms_error = std::sqrt(sum_err2 / std::max(1.0, (double) mesh->width * mesh->height));
+    return true;
+}
+
+double
+undistort_mesh_max_error(const UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy) {
+    double max_error, rms_error;
+    undistort_mesh_error(mesh, mapx, mapy, 0.0, &max_error, &rms_error);
+    return max_error;
+}
+
+/* 网格在 (x, y) 处展开的坐标，算法与 mesh_expand_row 相同 */
+static void
+mesh_point(const UndistortMesh *mesh, int x, int y, float *px, float *py) {
+    const int my = y / mesh->step_y, mx = x / mesh->step_x;
+    const float ty = (float) (y - my * mesh->step_y) / (float) mesh->step_y;
+    const float inv_sx = 1.0f / (float) mesh->step_x;
+    const float *p0 = &mesh->xy[((size_t) my * mesh->mesh_w + mx) * 2];
+    const float *p1 = p0 + (size_t) mesh->mesh_w * 2;
+    const float lx = p0[0] + (p1[0] - p0[0]) * ty;
+    const float ly = p0[1] + (p1[1] - p0[1]) * ty;
+    const float rx = p0[2] + (p1[2] - p0[2]) * ty;
+    const float ry = p0[3] + (p1[3] - p0[3]) * ty;
+    const float i = (float) (x - mx * mesh->step_x);
+    *px = lx + (rx - lx) * inv_sx * i;
+    *py = ly + (ry - ly) * inv_sx * i;
+}
+
+void
+undistort_mesh_error_sampled(const UndistortMesh *mesh, const std::vector<int> &cols, const std::vector<int> &rows,
+                             const cv::Mat &gx, const cv::Mat &gy, double *max_error, double *rms_error) {
+    double max_err2 = 0.0, sum_err2 = 0.0;
+    for (size_t r = 0; r < rows.size(); ++r) {
+        const float *dx = gx.ptr<float>((int) r);
+        const float *dy = gy.ptr<float>((int) r);
+        for (size_t c = 0; c < cols.size(); ++c) {
+            float px, py;
+            mesh_point(mesh, cols[c], rows[r], &px, &py);
+            const double ex = px - dx[c];
+            const double ey = py - dy[c];
+            const double e2 = ex * ex + ey * ey;
+            max_err2 = std::max(max_err2, e2);
+            sum_err2 += e2;
+        }
+    }
+    *max_error = std::sqrt(max_err2);
+    *rms_error = std::sqrt(sum_err2 / std::max(1.0, (double) cols.size() * rows.size()));
+}
+
+void
+undistort_mesh_build_adaptive(UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy,
+                              int base_x, int base_y, double max_error, double *max_out, double *rms_out) {
+    /* 候选从最粗到最细；误差大致随步长单调增长，粗的通过了就不再试更细的 */
+    int sx = base_x, sy = base_y;
+    while (sx * 2 <= 256 && sy * 2 <= 256) {
+        sx *= 2;
+        sy *= 2;
+    }
+    for (;;) {
+        undistort_mesh_build(mesh, mapx, mapy, sx, sy);
+        const bool last = sx / 2 < 2 || sy / 2 < 2;
+        /* 最后一档不设上限，要拿到完整的 max/rms */
+        if (undistort_mesh_error(mesh, mapx, mapy, last ? 0.0 : max_error, max_out, rms_out) || last)
+            return;
+        sx /= 2;
+        sy /= 2;
+    }
+}
+
+/* 行缓冲：float xs[w], ys[w], int16 xy[2w], uint16 fxy[w] */
+size_t
+undistort_mesh_row_buffer_size(const UndistortMesh *mesh) {
+    return (size_t) mesh->width * (2 * sizeof(float) + 2 * sizeof(int16_t) + sizeof(uint16_t));
+}
+
+void
+undistort_mesh_fixed_row(const UndistortMesh *mesh, int y, void *row_buf,
+                         const int16_t **xy_out, const uint16_t **fxy_out) {
+    const int w = mesh->width;
+    float *xs = (float *) row_buf;
+    float *ys = xs + w;
+    int16_t *xy = (int16_t *) (ys + w);
+    uint16_t *fxy = (uint16_t *) (xy + 2 * w);
+    /* 与 cv::convertMaps 一致：坐标乘 32 后四舍五入，整数部分饱和到 int16 */
+    const float lo = (float) INT16_MIN;
+    const float hi = (float) INT16_MAX;
+
+    mesh_expand_row(mesh, y, xs, ys);
+    for (int x = 0; x < w; ++x) {
+        const int ix = cvRound(std::min(std::max(xs[x], lo), hi) * UNDISTORT_INTER_TAB_SIZE);
+        const int iy = cvRound(std::min(std::max(ys[x], lo), hi) * UNDISTORT_INTER_TAB_SIZE);
+        xy[2 * x] = (int16_t) (ix >> UNDISTORT_INTER_BITS);
+        xy[2 * x + 1] = (int16_t) (iy >> UNDISTORT_INTER_BITS);
+        fxy[x] = (uint16_t) (((iy & (UNDISTORT_INTER_TAB_SIZE - 1)) << UNDISTORT_INTER_BITS) |
+                             (ix & (UNDISTORT_INTER_TAB_SIZE - 1)));
+    }
+    *xy_out = xy;
+    *fxy_out = fxy;
+}
+
+void
+undistort_mesh_remap_rows(const UndistortMesh *mesh, UndistortRemapRowFunc func,
+                          const UndistortSrcPlane *src, uint8_t *dst, size_t dst_stride,
+                          int y0, int y1, void *row_buf) {
+    const int16_t *xy;
+    const uint16_t *fxy;
+
+    for (int y = y0; y < y1; ++y) {
+        undistort_mesh_fixed_row(mesh, y, row_buf, &xy, &fxy);
+        func(src, dst + (size_t) y * dst_stride, xy, fxy, mesh->width);
+    }
+}
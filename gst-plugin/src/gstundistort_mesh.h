@@ -0,0 +1,78 @@
+#ifndef __GST_UNDISTORT_MESH_H__
+#define __GST_UNDISTORT_MESH_H__
+
+/* 稀疏网格 remap：只保存每 step_x x step_y 个输出像素一个采样点的浮点坐标，
+ * 逐行在 L1 里双线性展开成定点坐标后交给 gstundistort_kernels 的内核。
+ *
+ * 网格格式与 Rockchip IDC 的 merged meshXY 相同：x,y 交错的 float，
+ * mesh_w = (w - 1) / step_x + 2，mesh_h = (h - 1) / step_y + 2，右/下边界外推一格。
+ * 16x8 步长时每 128 个像素只读 8 字节表，而 fixed 稠密表是每像素 6 字节。 */
+
+#include "gstundistort_kernels.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+typedef struct {
+    std::vector<float> xy; // mesh_w * mesh_h * 2
+    int mesh_w, mesh_h;
+    int step_x, step_y;
+    int width, height; // 输出平面尺寸
+} UndistortMesh;
+
+/* 稠密 mapx/mapy（连续存储）采样成 merged meshXY，pMeshXY 长度为 meshW * meshH * 2 */
+void undistort_mesh_from_dense(int dstW, int dstH,
+                               int meshW, int meshH,
+                               int stepX, int stepY,
+                               const float *pf32mapx, const float *pf32mapy,
+                               float *pMeshXY);
+
+/* 由 CV_32FC1 的 mapx/mapy 生成网格 */
+void undistort_mesh_build(UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy, int step_x, int step_y);
+
+/* 不生成稠密表时网格需要的采样坐标（输出像素）：0, step, 2*step, ... 再加上最后一个像素 size - 1
+ * （已包含时不重复）。右/下边界外推只用到最后一行/列，所以这些行列交叉点上的映射就足够生成网格 */
+std::vector<int> undistort_mesh_sample_coords(int size, int step);
+
+/* 每个网格单元中心（最后一个不完整的单元取它覆盖部分的中心）的坐标，双线性网格的误差大致在这里最大 */
+std::vector<int> undistort_mesh_centre_coords(int size, int step);
+
+/* 由 undistort_mesh_sample_coords(width, step_x) x undistort_mesh_sample_coords(height, step_y)
+ * 交叉点上的映射（CV_32FC1，行 x 列）生成 width x height 平面的网格，结果与对同一映射的稠密表
+ * 调用 undistort_mesh_build 相同 */
+void undistort_mesh_build_sampled(UndistortMesh *mesh, int width, int height, int step_x, int step_y,
+                                  const cv::Mat &gx, const cv::Mat &gy);
+
+/* 网格在 cols x rows 交叉点上展开的坐标与这些点上的映射 gx/gy 的最大/均方根误差（像素）；
+ * 没有稠密表时用网格单元中心上的抽样估计误差 */
+void undistort_mesh_error_sampled(const UndistortMesh *mesh, const std::vector<int> &cols, const std::vector<int> &rows,
+                                  const cv::Mat &gx, const cv::Mat &gy, double *max_error, double *rms_error);
+
+/* 网格展开后的坐标与稠密表的最大欧氏距离（像素），只在协商时调用 */
+double undistort_mesh_max_error(const UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy);
+
+/* 同上，另给出均方根误差。limit > 0 时最大误差一超过 limit 就停止并返回 false（rms 无效），
+ * 用来快速淘汰候选步长 */
+bool undistort_mesh_error(const UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy, double limit,
+                          double *max_error, double *rms_error);
+
+/* 按误差选步长：base_x x base_y 按 2 的幂放大、缩小得到候选（每一维 2..256，保持长宽比），
+ * 从最粗的开始，取第一个最大误差不超过 max_error 的；都超过时取最细的。
+ * 网格写进 mesh，max_out/rms_out 为它的误差 */
+void undistort_mesh_build_adaptive(UndistortMesh *mesh, const cv::Mat &mapx, const cv::Mat &mapy,
+                                   int base_x, int base_y, double max_error, double *max_out, double *rms_out);
+
+/* 每个线程处理一行所需的临时缓冲区大小（字节） */
+size_t undistort_mesh_row_buffer_size(const UndistortMesh *mesh);
+
+/* 把第 y 行展开成与 fixed 表同格式的定点坐标（xy 为 2*width 个 int16，fxy 为 width 个 uint16），
+ * 写在 row_buf 里；格式转换等需要逐行取坐标的路径使用 */
+void undistort_mesh_fixed_row(const UndistortMesh *mesh, int y, void *row_buf,
+                              const int16_t **xy, const uint16_t **fxy);
+
+/* 处理输出的 [y0, y1) 行；row_buf 至少 undistort_mesh_row_buffer_size 字节且只被当前线程使用 */
+void undistort_mesh_remap_rows(const UndistortMesh *mesh, UndistortRemapRowFunc func,
+                               const UndistortSrcPlane *src, uint8_t *dst, size_t dst_stride,
+                               int y0, int y1, void *row_buf);
+
+#endif /* __GST_UNDISTORT_MESH_H__ */
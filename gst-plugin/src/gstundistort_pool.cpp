@@ -0,0 +1,87 @@
+/* undistort 元素的工作线程池实现，见 gstundistort_pool.h */
+
+#include "gstundistort_pool.h"
+
+unsigned
+UndistortWorkerPool::resolve_threads(unsigned n_threads) {
+    if (n_threads > 0)
+        return n_threads;
+    unsigned n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+UndistortWorkerPool::UndistortWorkerPool(unsigned n_threads)
+    : n_threads_(resolve_threads(n_threads)) {
+    workers_.reserve(n_threads_ - 1);
+    for (unsigned i = 1; i < n_threads_; ++i)
+        workers_.emplace_back(&UndistortWorkerPool::worker_main, this, i);
+}
+
+UndistortWorkerPool::~UndistortWorkerPool() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        quit_ = true;
+    }
+    wake_cond_.notify_all();
+    for (auto &t: workers_)
+        t.join();
+}
+
+/* 抢任务直到本批次耗尽；任务编号决定条带位置，输出与线程调度无关 */
+void
+UndistortWorkerPool::drain(unsigned worker) {
+    for (;;) {
+        unsigned task = next_task_.fetch_add(1, std::memory_order_relaxed);
+        if (task >= n_tasks_)
+            break;
+        func_(user_data_, task, worker);
+    }
+}
+
+void
+UndistortWorkerPool::worker_main(unsigned worker) {
+    unsigned long seen = 0;
+    std::unique_lock<std::mutex> guard(lock_);
+    for (;;) {
+        wake_cond_.wait(guard, [&] { return quit_ || generation_ != seen; });
+        if (quit_)
+            return;
+        seen = generation_;
+        guard.unlock();
+
+        drain(worker);
+
+        guard.lock();
+        if (--busy_ == 0)
+            done_cond_.notify_one();
+    }
+}
+
+void
+UndistortWorkerPool::run(unsigned n_tasks, UndistortTaskFunc func, void *user_data) {
+    if (n_tasks == 0)
+        return;
+
+    /* 单线程或只有一个任务时不唤醒 worker */
+    if (workers_.empty() || n_tasks == 1) {
+        for (unsigned task = 0; task < n_tasks; ++task)
+            func(user_data, task, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        func_ = func;
+        user_data_ = user_data;
+        n_tasks_ = n_tasks;
+        next_task_.store(0, std::memory_order_relaxed);
+        busy_ = (unsigned) workers_.size();
+        ++generation_;
+    }
+    wake_cond_.notify_all();
+
+    drain(0);
+
+    std::unique_lock<std::mutex> guard(lock_);
+    done_cond_.wait(guard, [&] { return busy_ == 0; });
+}
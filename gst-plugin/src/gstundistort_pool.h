@@ -0,0 +1,53 @@
+#ifndef __GST_UNDISTORT_POOL_H__
+#define __GST_UNDISTORT_POOL_H__
+
+/* undistort 元素自带的工作线程池：把一帧切成若干任务（水平条带），
+ * 由调用线程和 n-1 个常驻 worker 一起执行，run() 返回时所有任务都已完成。
+ * 不依赖 GStreamer，基准程序也可以直接使用。 */
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef void (*UndistortTaskFunc)(void *user_data, unsigned task, unsigned worker);
+
+class UndistortWorkerPool {
+public:
+    /* n_threads 为参与计算的线程总数（含调用线程），0 表示按 CPU 核数自动选择 */
+    explicit UndistortWorkerPool(unsigned n_threads);
+    ~UndistortWorkerPool();
+
+    UndistortWorkerPool(const UndistortWorkerPool &) = delete;
+    UndistortWorkerPool &operator=(const UndistortWorkerPool &) = delete;
+
+    unsigned size() const { return n_threads_; }
+
+    /* 执行 task = 0..n_tasks-1，阻塞到全部完成；worker 编号 0 为调用线程 */
+    void run(unsigned n_tasks, UndistortTaskFunc func, void *user_data);
+
+    static unsigned resolve_threads(unsigned n_threads);
+
+private:
+    void worker_main(unsigned worker);
+    void drain(unsigned worker);
+
+    unsigned n_threads_;
+    std::vector<std::thread> workers_;
+
+    std::mutex lock_;
+    std::condition_variable wake_cond_;
+    std::condition_variable done_cond_;
+    unsigned long generation_ = 0;
+    unsigned busy_ = 0;
+    bool quit_ = false;
+
+    /* 当前批次，只在 lock_ 保护下发布 */
+    UndistortTaskFunc func_ = nullptr;
+    void *user_data_ = nullptr;
+    unsigned n_tasks_ = 0;
+    std::atomic<unsigned> next_task_{0};
+};
+
+#endif /* __GST_UNDISTORT_POOL_H__ */
@@ -0,0 +1,61 @@
+/* 处理统计，见 gstundistort_stats.h */
+
+#include "gstundistort_stats.h"
+
+static unsigned
+bucket_of(uint64_t us) {
+    unsigned b = 0;
+    while (us > 1 && b < UNDISTORT_STATS_BUCKETS - 1) {
+        us >>= 1;
+        ++b;
+    }
+    return b;
+}
+
+void
+undistort_timer_reset(UndistortTimerStats *timer) {
+    timer->count.store(0, std::memory_order_relaxed);
+    timer->total_us.store(0, std::memory_order_relaxed);
+    timer->max_us.store(0, std::memory_order_relaxed);
+    for (auto &h: timer->hist)
+        h.store(0, std::memory_order_relaxed);
+}
+
+void
+undistort_timer_record(UndistortTimerStats *timer, uint64_t us) {
+    timer->count.fetch_add(1, std::memory_order_relaxed);
+    timer->total_us.fetch_add(us, std::memory_order_relaxed);
+    timer->hist[bucket_of(us)].fetch_add(1, std::memory_order_relaxed);
+    /* 表可能在流线程与后台重建线程上同时生成，最大值用 CAS 更新 */
+    uint64_t max = timer->max_us.load(std::memory_order_relaxed);
+    while (us > max && !timer->max_us.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+}
+
+void
+undistort_timer_snapshot(const UndistortTimerStats *timer, UndistortTimerSnapshot *snapshot) {
+    snapshot->count = timer->count.load(std::memory_order_relaxed);
+    snapshot->total_us = timer->total_us.load(std::memory_order_relaxed);
+    snapshot->max_us = timer->max_us.load(std::memory_order_relaxed);
+    for (unsigned b = 0; b < UNDISTORT_STATS_BUCKETS; ++b)
+        snapshot->hist[b] = timer->hist[b].load(std::memory_order_relaxed);
+}
+
+uint64_t
+undistort_timer_percentile(const UndistortTimerSnapshot *snapshot, double q) {
+    uint64_t total = 0;
+    for (uint64_t h: snapshot->hist)
+        total += h;
+    if (total == 0)
+        return 0;
+
+    /* 至少覆盖 q * total 次记录的最小桶 */
+    const double target = q * (double) total;
+    uint64_t seen = 0;
+    for (unsigned b = 0; b < UNDISTORT_STATS_BUCKETS; ++b) {
+        seen += snapshot->hist[b];
+        if ((double) seen >= target && snapshot->hist[b] > 0)
+            return b == UNDISTORT_STATS_BUCKETS - 1 ? snapshot->max_us : (uint64_t) 2 << b;
+    }
+    return snapshot->max_us;
+}
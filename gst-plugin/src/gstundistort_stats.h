@@ -0,0 +1,38 @@
+#ifndef __GST_UNDISTORT_STATS_H__
+#define __GST_UNDISTORT_STATS_H__
+
+/* undistort 元素的处理统计：每类耗时一个计时器（次数、总和、最大值与按 2 的幂分桶的直方图）。
+ * 只用 relaxed 原子操作，记录一次是几次加法，可以一直开着；任何线程都可以随时取快照。
+ * 不依赖 GStreamer。 */
+
+#include <atomic>
+#include <cstdint>
+
+/* 桶 i 统计耗时在 [2^i, 2^(i+1)) 微秒内的次数（桶 0 含 0 微秒），最后一个桶收下所有更长的 */
+#define UNDISTORT_STATS_BUCKETS 24
+
+typedef struct {
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> total_us;
+    std::atomic<uint64_t> max_us;
+    std::atomic<uint64_t> hist[UNDISTORT_STATS_BUCKETS];
+} UndistortTimerStats;
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_us;
+    uint64_t max_us;
+    uint64_t hist[UNDISTORT_STATS_BUCKETS];
+} UndistortTimerSnapshot;
+
+void undistort_timer_reset(UndistortTimerStats *timer);
+
+void undistort_timer_record(UndistortTimerStats *timer, uint64_t us);
+
+/* 各字段分别读取，与并发的记录之间不保证是同一时刻的值（统计用途足够） */
+void undistort_timer_snapshot(const UndistortTimerStats *timer, UndistortTimerSnapshot *snapshot);
+
+/* 由直方图估计分位数 q（0..1），返回所在桶的上界（微秒）；没有记录时返回 0 */
+uint64_t undistort_timer_percentile(const UndistortTimerSnapshot *snapshot, double q);
+
+#endif /* __GST_UNDISTORT_STATS_H__ */
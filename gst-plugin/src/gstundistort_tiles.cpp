@@ -0,0 +1,198 @@
+/* fixed 表的块遍历，见 gstundistort_tiles.h */
+
+#include "gstundistort_tiles.h"
+
+#include <algorithm>
+#include <climits>
+#include <unistd.h>
+
+#define UNDISTORT_CELL_W 16
+#define UNDISTORT_CELL_H 8
+#define UNDISTORT_CACHE_LINE 64
+
+size_t
+undistort_tiles_l2_size(void) {
+    static const size_t size = [] {
+        long v = -1;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+        v = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        return v > 0 ? (size_t) v : (size_t) 256 * 1024;
+    }();
+    return size;
+}
+
+/* 源包围盒（未裁剪，右/下边界为开区间，已含双线性的 +1 邻点） */
+typedef struct {
+    int x0, y0, x1, y1;
+} UndistortBox;
+
+static inline void
+box_union(UndistortBox *a, const UndistortBox *b) {
+    a->x0 = std::min(a->x0, b->x0);
+    a->y0 = std::min(a->y0, b->y0);
+    a->x1 = std::max(a->x1, b->x1);
+    a->y1 = std::max(a->y1, b->y1);
+}
+
+static inline void
+box_clip(UndistortBox *box, int src_width, int src_height) {
+    box->x0 = std::max(box->x0, 0);
+    box->y0 = std::max(box->y0, 0);
+    box->x1 = std::min(box->x1, src_width);
+    box->y1 = std::min(box->y1, src_height);
+}
+
+/* 包围盒占用的缓存行总字节数 */
+static inline size_t
+box_working_set(const UndistortBox *box, int bytes_per_pixel) {
+    if (box->x1 <= box->x0 || box->y1 <= box->y0)
+        return 0;
+    const size_t first = (size_t) box->x0 * bytes_per_pixel / UNDISTORT_CACHE_LINE;
+    const size_t last = ((size_t) box->x1 * bytes_per_pixel - 1) / UNDISTORT_CACHE_LINE;
+    return (size_t) (box->y1 - box->y0) * (last - first + 1) * UNDISTORT_CACHE_LINE;
+}
+
+/* tile_w x tile_h（均为小格尺寸的整数倍）的块 (tx, ty) 由哪些小格合并而成 */
+static UndistortBox
+tile_box(const std::vector<UndistortBox> &cells, int ncx, int ncy, int tile_w, int tile_h, int tx, int ty) {
+    const int cx0 = tx * tile_w / UNDISTORT_CELL_W;
+    const int cy0 = ty * tile_h / UNDISTORT_CELL_H;
+    const int cx1 = std::min(ncx, cx0 + tile_w / UNDISTORT_CELL_W);
+    const int cy1 = std::min(ncy, cy0 + tile_h / UNDISTORT_CELL_H);
+    UndistortBox box = {INT_MAX, INT_MAX, INT_MIN, INT_MIN};
+    for (int cy = cy0; cy < cy1; ++cy) {
+        for (int cx = cx0; cx < cx1; ++cx)
+            box_union(&box, &cells[(size_t) cy * ncx + cx]);
+    }
+    return box;
+}
+
+/* 给定块尺寸下所有块中最大的源工作集 */
+static size_t
+max_working_set(const std::vector<UndistortBox> &cells, int ncx, int ncy, int width, int height,
+                int src_width, int src_height, int bytes_per_pixel, int tile_w, int tile_h) {
+    const int cols = (width + tile_w - 1) / tile_w;
+    const int rows = (height + tile_h - 1) / tile_h;
+    size_t worst = 0;
+    for (int ty = 0; ty < rows; ++ty) {
+        for (int tx = 0; tx < cols; ++tx) {
+            UndistortBox box = tile_box(cells, ncx, ncy, tile_w, tile_h, tx, ty);
+            box_clip(&box, src_width, src_height);
+            worst = std::max(worst, box_working_set(&box, bytes_per_pixel));
+        }
+    }
+    return worst;
+}
+
+void
+undistort_tiles_build(UndistortTileGrid *grid, const int16_t *xy, size_t xy_stride, int width, int height,
+                      int src_width, int src_height, int bytes_per_pixel, size_t budget,
+                      int tile_w, int tile_h) {
+    const int ncx = (width + UNDISTORT_CELL_W - 1) / UNDISTORT_CELL_W;
+    const int ncy = (height + UNDISTORT_CELL_H - 1) / UNDISTORT_CELL_H;
+
+    /* 每个小格的源包围盒 */
+    std::vector<UndistortBox> cells((size_t) ncx * ncy, UndistortBox{INT_MAX, INT_MAX, INT_MIN, INT_MIN});
+    for (int y = 0; y < height; ++y) {
+        const int16_t *row = xy + (size_t) y * xy_stride;
+        UndistortBox *cell_row = &cells[(size_t) (y / UNDISTORT_CELL_H) * ncx];
+        for (int x = 0; x < width; ++x) {
+            UndistortBox *cell = &cell_row[x / UNDISTORT_CELL_W];
+            const int sx = row[2 * x];
+            const int sy = row[2 * x + 1];
+            cell->x0 = std::min(cell->x0, sx);
+            cell->y0 = std::min(cell->y0, sy);
+            cell->x1 = std::max(cell->x1, sx + 2);
+            cell->y1 = std::max(cell->y1, sy + 2);
+        }
+    }
+
+    /* 先试整行宽的块（即按行遍历，只多了预取）：表与 dst 保持长的顺序流，硬件预取最有效；
+     * 放不下时再从大到小尝试，取第一个满足预算的，同面积时宽的优先（行内连续） */
+    if (tile_w <= 0 || tile_h <= 0) {
+        const int full = ncx * UNDISTORT_CELL_W;
+        const int sizes[][2] = {
+            {full, 32}, {full, 16}, {full, 8},
+            {512, 64}, {512, 32}, {256, 64}, {512, 16}, {256, 32}, {128, 64},
+            {256, 16}, {128, 32}, {64, 64}, {128, 16}, {64, 32}, {64, 16}, {32, 16}, {32, 8},
+        };
+        tile_w = 32;
+        tile_h = 8;
+        for (const auto &s: sizes) {
+            if (max_working_set(cells, ncx, ncy, width, height, src_width, src_height, bytes_per_pixel,
+                                s[0], s[1]) <= budget) {
+                tile_w = s[0];
+                tile_h = s[1];
+                break;
+            }
+        }
+    }
+    tile_w = std::max(UNDISTORT_CELL_W, tile_w / UNDISTORT_CELL_W * UNDISTORT_CELL_W);
+    tile_h = std::max(UNDISTORT_CELL_H, tile_h / UNDISTORT_CELL_H * UNDISTORT_CELL_H);
+
+    grid->tile_w = tile_w;
+    grid->tile_h = tile_h;
+    grid->cols = (width + tile_w - 1) / tile_w;
+    grid->rows = (height + tile_h - 1) / tile_h;
+    grid->max_working_set = 0;
+    grid->tiles.resize((size_t) grid->cols * grid->rows);
+
+    for (int ty = 0; ty < grid->rows; ++ty) {
+        for (int i = 0; i < grid->cols; ++i) {
+            const int tx = (ty & 1) ? grid->cols - 1 - i : i; // 蛇形
+            UndistortBox box = tile_box(cells, ncx, ncy, tile_w, tile_h, tx, ty);
+            box_clip(&box, src_width, src_height);
+            grid->max_working_set = std::max(grid->max_working_set, box_working_set(&box, bytes_per_pixel));
+
+            UndistortTile *tile = &grid->tiles[(size_t) ty * grid->cols + i];
+            tile->x0 = tx * tile_w;
+            tile->y0 = ty * tile_h;
+            tile->x1 = std::min(width, tile->x0 + tile_w);
+            tile->y1 = std::min(height, tile->y0 + tile_h);
+            tile->sx0 = box.x0;
+            tile->sy0 = box.y0;
+            tile->sx1 = std::max(box.x0, box.x1);
+            tile->sy1 = std::max(box.y0, box.y1);
+        }
+    }
+}
+
+/* 预取 next 源包围盒的第 [r0, r1) 行（相对 sy0） */
+static inline void
+prefetch_rows(const UndistortSrcPlane *src, const UndistortTile *next, int channels, int r0, int r1) {
+    const size_t begin = (size_t) next->sx0 * channels;
+    const size_t end = (size_t) next->sx1 * channels;
+    for (int r = r0; r < r1; ++r) {
+        const uint8_t *row = src->data + (size_t) (next->sy0 + r) * src->stride;
+        for (size_t off = begin & ~(size_t) (UNDISTORT_CACHE_LINE - 1); off < end; off += UNDISTORT_CACHE_LINE)
+            __builtin_prefetch(row + off, 0, 2);
+    }
+}
+
+void
+undistort_tiles_remap(const UndistortTileGrid *grid, UndistortRemapRowFunc func,
+                      const UndistortSrcPlane *src, int channels, uint8_t *dst, size_t dst_stride,
+                      const int16_t *xy, size_t xy_stride, const uint16_t *fxy, size_t fxy_stride,
+                      int row0, int row1) {
+    const size_t first = (size_t) row0 * grid->cols;
+    const size_t last = (size_t) row1 * grid->cols;
+
+    for (size_t i = first; i < last; ++i) {
+        const UndistortTile *tile = &grid->tiles[i];
+        const UndistortTile *next = i + 1 < last ? &grid->tiles[i + 1] : nullptr;
+        const int th = tile->y1 - tile->y0;
+        const int nh = next ? next->sy1 - next->sy0 : 0;
+        const int n = tile->x1 - tile->x0;
+
+        for (int k = 0; k < th; ++k) {
+            const int y = tile->y0 + k;
+            /* 把下一块的源行均匀摊到当前块的每一行输出上 */
+            if (nh > 0)
+                prefetch_rows(src, next, channels, nh * k / th, nh * (k + 1) / th);
+            func(src, dst + (size_t) y * dst_stride + (size_t) tile->x0 * channels,
+                 xy + (size_t) y * xy_stride + 2 * (size_t) tile->x0,
+                 fxy + (size_t) y * fxy_stride + tile->x0, n);
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef __GST_UNDISTORT_TILES_H__
+#define __GST_UNDISTORT_TILES_H__
+
+/* fixed 表按输出块（tile）遍历，不依赖 GStreamer / OpenCV。
+ *
+ * 按行遍历时，一行输出在强桶形畸变的边缘会跨几十行源像素；整行宽度乘以这个跨度
+ * 在 4K 下远超 L2，相邻输出行之间的源数据被挤出缓存。改为按块遍历：
+ *  - 协商时按 16x8 的小格统计每格的源包围盒，再选出最大的、所有块的源工作集
+ *    都不超过 L2 预算的块尺寸（预算按 L2 的一半，另一半留给下一块的预取与 dst/表）；
+ *    整行宽的块放得下时优先使用（畸变弱或单通道时按行遍历本身就不缺缓存）
+ *  - 块按“块行”切条带，块行内蛇形排列（偶数行从左到右，奇数行从右到左），
+ *    相邻块的源包围盒重叠，换行时也不丢掉刚读过的源数据
+ *  - 处理当前块的第 k 行输出时预取下一块源包围盒中对应的 1/tile_h 行
+ * 每个输出像素仍由同一个内核、同一组表项算出，输出与按行遍历逐位一致。 */
+
+#include "gstundistort_kernels.h"
+
+#include <vector>
+
+/* 一个块：输出矩形 [x0, x1) x [y0, y1)，源包围盒 [sx0, sx1) x [sy0, sy1)（已裁到源图内，可为空） */
+typedef struct {
+    int x0, y0, x1, y1;
+    int sx0, sy0, sx1, sy1;
+} UndistortTile;
+
+typedef struct {
+    std::vector<UndistortTile> tiles; // 按遍历顺序，块行 r 占 [r * cols, (r + 1) * cols)
+    int tile_w, tile_h;
+    int cols, rows;
+    size_t max_working_set; // 所有块中最大的源工作集（字节，按 64 字节缓存行计）
+} UndistortTileGrid;
+
+/* L2 大小（字节，结果缓存）；读不到时按 256 KiB */
+size_t undistort_tiles_l2_size(void);
+
+/* 由 fixed 表的整数坐标（CV_16SC2，xy_stride 以 int16 个数计）生成块网格；
+ * bytes_per_pixel 为一个源像素在所有用这张表的平面里的总字节数，budget 为单块源工作集上限（字节）。
+ * tile_w/tile_h 非 0 时不自动选择，直接使用给定尺寸 */
+void undistort_tiles_build(UndistortTileGrid *grid, const int16_t *xy, size_t xy_stride, int width, int height,
+                           int src_width, int src_height, int bytes_per_pixel, size_t budget,
+                           int tile_w, int tile_h);
+
+/* 按块处理块行 [row0, row1)；channels 为 dst 每像素字节数，其余参数同 undistort_remap_rows */
+void undistort_tiles_remap(const UndistortTileGrid *grid, UndistortRemapRowFunc func,
+                           const UndistortSrcPlane *src, int channels, uint8_t *dst, size_t dst_stride,
+                           const int16_t *xy, size_t xy_stride, const uint16_t *fxy, size_t fxy_stride,
+                           int row0, int row1);
+
+#endif /* __GST_UNDISTORT_TILES_H__ */
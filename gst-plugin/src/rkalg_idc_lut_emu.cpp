@@ -0,0 +1,141 @@
+/* Rockchip IDC LUT 接口的 CPU 实现，见 rkalg_idc_lut_emu.h */
+
+#include "rkalg_idc_lut_emu.h"
+
+#include "gstundistort_kernels.h"
+#include "gstundistort_mesh.h"
+
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+
+typedef struct {
+    RKALG_LUT_INIT_PARAMS_S params;
+    UndistortRemapRowFunc luma_func, chroma_func;
+    UndistortMesh luma, chroma; // 最近一次任务的网格（拷贝）与由它推导的色度网格
+    std::vector<uint8_t> row_buf;
+} IdcEmu;
+
+/* NV12 的两个平面；没给 UV 地址时按 Y 平面的 stride x 高度紧随其后 */
+static void
+emu_planes(const RKALG_IDC_IMAGE_S *img, uint8_t **y, size_t *y_stride, uint8_t **uv, size_t *uv_stride) {
+    *y = (uint8_t *) img->virAddr[0];
+    *y_stride = img->u32Stride[0];
+    const uint32_t hgt = img->u32HgtStride[0] ? img->u32HgtStride[0] : img->u32Height;
+    *uv = img->virAddr[1] ? (uint8_t *) img->virAddr[1] : *y + *y_stride * hgt;
+    *uv_stride = img->u32Stride[1] ? img->u32Stride[1] : *y_stride;
+}
+
+/* 网格与上一次任务不同（尺寸或内容）时重新拷贝，并推导色度网格：
+ * 色度网格点与亮度网格点重合（步长减半），色度像素中心在亮度坐标下比网格点偏半个像素，
+ * 按局部近似平移处理后源色度坐标正好是源亮度坐标的一半 */
+static void
+emu_update_mesh(IdcEmu *emu, const RKALG_IDC_MESH_S *desc) {
+    const int mesh_w = (int) desc->u32Width, mesh_h = (int) desc->u32Height;
+    const float *xy = (const float *) desc->virAddr[0];
+    const size_t row = (size_t) mesh_w * 2;
+    UndistortMesh *luma = &emu->luma;
+
+    bool same = luma->mesh_w == mesh_w && luma->mesh_h == mesh_h && luma->step_x == (int) desc->u32StepX &&
+                luma->step_y == (int) desc->u32StepY;
+    for (int y = 0; same && y < mesh_h; ++y)
+        same = !memcmp(&luma->xy[y * row], xy + (size_t) y * desc->u32Stride * 2, row * sizeof(float));
+    if (same)
+        return;
+
+    luma->mesh_w = mesh_w;
+    luma->mesh_h = mesh_h;
+    luma->step_x = (int) desc->u32StepX;
+    luma->step_y = (int) desc->u32StepY;
+    luma->width = (int) emu->params.u32DstWidth;
+    luma->height = (int) emu->params.u32DstHeight;
+    luma->xy.resize(row * mesh_h);
+    for (int y = 0; y < mesh_h; ++y)
+        memcpy(&luma->xy[y * row], xy + (size_t) y * desc->u32Stride * 2, row * sizeof(float));
+
+    UndistortMesh *chroma = &emu->chroma;
+    chroma->width = (luma->width + 1) / 2;
+    chroma->height = (luma->height + 1) / 2;
+    chroma->step_x = luma->step_x / 2;
+    chroma->step_y = luma->step_y / 2;
+    chroma->mesh_w = (chroma->width - 1) / chroma->step_x + 2;
+    chroma->mesh_h = (chroma->height - 1) / chroma->step_y + 2;
+    chroma->xy.resize((size_t) chroma->mesh_w * chroma->mesh_h * 2);
+    for (int gy = 0; gy < chroma->mesh_h; ++gy) {
+        const float *in = &luma->xy[gy * row];
+        float *out = &chroma->xy[(size_t) gy * chroma->mesh_w * 2];
+        for (int i = 0; i < chroma->mesh_w * 2; ++i)
+            out[i] = in[i] * 0.5f;
+    }
+
+    emu->row_buf.resize(std::max(undistort_mesh_row_buffer_size(luma), undistort_mesh_row_buffer_size(chroma)));
+}
+
+int
+RKALG_IDC_LUT_Init(RKALG_LUT_CTX_S *ctx, RKALG_LUT_INIT_PARAMS_S *params) {
+    if (!ctx || !params || params->u32SrcWidth == 0 || params->u32SrcHeight == 0 || params->u32DstWidth == 0 ||
+        params->u32DstHeight == 0 || params->u32SrcStride < params->u32SrcWidth ||
+        params->u32DstStride < params->u32DstWidth)
+        return RKALG_IDC_EMU_ERR_PARAM;
+
+    auto *emu = new (std::nothrow) IdcEmu();
+    if (!emu)
+        return RKALG_IDC_EMU_ERR_NOMEM;
+    emu->params = *params;
+    const UndistortIsa isa = undistort_kernels_detect_isa();
+    emu->luma_func = undistort_kernels_get(1, isa);
+    emu->chroma_func = undistort_kernels_get(2, isa);
+    ctx->priv = emu;
+    return 0;
+}
+
+int
+RKALG_IDC_LUT_DoLut(RKALG_LUT_CTX_S *ctx, RKALG_LUT_TASK_S *task) {
+    if (!ctx || !ctx->priv || !task || !task->pSrcImage || !task->pDstImage || !task->pMesh)
+        return RKALG_IDC_EMU_ERR_PARAM;
+    auto *emu = (IdcEmu *) ctx->priv;
+    const RKALG_LUT_INIT_PARAMS_S *params = &emu->params;
+    const RKALG_IDC_IMAGE_S *src = task->pSrcImage;
+    const RKALG_IDC_IMAGE_S *dst = task->pDstImage;
+    const RKALG_IDC_MESH_S *mesh = task->pMesh;
+
+    /* 只支持 NV12 与 merged 网格；尺寸须与初始化时一致，网格须覆盖输出（右/下外推一格） */
+    if (src->eImgFmt != RKALG_IDC_IMG_FMT_NV12 || dst->eImgFmt != RKALG_IDC_IMG_FMT_NV12 ||
+        mesh->eMeshType != RKALG_IDC_MESH_TYPE_MERGED || !src->virAddr[0] || !dst->virAddr[0] ||
+        !mesh->virAddr[0])
+        return RKALG_IDC_EMU_ERR_PARAM;
+    if (src->u32Width != params->u32SrcWidth || src->u32Height != params->u32SrcHeight ||
+        dst->u32Width != params->u32DstWidth || dst->u32Height != params->u32DstHeight ||
+        src->u32Stride[0] < src->u32Width || dst->u32Stride[0] < dst->u32Width)
+        return RKALG_IDC_EMU_ERR_PARAM;
+    if (mesh->u32StepX < 2 || mesh->u32StepY < 2 || mesh->u32StepX % 2 || mesh->u32StepY % 2 ||
+        mesh->u32Width != (dst->u32Width - 1) / mesh->u32StepX + 2 ||
+        mesh->u32Height != (dst->u32Height - 1) / mesh->u32StepY + 2 || mesh->u32Stride < mesh->u32Width)
+        return RKALG_IDC_EMU_ERR_PARAM;
+
+    emu_update_mesh(emu, mesh);
+
+    uint8_t *src_y, *src_uv, *dst_y, *dst_uv;
+    size_t src_y_stride, src_uv_stride, dst_y_stride, dst_uv_stride;
+    emu_planes(src, &src_y, &src_y_stride, &src_uv, &src_uv_stride);
+    emu_planes(dst, &dst_y, &dst_y_stride, &dst_uv, &dst_uv_stride);
+
+    const int w = (int) src->u32Width, h = (int) src->u32Height;
+    const UndistortSrcPlane luma = {src_y, src_y_stride, w, h};
+    const UndistortSrcPlane chroma = {src_uv, src_uv_stride, (w + 1) / 2, (h + 1) / 2};
+    undistort_mesh_remap_rows(&emu->luma, emu->luma_func, &luma, dst_y, dst_y_stride, 0, emu->luma.height,
+                              emu->row_buf.data());
+    undistort_mesh_remap_rows(&emu->chroma, emu->chroma_func, &chroma, dst_uv, dst_uv_stride, 0,
+                              emu->chroma.height, emu->row_buf.data());
+    return 0;
+}
+
+int
+RKALG_IDC_LUT_Deinit(RKALG_LUT_CTX_S *ctx) {
+    if (!ctx)
+        return RKALG_IDC_EMU_ERR_PARAM;
+    delete (IdcEmu *) ctx->priv;
+    ctx->priv = NULL;
+    return 0;
+}
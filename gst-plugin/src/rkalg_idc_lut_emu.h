@@ -0,0 +1,84 @@
+#ifndef __RKALG_IDC_LUT_EMU_H__
+#define __RKALG_IDC_LUT_EMU_H__
+
+/* Rockchip IDC LUT 接口（rkalg_idc_lut_api.h / librkalg_idc）的 CPU 实现。
+ * 结构体与函数名和厂商接口相同，gstundistort_idc.cpp 不用改动；没有厂商库时由 meson 选用
+ * （config.h 定义 HAVE_IDC_EMU），x86 上也能编译、运行与测量 idc 后端。
+ *
+ * 只实现 undistort 用到的部分：NV12 输入/输出、merged meshXY（x,y 交错的 float，
+ * 格式同 UndistortMesh），默认模式。亮度直接按网格 remap，色度网格由亮度网格推导
+ * （同一组网格点，步长减半、坐标减半）。插值用 gstundistort_kernels 的定点双线性内核
+ * （SSE4.1/AVX2/AVX-512），逐行展开网格，单线程处理整帧（与硬件一样一次一帧）。
+ * 输出与硬件不保证逐位一致。 */
+
+#include <cstdint>
+
+/* 返回值：0 成功，负数失败 */
+#define RKALG_IDC_EMU_ERR_PARAM (-1)
+#define RKALG_IDC_EMU_ERR_NOMEM (-2)
+
+typedef struct {
+    void *priv; // RKALG_IDC_LUT_Init 分配，RKALG_IDC_LUT_Deinit 释放
+} RKALG_LUT_CTX_S;
+
+typedef enum {
+    RKALG_IDC_LUT_DEFAULT_MODE,
+} RKALG_IDC_LUT_MODE_E;
+
+typedef struct {
+    uint32_t u32SrcWidth;
+    uint32_t u32SrcHeight;
+    uint32_t u32SrcStride;
+    uint32_t u32SrcHgtStride;
+    uint32_t u32DstWidth;
+    uint32_t u32DstHeight;
+    uint32_t u32DstStride;
+    uint32_t u32DstHgtStride;
+    RKALG_IDC_LUT_MODE_E eMode;
+} RKALG_LUT_INIT_PARAMS_S;
+
+typedef enum {
+    RKALG_IDC_IMG_FMT_NV12,
+} RKALG_IDC_IMG_FMT_E;
+
+/* virAddr[1] 为 NULL 时 UV 平面紧跟在 Y 平面（u32Stride[0] x u32HgtStride[0]）之后；
+ * u32Stride[1] 为 0 时与 Y 同 stride */
+typedef struct {
+    RKALG_IDC_IMG_FMT_E eImgFmt;
+    uint32_t u32Width;
+    uint32_t u32Height;
+    uint32_t u32Stride[3];
+    uint32_t u32HgtStride[3];
+    void *virAddr[3];
+} RKALG_IDC_IMAGE_S;
+
+typedef enum {
+    RKALG_IDC_MESH_TYPE_MERGED,
+} RKALG_IDC_MESH_TYPE_E;
+
+/* u32Width x u32Height 个网格点，u32Stride 为一行的网格点数 */
+typedef struct {
+    uint32_t u32StepX;
+    uint32_t u32StepY;
+    uint32_t u32Width;
+    uint32_t u32Height;
+    uint32_t u32Stride;
+    uint32_t u32HgtStride;
+    RKALG_IDC_MESH_TYPE_E eMeshType;
+    void *virAddr[2];
+} RKALG_IDC_MESH_S;
+
+typedef struct {
+    RKALG_IDC_IMAGE_S *pSrcImage;
+    RKALG_IDC_IMAGE_S *pDstImage;
+    RKALG_IDC_MESH_S *pMesh;
+    void *pOpAttr; // 忽略
+} RKALG_LUT_TASK_S;
+
+int RKALG_IDC_LUT_Init(RKALG_LUT_CTX_S *ctx, RKALG_LUT_INIT_PARAMS_S *params);
+
+int RKALG_IDC_LUT_DoLut(RKALG_LUT_CTX_S *ctx, RKALG_LUT_TASK_S *task);
+
+int RKALG_IDC_LUT_Deinit(RKALG_LUT_CTX_S *ctx);
+
+#endif /* __RKALG_IDC_LUT_EMU_H__ */
@@ -0,0 +1,237 @@
+/* undistort 的吞吐回归测试：videotestsrc num-buffers=N ! caps ! undistort ! fakesink sync=false，
+ * 按 fakesink 第一个与最后一个 buffer 之间的时间计算 fps（不含协商与建表），
+ * 与基线文件中同一组合的 fps 比较，低于基线超过容差时失败。
+ *
+ * 基线文件每行：size format backend map-format fps（# 开头为注释），每行是一个测试用例；
+ * 另有一行 host <机器标识>（CPU 型号与核数），是记录这些 fps 的机器。fps 只在同一台机器上有意义：
+ * 基线不是在本机记录的（或 fps 还是 -，从未记录）时不比较，整个测试返回 77，meson 记为 SKIP，
+ * 既不会因为 CI 机器慢而失败，也不会因为机器快而放过明显的退化。
+ * 环境变量（meson test 会设置前两个）：
+ *  UNDISTORT_FPS_BASELINE   基线文件路径
+ *  UNDISTORT_FPS_TOLERANCE  容差（百分比，默认 20）
+ *  UNDISTORT_FPS_RECORD     非空时不比较，把实测值与本机标识写回基线文件（在参考机器上记录基线） */
+
+#include <gst/check/gstcheck.h>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#define TEST_N_BUFFERS 120
+
+typedef struct {
+    std::string size, format, backend, map_format;
+    double fps;
+} FpsCase;
+
+static std::vector<FpsCase> fps_cases;
+static std::string fps_baseline_host;
+
+static gboolean
+fps_size(const std::string &name, int *width, int *height) {
+    if (name == "720p") {
+        *width = 1280;
+        *height = 720;
+    } else if (name == "1080p") {
+        *width = 1920;
+        *height = 1080;
+    } else if (name == "4K") {
+        *width = 3840;
+        *height = 2160;
+    } else {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* 本机标识：/proc/cpuinfo 的 CPU 型号（空白换成 _）与逻辑核数 */
+static std::string
+fps_host(void) {
+    std::string model = "unknown";
+    gchar *cpuinfo = NULL;
+    if (g_file_get_contents("/proc/cpuinfo", &cpuinfo, NULL, NULL)) {
+        gchar **lines = g_strsplit(cpuinfo, "\n", -1);
+        for (gchar **line = lines; *line; ++line) {
+            const gchar *colon = strchr(*line, ':');
+            if (!g_str_has_prefix(*line, "model name") || !colon)
+                continue;
+            gchar *name = g_strstrip(g_strdup(colon + 1));
+            g_strdelimit(name, " \t", '_');
+            model = name;
+            g_free(name);
+            break;
+        }
+        g_strfreev(lines);
+        g_free(cpuinfo);
+    }
+    return model + "/" + std::to_string(g_get_num_processors()) + "cpu";
+}
+
+/* fps 为 - 时记为 NAN（未记录） */
+static void
+fps_load_baseline(std::vector<FpsCase> *cases, std::string *host) {
+    const gchar *path = g_getenv("UNDISTORT_FPS_BASELINE");
+    if (!path)
+        return;
+    FILE *f = fopen(path, "r");
+    if (!f)
+        return;
+    char line[256], size[32], format[32], backend[32], map_format[32], fps[32], name[200];
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#')
+            continue;
+        if (sscanf(line, "host %199s", name) == 1) {
+            *host = name;
+            continue;
+        }
+        if (sscanf(line, "%31s %31s %31s %31s %31s", size, format, backend, map_format, fps) != 5)
+            continue;
+        cases->push_back({size, format, backend, map_format, strcmp(fps, "-") ? g_ascii_strtod(fps, NULL) : NAN});
+    }
+    fclose(f);
+}
+
+/* 每个用例在 fork 出的子进程里运行，记录时重新读一遍文件，只改第 index 行的 fps */
+static void
+fps_record(guint index, double fps) {
+    std::vector<FpsCase> cases;
+    std::string host;
+    fps_load_baseline(&cases, &host);
+    fail_unless(index < cases.size());
+    /* 换了机器时其他用例的旧值作废 */
+    const std::string this_host = fps_host();
+    if (host != this_host) {
+        for (FpsCase &c: cases)
+            c.fps = NAN;
+    }
+    cases[index].fps = fps;
+
+    const gchar *path = g_getenv("UNDISTORT_FPS_BASELINE");
+    FILE *f = fopen(path, "w");
+    fail_unless(f != NULL, "cannot write %s", path);
+    fprintf(f, "# recorded with UNDISTORT_FPS_RECORD=1 meson test undistort-fps; only compared on the same host\n");
+    fprintf(f, "host %s\n", this_host.c_str());
+    fprintf(f, "# size format backend map-format fps (videotestsrc num-buffers=%d, fakesink sync=false)\n",
+            TEST_N_BUFFERS);
+    for (const FpsCase &c: cases) {
+        fprintf(f, "%s %s %s %s ", c.size.c_str(), c.format.c_str(), c.backend.c_str(), c.map_format.c_str());
+        if (std::isnan(c.fps))
+            fprintf(f, "-\n");
+        else
+            fprintf(f, "%.1f\n", c.fps);
+    }
+    fclose(f);
+}
+
+typedef struct {
+    guint n;
+    gint64 first, last;
+} FpsCounter;
+
+static void
+fps_handoff(GstElement *sink, GstBuffer *buf, GstPad *pad, gpointer user_data) {
+    auto *counter = (FpsCounter *) user_data;
+    const gint64 now = g_get_monotonic_time();
+    if (counter->n++ == 0)
+        counter->first = now;
+    counter->last = now;
+}
+
+/* 跑一遍管道，返回 fps */
+static double
+fps_run(const FpsCase *c) {
+    int width, height;
+    fail_unless(fps_size(c->size, &width, &height), "unknown size %s", c->size.c_str());
+    /* 标定取元素文档的例子（1280x720），按宽度缩放 */
+    const double s = width / 1280.0;
+    gchar *desc = g_strdup_printf("videotestsrc num-buffers=%d ! video/x-raw,format=%s,width=%d,height=%d,"
+                                  "framerate=30/1 ! undistort fx=%f fy=%f cx=%f cy=%f k1=-0.2 k2=0.1 "
+                                  "backend=%s map-format=%s ! fakesink name=sink sync=false signal-handoffs=true",
+                                  TEST_N_BUFFERS, c->format.c_str(), width, height, 800 * s, 800 * s, width / 2.0,
+                                  height / 2.0, c->backend.c_str(), c->map_format.c_str());
+    GError *error = NULL;
+    GstElement *pipeline = gst_parse_launch(desc, &error);
+    fail_unless(pipeline != NULL && error == NULL, "%s: %s", desc, error ? error->message : "?");
+    g_free(desc);
+
+    FpsCounter counter = {0, 0, 0};
+    GstElement *sink = gst_bin_get_by_name(GST_BIN(pipeline), "sink");
+    g_signal_connect(sink, "handoff", G_CALLBACK(fps_handoff), &counter);
+    gst_object_unref(sink);
+
+    fail_unless(gst_element_set_state(pipeline, GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+    GstBus *bus = gst_element_get_bus(pipeline);
+    GstMessage *msg = gst_bus_timed_pop_filtered(bus, GST_CLOCK_TIME_NONE,
+                                                 (GstMessageType) (GST_MESSAGE_EOS | GST_MESSAGE_ERROR));
+    fail_unless(GST_MESSAGE_TYPE(msg) == GST_MESSAGE_EOS, "pipeline error");
+    gst_message_unref(msg);
+    gst_object_unref(bus);
+    gst_element_set_state(pipeline, GST_STATE_NULL);
+    gst_object_unref(pipeline);
+
+    fail_unless(counter.n == TEST_N_BUFFERS, "%u of %d buffers reached the sink", counter.n, TEST_N_BUFFERS);
+    return (counter.n - 1) * 1e6 / (double) MAX(counter.last - counter.first, 1);
+}
+
+GST_START_TEST(test_fps)
+{
+    const FpsCase *c = &fps_cases[__i__];
+    const double fps = fps_run(c);
+    const gchar *tol_str = g_getenv("UNDISTORT_FPS_TOLERANCE");
+    const double tolerance = tol_str ? g_ascii_strtod(tol_str, NULL) : 20.0;
+
+    GST_INFO("%s %s backend=%s map-format=%s: %.1f fps (baseline %.1f)", c->size.c_str(), c->format.c_str(),
+             c->backend.c_str(), c->map_format.c_str(), fps, c->fps);
+    if (g_getenv("UNDISTORT_FPS_RECORD")) {
+        fps_record(__i__, fps);
+        return;
+    }
+    fail_unless(fps >= c->fps * (1.0 - tolerance / 100.0),
+                "%s %s backend=%s map-format=%s: %.1f fps, baseline %.1f (-%.1f%%, tolerance %.0f%%)",
+                c->size.c_str(), c->format.c_str(), c->backend.c_str(), c->map_format.c_str(), fps, c->fps,
+                100.0 * (1.0 - fps / c->fps), tolerance);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_baseline_present)
+{
+    fail_if(fps_cases.empty(), "no cases in UNDISTORT_FPS_BASELINE (%s)", g_getenv("UNDISTORT_FPS_BASELINE"));
+}
+GST_END_TEST;
+
+static Suite *
+undistort_fps_suite(void) {
+    Suite *s = suite_create("undistort-fps");
+    TCase *tc = tcase_create("fps");
+
+    tcase_set_timeout(tc, 300);
+    suite_add_tcase(s, tc);
+    tcase_add_test(tc, test_baseline_present);
+    tcase_add_loop_test(tc, test_fps, 0, (int) fps_cases.size());
+    return s;
+}
+
+/* 与 GST_CHECK_MAIN 相同，只是基线不属于本机时先返回 77（meson 的 SKIP） */
+int
+main(int argc, char **argv) {
+    gst_check_init(&argc, &argv);
+    fps_load_baseline(&fps_cases, &fps_baseline_host);
+    if (!g_getenv("UNDISTORT_FPS_RECORD")) {
+        const std::string host = fps_host();
+        gboolean recorded = TRUE;
+        for (const FpsCase &c: fps_cases)
+            recorded &= !std::isnan(c.fps);
+        /* 没有用例时照常运行，由 test_baseline_present 报错 */
+        if (!fps_cases.empty() && (fps_baseline_host != host || !recorded)) {
+            g_print("fps baseline %s was recorded on '%s'%s, this host is '%s': skipping. Record it here with "
+                    "UNDISTORT_FPS_RECORD=1 meson test undistort-fps\n", g_getenv("UNDISTORT_FPS_BASELINE"),
+                    fps_baseline_host.empty() ? "no host" : fps_baseline_host.c_str(),
+                    recorded ? "" : " (incomplete)", host.c_str());
+            return 77;
+        }
+    }
+    return gst_check_run_suite(undistort_fps_suite(), "undistort_fps", __FILE__);
+}
@@ -0,0 +1,241 @@
+/* undistort 的像素回归测试：GstHarness 把仓库里的 distort.jpg 推过元素，
+ * 每个 backend x map-format 组合（BGR 与 NV12 两种格式）的输出与 OpenCV 参考比较。
+ *
+ * 标定是拍 distort.jpg / undistort.jpg 中屏幕画面的那台相机（1280x720，开发日志里的
+ * 推流命令：fx=619.97674 fy=625.27679 cx=586.32027 cy=339.90312 k1=-0.291149 k2=0.057760
+ * p1=-0.006811 p2=0.001601），按宽度缩放到 4032x3024，16:9 的画面在 4:3 里上下居中。
+ * undistort.jpg 是另外拍的一张照片，与 distort.jpg 的像素不对齐，只作为效果示意，不参与比较；
+ * 参考输出由测试自己用 cv::initUndistortRectifyMap（float32）+ cv::remap 生成，
+ * NV12 的色度表按元素文档的 2x2 平均推导（undistort_maps_derive_chroma）。
+ *
+ * 阈值按实际使用的表格式（后端选择与元素相同，见 gstundistort_backend.h）：
+ *  float32 / fixed : 最大误差 <= 1（fixed 量化到 1/32 像素，与 cv::remap 内部一致）
+ *  mesh            : PSNR >= 40 dB
+ *  nearest         : PSNR >= 30 dB
+ *
+ * 环境变量 UNDISTORT_TEST_IMAGE 为 distort.jpg 的路径（meson test 会设置）。 */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstundistort_backend.h"
+#include "gstundistort_maps.h"
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
+#include <opencv2/opencv.hpp>
+
+#include <cmath>
+#include <cstring>
+
+#define TEST_FX (619.97674 * 3.15)
+#define TEST_FY (625.27679 * 3.15)
+#define TEST_CX (586.32027 * 3.15)
+#define TEST_CY (339.90312 * 3.15 + (3024 - 720 * 3.15) / 2)
+#define TEST_K1 (-0.291149)
+#define TEST_K2 0.057760
+#define TEST_P1 (-0.006811)
+#define TEST_P2 0.001601
+#define TEST_K3 0.0
+
+static const char *const test_formats[] = {"BGR", "NV12"};
+static const char *const test_backends[] = {"opencv", "simd", "mesh", "idc"};
+static const char *const test_map_formats[] = {"float32", "fixed", "nearest", "mesh"};
+
+#define N_FORMATS G_N_ELEMENTS(test_formats)
+#define N_BACKENDS G_N_ELEMENTS(test_backends)
+#define N_MAP_FORMATS G_N_ELEMENTS(test_map_formats)
+
+/* 一种格式的输入与参考输出（每个平面一张 Mat），第一次用到时生成 */
+typedef struct {
+    cv::Mat in[2], ref[2];
+    int n_planes;
+} TestImage;
+
+static TestImage test_images[N_FORMATS];
+static cv::Mat test_bgr;
+
+static const cv::Mat &
+test_load_bgr(void) {
+    if (test_bgr.empty()) {
+        const gchar *path = g_getenv("UNDISTORT_TEST_IMAGE");
+        fail_unless(path != NULL, "UNDISTORT_TEST_IMAGE is not set");
+        test_bgr = cv::imread(path, cv::IMREAD_COLOR);
+        fail_if(test_bgr.empty(), "cannot read %s", path);
+        fail_unless(test_bgr.cols == 4032 && test_bgr.rows == 3024, "%s is %dx%d, expected 4032x3024", path,
+                    test_bgr.cols, test_bgr.rows);
+    }
+    return test_bgr;
+}
+
+static const TestImage *
+test_image(guint format) {
+    TestImage *img = &test_images[format];
+    if (img->n_planes > 0)
+        return img;
+
+    const cv::Mat &bgr = test_load_bgr();
+    const cv::Size size = bgr.size();
+    const cv::Mat K = (cv::Mat_<double>(3, 3) << TEST_FX, 0, TEST_CX, 0, TEST_FY, TEST_CY, 0, 0, 1);
+    const cv::Mat D = (cv::Mat_<double>(1, 5) << TEST_K1, TEST_K2, TEST_P1, TEST_P2, TEST_K3);
+    cv::Mat mapx, mapy;
+    cv::initUndistortRectifyMap(K, D, cv::Mat(), K, size, CV_32FC1, mapx, mapy);
+
+    if (!strcmp(test_formats[format], "BGR")) {
+        img->n_planes = 1;
+        img->in[0] = bgr;
+        cv::remap(bgr, img->ref[0], mapx, mapy, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar());
+        return img;
+    }
+
+    /* NV12：I420 的 U/V 交错成 UV 平面 */
+    cv::Mat i420;
+    cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+    const cv::Size csize(size.width / 2, size.height / 2);
+    const cv::Mat u(csize, CV_8UC1, i420.ptr(size.height));
+    const cv::Mat v(csize, CV_8UC1, i420.ptr(size.height) + (size_t) csize.area());
+    const cv::Mat planes[2] = {u, v};
+    img->n_planes = 2;
+    img->in[0] = i420.rowRange(0, size.height).clone();
+    cv::merge(planes, 2, img->in[1]);
+
+    cv::Mat cmapx, cmapy;
+    undistort_maps_derive_chroma(mapx, mapy, csize, 2, cmapx, cmapy);
+    cv::remap(img->in[0], img->ref[0], mapx, mapy, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar());
+    cv::remap(img->in[1], img->ref[1], cmapx, cmapy, cv::INTER_LINEAR, cv::BORDER_CONSTANT, cv::Scalar());
+    return img;
+}
+
+/* 与元素相同的后端选择，得到这个组合实际使用的表格式 */
+static UndistortMapType
+test_effective_map_type(guint format, guint backend, guint map_format) {
+    UndistortBackendQuery query;
+    query.map_type = (UndistortMapType) map_format;
+    query.nv12 = !strcmp(test_formats[format], "NV12");
+    query.convert = false;
+    query.isa = undistort_kernels_detect_isa();
+#ifdef HAVE_IDC
+    query.idc_built = true;
+#else
+    query.idc_built = false;
+#endif
+#ifdef HAVE_IDC_EMU
+    query.idc_emulated = true;
+#else
+    query.idc_emulated = false;
+#endif
+    UndistortBackendChoice choice;
+    undistort_backend_select((UndistortBackend) (backend + UNDISTORT_BACKEND_OPENCV), &query, &choice);
+    return choice.map_type;
+}
+
+static GstBuffer *
+test_make_buffer(const TestImage *img, GstVideoInfo *info) {
+    GstBuffer *buf = gst_buffer_new_allocate(NULL, GST_VIDEO_INFO_SIZE(info), NULL);
+    GstVideoFrame frame;
+    fail_unless(gst_video_frame_map(&frame, info, buf, GST_MAP_WRITE));
+    for (int p = 0; p < img->n_planes; ++p) {
+        const cv::Mat &src = img->in[p];
+        auto *dst = (guint8 *) GST_VIDEO_FRAME_PLANE_DATA(&frame, p);
+        const gint stride = GST_VIDEO_FRAME_PLANE_STRIDE(&frame, p);
+        for (int y = 0; y < src.rows; ++y)
+            memcpy(dst + (gsize) y * stride, src.ptr(y), (gsize) src.cols * src.elemSize());
+    }
+    gst_video_frame_unmap(&frame);
+    GST_BUFFER_PTS(buf) = 0;
+    GST_BUFFER_DURATION(buf) = GST_SECOND / 30;
+    return buf;
+}
+
+/* 所有平面合在一起的 PSNR 与最大误差 */
+static void
+test_compare(const TestImage *img, GstVideoFrame *frame, double *psnr, int *max_err) {
+    double sse = 0, count = 0, max = 0;
+    for (int p = 0; p < img->n_planes; ++p) {
+        const cv::Mat &ref = img->ref[p];
+        const cv::Mat out(ref.size(), ref.type(), GST_VIDEO_FRAME_PLANE_DATA(frame, p),
+                          (size_t) GST_VIDEO_FRAME_PLANE_STRIDE(frame, p));
+        cv::Mat diff;
+        cv::absdiff(out, ref, diff);
+        diff = diff.reshape(1);
+        double m;
+        cv::minMaxLoc(diff, NULL, &m);
+        max = std::max(max, m);
+        diff.convertTo(diff, CV_64F);
+        sse += diff.dot(diff);
+        count += (double) diff.total();
+    }
+    *max_err = (int) max;
+    *psnr = sse > 0 ? 10.0 * log10(255.0 * 255.0 * count / sse) : INFINITY;
+}
+
+/* 循环下标 i 编码 format x backend x map-format */
+GST_START_TEST(test_golden)
+{
+    const guint map_format = __i__ % N_MAP_FORMATS;
+    const guint backend = __i__ / N_MAP_FORMATS % N_BACKENDS;
+    const guint format = __i__ / (N_MAP_FORMATS * N_BACKENDS);
+    const TestImage *img = test_image(format);
+    const UndistortMapType effective = test_effective_map_type(format, backend, map_format);
+
+    GstHarness *h = gst_harness_new("undistort");
+    g_object_set(h->element, "fx", TEST_FX, "fy", TEST_FY, "cx", TEST_CX, "cy", TEST_CY, "k1", TEST_K1,
+                 "k2", TEST_K2, "p1", TEST_P1, "p2", TEST_P2, "k3", TEST_K3, NULL);
+    gst_util_set_object_arg(G_OBJECT(h->element), "backend", test_backends[backend]);
+    gst_util_set_object_arg(G_OBJECT(h->element), "map-format", test_map_formats[map_format]);
+
+    gchar *caps_str = g_strdup_printf("video/x-raw,format=%s,width=%d,height=%d,framerate=30/1",
+                                      test_formats[format], img->in[0].cols, img->in[0].rows);
+    gst_harness_set_caps_str(h, caps_str, caps_str);
+    GstCaps *caps = gst_caps_from_string(caps_str);
+    GstVideoInfo info;
+    fail_unless(gst_video_info_from_caps(&info, caps));
+    gst_caps_unref(caps);
+    g_free(caps_str);
+
+    GstBuffer *out = gst_harness_push_and_pull(h, test_make_buffer(img, &info));
+    fail_unless(out != NULL);
+    GstVideoFrame frame;
+    fail_unless(gst_video_frame_map(&frame, &info, out, GST_MAP_READ));
+    double psnr;
+    int max_err;
+    test_compare(img, &frame, &psnr, &max_err);
+    gst_video_frame_unmap(&frame);
+    gst_buffer_unref(out);
+    gst_harness_teardown(h);
+
+    GST_INFO("%s backend=%s map-format=%s (tables %d): PSNR %.2f dB, max error %d", test_formats[format],
+             test_backends[backend], test_map_formats[map_format], (int) effective, psnr, max_err);
+    switch (effective) {
+        case UNDISTORT_MAP_FLOAT32:
+        case UNDISTORT_MAP_FIXED:
+            fail_unless(max_err <= 1, "%s backend=%s map-format=%s: max error %d > 1 (PSNR %.2f dB)",
+                        test_formats[format], test_backends[backend], test_map_formats[map_format], max_err, psnr);
+            break;
+        case UNDISTORT_MAP_MESH:
+            fail_unless(psnr >= 40.0, "%s backend=%s map-format=%s: PSNR %.2f dB < 40 (max error %d)",
+                        test_formats[format], test_backends[backend], test_map_formats[map_format], psnr, max_err);
+            break;
+        case UNDISTORT_MAP_NEAREST:
+            fail_unless(psnr >= 30.0, "%s backend=%s map-format=%s: PSNR %.2f dB < 30 (max error %d)",
+                        test_formats[format], test_backends[backend], test_map_formats[map_format], psnr, max_err);
+            break;
+    }
+}
+GST_END_TEST;
+
+static Suite *
+undistort_golden_suite(void) {
+    Suite *s = suite_create("undistort-golden");
+    TCase *tc = tcase_create("golden");
+
+    /* 4032x3024 的表生成与 remap，组合较多 */
+    tcase_set_timeout(tc, 600);
+    suite_add_tcase(s, tc);
+    tcase_add_loop_test(tc, test_golden, 0, N_FORMATS * N_BACKENDS * N_MAP_FORMATS);
+    return s;
+}
+
+GST_CHECK_MAIN(undistort_golden);
@@ -0,0 +1,117 @@
+/* undistort 的 QoS 测试（GstHarness）：
+ *  - 有 src_%u 请求 pad 时，只有 src pad 收到 QoS 事件，过期帧只在 src pad 上丢掉，
+ *    src_0 照常收到这一帧，QoS 事件也不转发到上游
+ *  - 没有请求 pad 时与 GstBaseTransform 相同：过期帧整帧丢掉，QoS 事件转发到上游 */
+
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#define TEST_CAPS "video/x-raw,format=NV12,width=320,height=240,framerate=25/1"
+#define TEST_SIZE (320 * 240 * 3 / 2)
+
+static void
+test_configure(GstElement *element) {
+    /* 非恒等映射，不进 passthrough */
+    g_object_set(element, "fx", 300.0, "fy", 300.0, "cx", 160.0, "cy", 120.0, "k1", -0.2, NULL);
+}
+
+static GstBuffer *
+test_buffer(GstClockTime pts) {
+    GstBuffer *buf = gst_buffer_new_allocate(NULL, TEST_SIZE, NULL);
+    gst_buffer_memset(buf, 0, 0x80, TEST_SIZE);
+    GST_BUFFER_PTS(buf) = pts;
+    GST_BUFFER_DURATION(buf) = GST_SECOND / 25;
+    return buf;
+}
+
+/* 期望的输出：pulled 为 TRUE 时必须拉到一个 buffer，否则必须没有 */
+static void
+test_expect(GstHarness *h, gboolean pulled, const gchar *what) {
+    GstBuffer *buf = pulled ? gst_harness_pull(h) : gst_harness_try_pull(h);
+    if (pulled)
+        fail_unless(buf != NULL, "%s: no buffer", what);
+    else
+        fail_unless(buf == NULL, "%s: unexpected buffer", what);
+    if (buf)
+        gst_buffer_unref(buf);
+}
+
+/* 上游是否收到了 QoS 事件（其他上游事件忽略） */
+static gboolean
+test_upstream_qos(GstHarness *h) {
+    gboolean qos = FALSE;
+    GstEvent *event;
+    while ((event = gst_harness_try_pull_upstream_event(h))) {
+        qos |= GST_EVENT_TYPE(event) == GST_EVENT_QOS;
+        gst_event_unref(event);
+    }
+    return qos;
+}
+
+/* src 下游报告最早可用时间 1s：40ms 的帧对 src pad 过期 */
+static void
+test_send_qos(GstHarness *h) {
+    fail_unless(gst_harness_push_upstream_event(h, gst_event_new_qos(GST_QOS_TYPE_UNDERFLOW, 0.5, GST_SECOND, 0)));
+}
+
+GST_START_TEST(test_qos_src_only_with_request_pad)
+{
+    GstHarness *h = gst_harness_new_with_padnames("undistort", "sink", "src");
+    GstHarness *h0 = gst_harness_new_with_element(h->element, NULL, "src_%u");
+    test_configure(h->element);
+    gst_harness_set_sink_caps_str(h0, TEST_CAPS);
+    gst_harness_set_caps_str(h, TEST_CAPS, TEST_CAPS);
+
+    fail_unless_equals_int(gst_harness_push(h, test_buffer(0)), GST_FLOW_OK);
+    test_expect(h, TRUE, "src, first frame");
+    test_expect(h0, TRUE, "src_0, first frame");
+
+    test_send_qos(h);
+    fail_if(test_upstream_qos(h), "QoS of the src pad reached upstream with a request pad present");
+
+    fail_unless_equals_int(gst_harness_push(h, test_buffer(40 * GST_MSECOND)), GST_FLOW_OK);
+    test_expect(h, FALSE, "src, late frame");
+    test_expect(h0, TRUE, "src_0, frame late only on src");
+
+    fail_unless_equals_int(gst_harness_push(h, test_buffer(2 * GST_SECOND)), GST_FLOW_OK);
+    test_expect(h, TRUE, "src, frame after earliest");
+    test_expect(h0, TRUE, "src_0, frame after earliest");
+
+    gst_harness_teardown(h0);
+    gst_harness_teardown(h);
+}
+GST_END_TEST;
+
+GST_START_TEST(test_qos_without_request_pad)
+{
+    GstHarness *h = gst_harness_new_with_padnames("undistort", "sink", "src");
+    test_configure(h->element);
+    gst_harness_set_caps_str(h, TEST_CAPS, TEST_CAPS);
+
+    fail_unless_equals_int(gst_harness_push(h, test_buffer(0)), GST_FLOW_OK);
+    test_expect(h, TRUE, "src, first frame");
+
+    test_send_qos(h);
+    fail_unless(test_upstream_qos(h), "QoS of the src pad was not forwarded upstream");
+
+    fail_unless_equals_int(gst_harness_push(h, test_buffer(40 * GST_MSECOND)), GST_FLOW_OK);
+    test_expect(h, FALSE, "src, late frame");
+    fail_unless_equals_int(gst_harness_push(h, test_buffer(2 * GST_SECOND)), GST_FLOW_OK);
+    test_expect(h, TRUE, "src, frame after earliest");
+
+    gst_harness_teardown(h);
+}
+GST_END_TEST;
+
+static Suite *
+undistort_qos_suite(void) {
+    Suite *s = suite_create("undistort-qos");
+    TCase *tc = tcase_create("qos");
+
+    suite_add_tcase(s, tc);
+    tcase_add_test(tc, test_qos_src_only_with_request_pad);
+    tcase_add_test(tc, test_qos_without_request_pad);
+    return s;
+}
+
+GST_CHECK_MAIN(undistort_qos);